@@ -0,0 +1,51 @@
+#include "boiler_model.h"
+#include <math.h>
+
+#define WATER_J_PER_G_K  4.186
+
+void BoilerModel::reset(const BoilerParams &newParams, float startC) {
+  params = newParams;
+  water = startC;
+  element = startC;
+  sensor = startC;
+  energy = 0.0;
+  sensorOpen = false;
+  rng = 1;
+}
+
+// Explicit Euler; the simulator steps at 10 ms, far below the smallest time
+// constant (element: 120 J/K / 25 W/K = 4.8 s)
+void BoilerModel::step(float dt, bool heaterOn, float drawMlPerS) {
+  float heaterW = heaterOn ? params.heaterPowerW : 0.0;
+  float toWaterW = params.elementWPerK * (element - water);
+  float lossW = params.lossWPerK * (water - params.ambientC);
+  float drawW = drawMlPerS * WATER_J_PER_G_K * (water - params.inletC);
+
+  element += (heaterW - toWaterW) / params.elementJPerK * dt;
+  water += (toWaterW - lossW - drawW) / params.boilerJPerK * dt;
+  sensor += (water - sensor) * dt / params.sensorTauS;
+  energy += heaterW * dt;
+}
+
+// Box-Muller on a small LCG, so runs are repeatable
+float BoilerModel::gaussian() {
+  rng = rng * 1664525 + 1013904223;
+  float u1 = ((rng >> 8) + 1) / 16777217.0;
+  rng = rng * 1664525 + 1013904223;
+  float u2 = (rng >> 8) / 16777216.0;
+  return sqrtf(-2.0 * logf(u1)) * cosf(2.0 * M_PI * u2);
+}
+
+uint32_t BoilerModel::thermocoupleFrame() {
+  int32_t coldJunction = (int32_t)lroundf(params.coldJunctionC / 0.0625) & 0xFFF;
+  if (sensorOpen) {
+    return ((uint32_t)coldJunction << 4) | 0x00010000 | 0x01;
+  }
+
+  float measured = sensor;
+  if (params.noiseC > 0.0) {
+    measured += gaussian() * params.noiseC;
+  }
+  int32_t thermocouple = (int32_t)lroundf(measured / 0.25) & 0x3FFF;
+  return ((uint32_t)thermocouple << 18) | ((uint32_t)coldJunction << 4);
+}
@@ -0,0 +1,55 @@
+#ifndef BOILER_MODEL_H
+#define BOILER_MODEL_H
+
+#include <stdint.h>
+
+// ======= Boiler Parameters =======
+// Two thermal masses: the heating element (with its sheath) and the boiler
+// (water plus brass). Heat flows element -> water -> ambient; a shot replaces
+// hot water with cold inlet water. The thermocouple sits in a well and sees
+// the water temperature through a first-order lag.
+struct BoilerParams {
+  float heaterPowerW = 1200.0;
+  float elementJPerK = 120.0;     // Element + sheath heat capacity
+  float elementWPerK = 25.0;      // Element -> water conductance
+  float boilerJPerK = 1900.0;     // ~0.35 L water + brass body
+  float lossWPerK = 0.9;          // Boiler -> ambient (insulation)
+  float ambientC = 22.0;
+  float inletC = 20.0;            // Water drawn in during a shot
+  float sensorTauS = 2.5;         // Thermocouple well time constant
+  float noiseC = 0.0;             // Sensor noise, 1 sigma
+  float coldJunctionC = 30.0;     // MAX31855 die temperature
+};
+
+// ======= Boiler Model =======
+class BoilerModel {
+public:
+  void reset(const BoilerParams &params, float startC);
+
+  // Advance by dt seconds with the SSR state and water draw (ml/s) held
+  void step(float dtSeconds, bool heaterOn, float drawMlPerS);
+
+  // Raw 32-bit MAX31855 frame for the current sensor temperature
+  uint32_t thermocoupleFrame();
+
+  float waterC() const { return water; }
+  float elementC() const { return element; }
+  float sensorC() const { return sensor; }
+  float energyJ() const { return energy; }     // Heater energy used so far
+
+  void setSensorOpen(bool open) { sensorOpen = open; }
+  void setNoise(float sigmaC) { params.noiseC = sigmaC; }
+
+private:
+  BoilerParams params;
+  float water = 20.0;
+  float element = 20.0;
+  float sensor = 20.0;
+  float energy = 0.0;
+  bool sensorOpen = false;
+  uint32_t rng = 1;
+
+  float gaussian();
+};
+
+#endif // BOILER_MODEL_H
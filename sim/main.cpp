@@ -0,0 +1,419 @@
+// Closed-loop boiler simulation: runs the firmware's acquisition, on/off and
+// PID control and SSR output stage against a thermal model of the boiler,
+// much faster than real time.
+//
+//   pio run -e native && .pio/build/native/program --mode pid --shot-at 300
+//
+// With --max-* limits the exit status is 1 if any limit is exceeded, so a
+// run can serve as a regression check. --scenario runs one of the scripted
+// benchmark scenarios instead and prints its KPIs as JSON (see
+// tools/controller_benchmark.py for the full matrix). --soak runs days of
+// simulated use and fails if the heap grows.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "config.h"
+#include "simulator.h"
+#include "metrics.h"
+#include "scenarios.h"
+#include "shot_engine.h"
+#include "autotune.h"
+#include "trace_recorder.h"
+#include "temperature.h"
+#include "control_task.h"
+#include "shared_state.h"
+#include "status_event.h"
+
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+extern HostSerial Serial;
+
+// Unit tests (pio test -e native) link the same sources with their own main()
+#ifndef PIO_UNIT_TESTING
+
+#define SETTLE_BAND_C       0.5    // Settled = within ±0.5 °C of target
+#define STEADY_WINDOW_MS    60000  // Duty cycle is averaged over the last minute
+#define AUTOTUNE_PREHEAT_MS 300000 // Settling under the current gains first
+#define SOAK_WARMUP_H       1      // Heap baseline after this much simulated use
+#define SOAK_STATUS_MS      1000   // Status rendering rate (as the web/display readers)
+
+struct Options {
+  int mode = CONTROL_MODE_ONOFF;
+  bool steam = false;
+  float startC = 22.0;
+  float durationS = 900.0;
+  float shotAtS = -1.0;
+  float shotS = 25.0;
+  float shotFlow = 2.0;      // ml/s
+  float noiseC = 0.0;
+  const char *csvPath = NULL;
+  const char *tracePath = NULL;
+  bool traceShot = false;
+  const char *scenario = NULL;
+  int autotune = -1;         // AutotuneMethod
+  float soakH = -1.0;
+  float maxOvershootC = -1.0;
+  float maxSettleS = -1.0;
+  float maxDuty = -1.0;
+};
+
+static void usage() {
+  printf("Usage: program [options]\n"
+         "  --mode onoff|pid|smith Controller (default onoff)\n"
+         "  --steam               Regulate to the steam setpoint\n"
+         "  --target C            Brew (or steam) setpoint\n"
+         "  --start C             Initial boiler temperature (default 22)\n"
+         "  --duration S          Simulated seconds (default 900)\n"
+         "  --shot-at S           Pull a shot at this time\n"
+         "  --shot-length S       Shot length (default 25)\n"
+         "  --shot-flow ML        Shot flow in ml/s at full pump duty (default 2)\n"
+         "  --ff-boost PCT        Shot feed-forward boost for every size (0 = off)\n"
+         "  --no-ff-learn         Keep the feed-forward boost fixed\n"
+         "  --noise C             Thermocouple noise, 1 sigma\n"
+         "  --kp/--ki/--kd X      PID gains at the brew setpoint\n"
+         "  --steam-kp/-ki/-kd X  PID gains at the steam setpoint\n"
+         "  --model-gain/-tau/-dead X  Smith predictor model (°C/%%, s, s)\n"
+         "  --lambda S            Smith predictor closed-loop time constant\n"
+         "  --interval MS         Control period (default %d)\n"
+         "  --csv FILE            Write the trace\n"
+         "  --trace FILE          Write the firmware's binary trace dump (as /api/trace)\n"
+         "  --trace-shot          Arm the trace recorder on the shot\n"
+         "  --scenario NAME       Run a benchmark scenario, print JSON KPIs:\n"
+         "                        %s\n"
+         "  --autotune relay      Settle at the setpoint, run autotune, print the result\n"
+         "  --soak H              Simulate H hours of shots and mode changes, fail on heap growth\n"
+         "  --verbose             Show firmware serial output\n"
+         "  --max-overshoot C     Fail if overshoot exceeds C\n"
+         "  --max-settle S        Fail if not settled within S\n"
+         "  --max-duty PCT        Fail if steady-state duty exceeds PCT\n",
+         CoffeeConfig().tempUpdateInterval, scenarioNames());
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    bool takesValue = true;
+
+    if (strcmp(arg, "--mode") == 0 && value) {
+      if (strcmp(value, "pid") == 0) opt.mode = CONTROL_MODE_PID;
+      else if (strcmp(value, "smith") == 0) opt.mode = CONTROL_MODE_SMITH;
+      else if (strcmp(value, "onoff") == 0) opt.mode = CONTROL_MODE_ONOFF;
+      else return false;
+    } else if (strcmp(arg, "--target") == 0 && value) {
+      coffeeConfig.brewTemp = coffeeConfig.steamTemp = atof(value);
+    } else if (strcmp(arg, "--start") == 0 && value) {
+      opt.startC = atof(value);
+    } else if (strcmp(arg, "--duration") == 0 && value) {
+      opt.durationS = atof(value);
+    } else if (strcmp(arg, "--shot-at") == 0 && value) {
+      opt.shotAtS = atof(value);
+    } else if (strcmp(arg, "--shot-length") == 0 && value) {
+      opt.shotS = atof(value);
+    } else if (strcmp(arg, "--shot-flow") == 0 && value) {
+      opt.shotFlow = atof(value);
+    } else if (strcmp(arg, "--ff-boost") == 0 && value) {
+      for (int s = 0; s < 4; s++) coffeeConfig.ffBoostPct[s] = atof(value);
+      coffeeConfig.ffEnable = atof(value) > 0.0;
+    } else if (strcmp(arg, "--noise") == 0 && value) {
+      opt.noiseC = atof(value);
+    } else if (strcmp(arg, "--kp") == 0 && value) {
+      coffeeConfig.pidKp = atof(value);
+    } else if (strcmp(arg, "--ki") == 0 && value) {
+      coffeeConfig.pidKi = atof(value);
+    } else if (strcmp(arg, "--kd") == 0 && value) {
+      coffeeConfig.pidKd = atof(value);
+    } else if (strcmp(arg, "--steam-kp") == 0 && value) {
+      coffeeConfig.steamKp = atof(value);
+    } else if (strcmp(arg, "--steam-ki") == 0 && value) {
+      coffeeConfig.steamKi = atof(value);
+    } else if (strcmp(arg, "--steam-kd") == 0 && value) {
+      coffeeConfig.steamKd = atof(value);
+    } else if (strcmp(arg, "--model-gain") == 0 && value) {
+      coffeeConfig.modelGain = atof(value);
+    } else if (strcmp(arg, "--model-tau") == 0 && value) {
+      coffeeConfig.modelTauS = atof(value);
+    } else if (strcmp(arg, "--model-dead") == 0 && value) {
+      coffeeConfig.modelDeadTimeS = atof(value);
+    } else if (strcmp(arg, "--lambda") == 0 && value) {
+      coffeeConfig.smithLambdaS = atof(value);
+    } else if (strcmp(arg, "--interval") == 0 && value) {
+      coffeeConfig.tempUpdateInterval = atoi(value);
+    } else if (strcmp(arg, "--csv") == 0 && value) {
+      opt.csvPath = value;
+    } else if (strcmp(arg, "--trace") == 0 && value) {
+      opt.tracePath = value;
+    } else if (strcmp(arg, "--scenario") == 0 && value) {
+      opt.scenario = value;
+    } else if (strcmp(arg, "--autotune") == 0 && value) {
+      // The sTune step method is not simulated (see shim/sTune.h)
+      if (strcmp(value, "relay") == 0) opt.autotune = AUTOTUNE_METHOD_RELAY;
+      else return false;
+    } else if (strcmp(arg, "--soak") == 0 && value) {
+      opt.soakH = atof(value);
+    } else if (strcmp(arg, "--max-overshoot") == 0 && value) {
+      opt.maxOvershootC = atof(value);
+    } else if (strcmp(arg, "--max-settle") == 0 && value) {
+      opt.maxSettleS = atof(value);
+    } else if (strcmp(arg, "--max-duty") == 0 && value) {
+      opt.maxDuty = atof(value);
+    } else {
+      takesValue = false;
+      if (strcmp(arg, "--steam") == 0) opt.steam = true;
+      else if (strcmp(arg, "--verbose") == 0) Serial.enabled = true;
+      else if (strcmp(arg, "--no-ff-learn") == 0) coffeeConfig.ffLearn = false;
+      else if (strcmp(arg, "--trace-shot") == 0) opt.traceShot = true;
+      else return false;
+    }
+    if (takesValue) i++;
+  }
+  // The control period must be a whole number of output ticks
+  return coffeeConfig.tempUpdateInterval >= 100 && coffeeConfig.tempUpdateInterval % 100 == 0;
+}
+
+static void writeCsv(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return;
+  }
+  fprintf(f, "time_s,water_c,sensor_c,filtered_c,target_c,duty_pct,ssr,draw_ml_s\n");
+  const std::vector<SimSample> &trace = simTrace();
+  for (size_t i = 0; i < trace.size(); i++) {
+    const SimSample &s = trace[i];
+    fprintf(f, "%.1f,%.3f,%.3f,%.2f,%.1f,%.1f,%d,%.1f\n", s.ms / 1000.0, s.waterC, s.sensorC,
+            s.filteredC, s.targetC, s.duty, s.ssr ? 1 : 0, s.drawMlPerS);
+  }
+  fclose(f);
+}
+
+// Dump the recorder ring through the same reader as /api/trace
+static void writeTrace(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return;
+  }
+  TraceCursor cursor = openTrace(false);
+  uint8_t buffer[1436];    // One TCP segment
+  size_t n;
+  while ((n = readTrace(cursor, buffer, sizeof(buffer))) > 0) {
+    fwrite(buffer, 1, n, f);
+  }
+  fclose(f);
+}
+
+// Autotune from a boiler settled at the setpoint under the current gains
+static int runAutotune(AutotuneMethod method, float targetC, float noiseC) {
+  BoilerParams params;
+  params.noiseC = noiseC;
+  simBegin(params, targetC);
+  simRun(AUTOTUNE_PREHEAT_MS);
+
+  uint32_t startMs = simElapsedMs();
+  startAutotune(method);
+  while (isAutotuning() && simElapsedMs() - startMs < AUTOTUNE_TIMEOUT_MS + 60000) {
+    simRun(1000);
+  }
+
+  AutotuneStatus tune = getAutotuneStatus();
+  printf("Autotune:        %s, %s set at %.1f C\n", method == AUTOTUNE_METHOD_STEP ? "step" : "relay",
+         tune.steam ? "steam" : "brew", tune.setpoint);
+  printf("Result:          %s (%s) after %.0f s\n", autotuneResultName(tune.result), tune.message,
+         (simElapsedMs() - startMs) / 1000.0);
+  printf("Relay:           %u cycles, Ku %.2f, Pu %.1f s\n", tune.cycles, tune.ku, tune.puS);
+  printf("Previous gains:  Kp %.3f Ki %.4f Kd %.2f: overshoot %.2f C, settle %.0f s\n",
+         tune.previous.kp, tune.previous.ki, tune.previous.kd,
+         tune.previousTest.overshootC, tune.previousTest.settleS);
+  printf("New gains:       Kp %.3f Ki %.4f Kd %.2f: overshoot %.2f C, settle %.0f s\n",
+         tune.candidate.kp, tune.candidate.ki, tune.candidate.kd,
+         tune.candidateTest.overshootC, tune.candidateTest.settleS);
+  if (tune.model.gain > 0.0) {
+    printf("Boiler model:    K %.2f C/%%, tau %.0f s, dead time %.1f s\n",
+           tune.model.gain, tune.model.tauS, tune.model.deadTimeS);
+  }
+  return tune.result == AUTOTUNE_RESULT_SAVED || tune.result == AUTOTUNE_RESULT_REJECTED ? 0 : 1;
+}
+
+// Bytes in use on the host heap (0 where the C library cannot tell)
+static size_t heapInUse() {
+#ifdef __GLIBC__
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+// Hours of use: a shot every 10 minutes, a steam session every hour, size
+// selections and heating toggles through the command queue, and the status
+// rendered every second by the event stream's serializer. Everything the firmware
+// allocates up front is allocated during the first hour; after that the
+// heap must not grow.
+static int runSoak(float hours, float noiseC) {
+  BoilerParams params;
+  params.noiseC = noiseC;
+  simSetRecording(false);
+  simBegin(params, coffeeConfig.brewTemp);
+  simSetPumpFlow(SIM_PUMP_FLOW_ML_S);
+
+  uint32_t totalS = (uint32_t)(hours * 3600.0);
+  size_t baseline = 0;
+  size_t peak = 0;
+  uint32_t rendered = 0;
+  char status[EVENT_BUFFER_SIZE];
+  StreamedStatus lastSent;
+  uint32_t lastKeyframeS = 0;
+
+  for (uint32_t s = 0; s < totalS; s++) {
+    uint32_t inHour = s % 3600;
+    if (inHour % 600 == 0 && inHour < 1800) {
+      postCommand(CMD_SELECT_SHOT_SIZE, (s / 600) % 4);
+      simRun(SOAK_STATUS_MS);
+      startShot(getControlSnapshot().state.selectedShotSize);
+    } else if (inHour == 1800) {
+      postCommand(CMD_SET_STEAM_MODE, 1);
+    } else if (inHour == 2700) {
+      postCommand(CMD_SET_STEAM_MODE, 0);
+    } else if (inHour == 3300 || inHour == 3310) {
+      postCommand(CMD_TOGGLE_HEATING);
+    }
+    simRun(SOAK_STATUS_MS);
+
+    // Keyframes and deltas as updateEventStream() sends them
+    StreamedStatus current;
+    captureStatus(current);
+    bool keyframe = s == 0 || (s - lastKeyframeS) * 1000 >= EVENT_KEYFRAME_MS;
+    if (formatStatusEvent(status, sizeof(status), current, keyframe ? NULL : &lastSent) > 0) {
+      rendered++;
+      lastSent = current;
+      if (keyframe) lastKeyframeS = s;
+    }
+
+    if (s + 1 == SOAK_WARMUP_H * 3600) {
+      baseline = peak = heapInUse();
+    } else if (s + 1 > SOAK_WARMUP_H * 3600 && heapInUse() > peak) {
+      peak = heapInUse();
+    }
+  }
+
+  SharedStateStats stats = getSharedStateStats();
+  printf("Soak:            %.1f h simulated, %u status events\n", hours, rendered);
+  printf("Commands:        %u posted, %u applied, %u dropped, max depth %u\n",
+         stats.posted, stats.applied, stats.dropped, stats.maxDepth);
+  if (heapInUse() == 0) {
+    printf("Heap:            not measurable on this C library\n");
+    return 0;
+  }
+  if (hours <= SOAK_WARMUP_H) {
+    printf("Heap:            %zu bytes in use (run longer than %d h to compare)\n",
+           heapInUse(), SOAK_WARMUP_H);
+    return 0;
+  }
+  printf("Heap:            %zu bytes in use after %d h, peak %zu after (growth %ld)\n",
+         baseline, SOAK_WARMUP_H, peak, (long)(peak - baseline));
+  return peak > baseline ? 1 : 0;
+}
+
+static bool check(const char *name, float value, float limit) {
+  if (limit < 0.0) return true;
+  bool ok = value >= 0.0 && value <= limit;
+  if (!ok) printf("FAIL: %s %.2f exceeds limit %.2f\n", name, value, limit);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  coffeeConfig.controlMode = opt.mode;
+  systemState.set(STATE_STEAM_MODE, opt.steam);
+  
+  if (opt.scenario) {
+    ScenarioResult result;
+    if (!runScenario(opt.scenario, result)) {
+      fprintf(stderr, "Unknown scenario '%s' (%s)\n", opt.scenario, scenarioNames());
+      return 2;
+    }
+    printScenarioJson(result, controlModeName(opt.mode));
+    if (opt.csvPath) writeCsv(opt.csvPath);
+    if (opt.tracePath) writeTrace(opt.tracePath);
+    return 0;
+  }
+  float targetC = opt.steam ? coffeeConfig.steamTemp : coffeeConfig.brewTemp;
+  if (opt.autotune >= 0) {
+    return runAutotune((AutotuneMethod)opt.autotune, targetC, opt.noiseC);
+  }
+  if (opt.soakH > 0.0) {
+    return runSoak(opt.soakH, opt.noiseC);
+  }
+
+  BoilerParams params;
+  params.noiseC = opt.noiseC;
+  simBegin(params, opt.startC);
+  if (opt.traceShot) startTrace(TRACE_TRIGGER_SHOT, TRACE_POST_MS);
+
+  clock_t wallStart = clock();
+  uint32_t durationMs = (uint32_t)(opt.durationS * 1000.0);
+  uint32_t shotStartMs = opt.shotAtS >= 0.0 ? (uint32_t)(opt.shotAtS * 1000.0) : durationMs;
+
+  // Warm-up, then the shot through the shot engine, then recovery; whole
+  // seconds keep the phases on the 100 ms acquisition grid
+  simRun(shotStartMs < durationMs ? shotStartMs : durationMs);
+  if (shotStartMs < durationMs) {
+    coffeeConfig.shotSizes[0] = opt.shotS;
+    simSetPumpFlow(opt.shotFlow);
+    startShot(0);
+    simRun(durationMs - shotStartMs);
+  }
+  double wallS = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+
+  const std::vector<SimSample> &trace = simTrace();
+  StepMetrics warmup = analyzeStep(trace, 0, shotStartMs, targetC, SETTLE_BAND_C);
+  uint32_t steadyFrom = shotStartMs > STEADY_WINDOW_MS ? shotStartMs - STEADY_WINDOW_MS : 0;
+  float steadyDuty = meanDuty(trace, steadyFrom, shotStartMs);
+
+  printf("Controller:      %s (interval %d ms)\n", controlModeName(opt.mode),
+         coffeeConfig.tempUpdateInterval);
+  printf("Target:          %.1f C from %.1f C\n", targetC, opt.startC);
+  printf("Overshoot:       %.2f C\n", warmup.overshootC);
+  if (warmup.settleTimeS >= 0.0) {
+    printf("Settle time:     %.1f s (±%.1f C)\n", warmup.settleTimeS, SETTLE_BAND_C);
+  } else {
+    printf("Settle time:     not settled\n");
+  }
+  printf("Steady duty:     %.1f %%\n", steadyDuty);
+  if (shotStartMs < durationMs) {
+    StepMetrics recovery = analyzeStep(trace, shotStartMs, durationMs, targetC, SETTLE_BAND_C);
+    float minC = 1000.0;
+    for (size_t i = 0; i < trace.size(); i++) {
+      if (trace[i].ms >= shotStartMs && trace[i].waterC < minC) minC = trace[i].waterC;
+    }
+    printf("Shot drop:       %.2f C\n", targetC - minC);
+    if (recovery.settleTimeS >= 0.0) {
+      printf("Shot recovery:   %.1f s\n", recovery.settleTimeS);
+    } else {
+      printf("Shot recovery:   not recovered\n");
+    }
+  }
+  printf("SSR switches:    %u\n", simSsrSwitches());
+  printf("Energy:          %.1f Wh\n", simEnergyJ() / 3600.0);
+  printf("Simulated %.0f s in %.3f s wall time (%.0fx)\n", opt.durationS, wallS,
+         wallS > 0.0 ? opt.durationS / wallS : 0.0);
+
+  if (opt.csvPath) writeCsv(opt.csvPath);
+  if (opt.tracePath) writeTrace(opt.tracePath);
+
+  bool ok = check("overshoot", warmup.overshootC, opt.maxOvershootC) &&
+            check("settle time", warmup.settleTimeS, opt.maxSettleS) &&
+            check("steady duty", steadyDuty, opt.maxDuty);
+  return ok ? 0 : 1;
+}
+
+#endif // PIO_UNIT_TESTING
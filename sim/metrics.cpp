@@ -0,0 +1,80 @@
+#include "metrics.h"
+#include <math.h>
+
+float meanDuty(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs) {
+  // Difference of the per-tick on-time counter between the first and last
+  // sample in the window
+  const SimSample *first = NULL, *last = NULL;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].ms < fromMs || trace[i].ms >= toMs) continue;
+    if (first == NULL) first = &trace[i];
+    last = &trace[i];
+  }
+  if (first == NULL || last->ms == first->ms) return 0.0;
+  return 100.0 * (last->ssrOnMs - first->ssrOnMs) / (last->ms - first->ms);
+}
+
+float rmsError(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs) {
+  uint32_t samples = 0;
+  double sumSquares = 0.0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].ms < fromMs || trace[i].ms >= toMs) continue;
+    double error = trace[i].waterC - trace[i].targetC;
+    sumSquares += error * error;
+    samples++;
+  }
+  return samples > 0 ? sqrt(sumSquares / samples) : 0.0;
+}
+
+float minWater(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs) {
+  float lowest = 1000.0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].ms < fromMs || trace[i].ms >= toMs) continue;
+    if (trace[i].waterC < lowest) lowest = trace[i].waterC;
+  }
+  return lowest;
+}
+
+StepMetrics analyzeStep(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs,
+                        float targetC, float bandC) {
+  StepMetrics m;
+  bool inBand = false;
+  uint32_t enteredMs = 0;
+  float peak = -1000.0;         // Furthest past the start, in step direction
+  bool haveStart = false;
+  float dir = 1.0;              // -1 for a step down (steam to brew)
+  float lowC = 0.0, highC = 0.0;
+  uint32_t lowMs = 0;
+  bool passedLow = false;
+
+  for (size_t i = 0; i < trace.size(); i++) {
+    const SimSample &s = trace[i];
+    if (s.ms < fromMs || s.ms >= toMs) continue;
+
+    // 10% / 90% crossing levels relative to where the step started
+    if (!haveStart) {
+      dir = targetC >= s.waterC ? 1.0 : -1.0;
+      lowC = s.waterC + 0.1 * (targetC - s.waterC);
+      highC = s.waterC + 0.9 * (targetC - s.waterC);
+      haveStart = true;
+    }
+    if (!passedLow && dir * (s.waterC - lowC) >= 0.0) {
+      lowMs = s.ms;
+      passedLow = true;
+    }
+    if (passedLow && m.riseTimeS < 0.0 && dir * (s.waterC - highC) >= 0.0) {
+      m.riseTimeS = (s.ms - lowMs) / 1000.0;
+    }
+
+    if (dir * s.waterC > peak) peak = dir * s.waterC;
+
+    bool inside = fabsf(s.waterC - targetC) <= bandC;
+    if (inside && !inBand) enteredMs = s.ms;
+    inBand = inside;
+  }
+
+  m.overshootC = peak > dir * targetC ? peak - dir * targetC : 0.0;
+  if (inBand) m.settleTimeS = (enteredMs - fromMs) / 1000.0;
+  m.meanDuty = meanDuty(trace, fromMs, toMs);
+  return m;
+}
@@ -0,0 +1,31 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <vector>
+#include "simulator.h"
+
+// Response of the true boiler temperature to a setpoint step
+struct StepMetrics {
+  float riseTimeS = -1.0;     // 10% to 90% of the step; -1 = never reached 90%
+  float overshootC = 0.0;     // Peak past target (0 if it never got there);
+                              // below target for a step down
+  float settleTimeS = -1.0;   // Until it stays within the band; -1 = never
+  float meanDuty = 0.0;       // Fraction of time the SSR was on (0-100%)
+};
+
+// Analyze the trace samples in [fromMs, toMs)
+StepMetrics analyzeStep(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs,
+                        float targetC, float bandC);
+
+// SSR on-time fraction over [fromMs, toMs), in percent, from the on-time
+// counted every output tick (SimSample::ssrOnMs)
+float meanDuty(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs);
+
+// RMS of (water - target) over [fromMs, toMs)
+float rmsError(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs);
+
+// Lowest water temperature over [fromMs, toMs)
+float minWater(const std::vector<SimSample> &trace, uint32_t fromMs, uint32_t toMs);
+
+#endif // METRICS_H
@@ -0,0 +1,171 @@
+#include "scenarios.h"
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "simulator.h"
+#include "metrics.h"
+#include "shot_engine.h"
+#include "shared_state.h"
+
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+#define SCENARIO_BAND_C       0.5
+#define SCENARIO_PREHEAT_MS   300000   // Settling at brew before a disturbance
+#define SCENARIO_SHOT_MS      25000
+#define SCENARIO_SHOT_GAP_MS  60000    // Shot start to shot start
+#define SCENARIO_SHOT_FLOW    2.0      // ml/s
+#define SCENARIO_NOISE_C      0.5
+
+// Counters at the start of the measurement window
+struct Window {
+  uint32_t fromMs;
+  uint32_t switches;
+  uint32_t ssrOnMs;
+  float energyJ;
+};
+
+static Window openWindow() {
+  Window w;
+  w.fromMs = simElapsedMs();
+  w.switches = simSsrSwitches();
+  w.ssrOnMs = simSsrOnMs();
+  w.energyJ = simEnergyJ();
+  return w;
+}
+
+static void closeWindow(const Window &w, ScenarioResult &result) {
+  result.ssrSwitches = simSsrSwitches() - w.switches;
+  result.energyWh = (simEnergyJ() - w.energyJ) / 3600.0;
+  uint32_t windowMs = simElapsedMs() - w.fromMs;
+  result.meanDuty = windowMs > 0 ? 100.0 * (simSsrOnMs() - w.ssrOnMs) / windowMs : 0.0;
+}
+
+// Setpoint step: rise, overshoot and settling over the whole window, RMS
+// error over its last third
+static void measureStep(const Window &w, float targetC, ScenarioResult &result) {
+  uint32_t toMs = simElapsedMs();
+  StepMetrics step = analyzeStep(simTrace(), w.fromMs, toMs, targetC, SCENARIO_BAND_C);
+  result.riseTimeS = step.riseTimeS;
+  result.overshootC = step.overshootC;
+  result.settleTimeS = step.settleTimeS;
+  result.rmsErrorC = rmsError(simTrace(), toMs - (toMs - w.fromMs) / 3, toMs);
+  closeWindow(w, result);
+}
+
+static void coldStart(ScenarioResult &result) {
+  BoilerParams params;
+  simBegin(params, params.ambientC);
+  Window w = openWindow();
+  simRun(900000);
+  measureStep(w, coffeeConfig.brewTemp, result);
+}
+
+static void brewToSteam(ScenarioResult &result) {
+  BoilerParams params;
+  simBegin(params, coffeeConfig.brewTemp);
+  simRun(SCENARIO_PREHEAT_MS);
+
+  postCommand(CMD_SET_STEAM_MODE, 1);
+  Window w = openWindow();
+  simRun(900000);
+  measureStep(w, coffeeConfig.steamTemp, result);
+}
+
+static void steamToBrew(ScenarioResult &result) {
+  BoilerParams params;
+  systemState.set(STATE_STEAM_MODE, true);
+  simBegin(params, coffeeConfig.steamTemp);
+  simRun(SCENARIO_PREHEAT_MS);
+
+  postCommand(CMD_SET_STEAM_MODE, 0);
+  Window w = openWindow();
+  simRun(1800000);   // Passive cooling only
+  measureStep(w, coffeeConfig.brewTemp, result);
+}
+
+static void backToBackShots(ScenarioResult &result) {
+  BoilerParams params;
+  simBegin(params, coffeeConfig.brewTemp);
+  simRun(SCENARIO_PREHEAT_MS);
+
+  // Shots go through the shot engine (pump profile and feed-forward)
+  coffeeConfig.shotSizes[1] = SCENARIO_SHOT_MS / 1000.0;
+  simSetPumpFlow(SCENARIO_SHOT_FLOW);
+
+  Window w = openWindow();
+  for (int shot = 0; shot < 3; shot++) {
+    startShot(1);
+    simRun(SCENARIO_SHOT_GAP_MS);
+  }
+  simRun(300000);
+
+  uint32_t toMs = simElapsedMs();
+  const std::vector<SimSample> &trace = simTrace();
+  // Recovery is judged from the end of the last shot
+  uint32_t lastShotEndMs = w.fromMs + 2 * SCENARIO_SHOT_GAP_MS + SCENARIO_SHOT_MS;
+  StepMetrics recovery = analyzeStep(trace, lastShotEndMs, toMs, coffeeConfig.brewTemp,
+                                     SCENARIO_BAND_C);
+  result.overshootC = recovery.overshootC;
+  result.settleTimeS = recovery.settleTimeS;
+  result.rmsErrorC = rmsError(trace, w.fromMs, toMs);
+  result.maxDropC = coffeeConfig.brewTemp - minWater(trace, w.fromMs, toMs);
+  closeWindow(w, result);
+}
+
+static void noisyColdStart(ScenarioResult &result) {
+  BoilerParams params;
+  params.noiseC = SCENARIO_NOISE_C;
+  simBegin(params, params.ambientC);
+  Window w = openWindow();
+  simRun(900000);
+  measureStep(w, coffeeConfig.brewTemp, result);
+}
+
+// ======= Scenario Table =======
+struct Scenario {
+  const char *name;
+  void (*run)(ScenarioResult &result);
+};
+
+static const Scenario scenarios[] = {
+  {"cold_start", coldStart},
+  {"brew_to_steam", brewToSteam},
+  {"steam_to_brew", steamToBrew},
+  {"shots", backToBackShots},
+  {"noise", noisyColdStart},
+};
+
+bool runScenario(const char *name, ScenarioResult &result) {
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    if (strcmp(name, scenarios[i].name) == 0) {
+      result = ScenarioResult();
+      result.scenario = scenarios[i].name;
+      scenarios[i].run(result);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *scenarioNames() {
+  static char names[96] = "";
+  if (names[0] == '\0') {
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+      if (i > 0) strcat(names, " ");
+      strcat(names, scenarios[i].name);
+    }
+  }
+  return names;
+}
+
+void printScenarioJson(const ScenarioResult &r, const char *controller) {
+  printf("{\"scenario\":\"%s\",\"controller\":\"%s\",\"intervalMs\":%d,"
+         "\"kp\":%.4g,\"ki\":%.4g,\"kd\":%.4g,"
+         "\"riseTimeS\":%.1f,\"overshootC\":%.3f,\"settleTimeS\":%.1f,\"rmsErrorC\":%.3f,"
+         "\"maxDropC\":%.3f,\"ssrSwitches\":%u,\"energyWh\":%.2f,\"meanDutyPct\":%.2f}\n",
+         r.scenario, controller, coffeeConfig.tempUpdateInterval,
+         coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd,
+         r.riseTimeS, r.overshootC, r.settleTimeS, r.rmsErrorC,
+         r.maxDropC, r.ssrSwitches, r.energyWh, r.meanDuty);
+}
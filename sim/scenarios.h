@@ -0,0 +1,36 @@
+#ifndef SCENARIOS_H
+#define SCENARIOS_H
+
+#include <stdint.h>
+
+// ======= Benchmark Scenarios =======
+// Scripted runs used to compare controllers. Each scenario measures over its
+// own window (pre-heating phases are excluded) and reports KPIs of the true
+// boiler temperature:
+//   cold_start      22 -> brew setpoint, 15 min
+//   brew_to_steam   settled at brew, switch to steam, 15 min
+//   shots           settled at brew, 3 x 25 s shots 60 s apart, 5 min recovery
+//   noise           cold_start with 0.5 °C sensor noise
+
+struct ScenarioResult {
+  const char *scenario = "";
+  float riseTimeS = -1.0;     // -1 where the scenario has no setpoint step
+  float overshootC = 0.0;
+  float settleTimeS = -1.0;
+  float rmsErrorC = 0.0;      // Over the scenario's steady/recovery window
+  float maxDropC = 0.0;       // Largest dip below target (shots)
+  uint32_t ssrSwitches = 0;
+  float energyWh = 0.0;
+  float meanDuty = 0.0;
+};
+
+// Run a scenario by name on the current coffeeConfig; false if unknown
+bool runScenario(const char *name, ScenarioResult &result);
+
+// Print the result as one JSON object
+void printScenarioJson(const ScenarioResult &result, const char *controller);
+
+// Space-separated list of scenario names
+const char *scenarioNames();
+
+#endif // SCENARIOS_H
@@ -0,0 +1,63 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+// Host stand-in for the few Arduino/FreeRTOS pieces the control path uses.
+// Timing and I/O go through hal.h, so there is deliberately no millis(),
+// digitalWrite() or task API here.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#define HIGH 1
+#define LOW  0
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ======= String =======
+class String {
+public:
+  String(const char *text = "") : value(text) {}
+  const char *c_str() const { return value.c_str(); }
+  size_t length() const { return value.length(); }
+  bool operator==(const char *text) const { return value == text; }
+  bool operator==(const String &other) const { return value == other.value; }
+  bool operator!=(const char *text) const { return value != text; }
+
+private:
+  std::string value;
+};
+
+// ======= Serial =======
+// Silent unless the simulator is run with --verbose
+class HostSerial {
+public:
+  bool enabled = false;
+
+  void print(const char *text) { if (enabled) fputs(text, stdout); }
+  void print(const String &text) { print(text.c_str()); }
+  void println(const char *text = "") { if (enabled) puts(text); }
+  void println(const String &text) { println(text.c_str()); }
+  void printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    if (!enabled) return;
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+  }
+};
+
+extern HostSerial Serial;
+
+// ======= Critical Sections =======
+// The simulation is single-threaded
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
+
+#endif // SIM_ARDUINO_H
@@ -0,0 +1,104 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+// Host stand-in for the ESP32 Preferences (NVS) library: an in-memory store
+// that counts writes, so tests can check how often flash would be written.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+  typedef std::map<std::string, std::vector<uint8_t> > Store;
+
+  // ======= Test Access =======
+  static Store &store() {
+    static Store entries;
+    return entries;
+  }
+  static uint32_t &writes() {     // put*() calls that reached the store
+    static uint32_t count = 0;
+    return count;
+  }
+  static void reset() {
+    store().clear();
+    writes() = 0;
+  }
+
+  // ======= Library Interface =======
+  bool begin(const char *name, bool readOnly = false) {
+    space = name;
+    open = true;
+    return true;
+  }
+  void end() { open = false; }
+
+  bool clear() {
+    Store &entries = store();
+    std::string prefix = space + "/";
+    for (Store::iterator it = entries.begin(); it != entries.end();) {
+      if (it->first.compare(0, prefix.size(), prefix) == 0) {
+        entries.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    return true;
+  }
+  bool isKey(const char *key) { return find(key) != NULL; }
+
+  size_t putBytes(const char *key, const void *value, size_t length) {
+    if (!open) return 0;
+    const uint8_t *bytes = (const uint8_t *)value;
+    store()[space + "/" + key].assign(bytes, bytes + length);
+    writes()++;
+    return length;
+  }
+  size_t getBytesLength(const char *key) {
+    const std::vector<uint8_t> *entry = find(key);
+    return entry ? entry->size() : 0;
+  }
+  size_t getBytes(const char *key, void *buffer, size_t maxLength) {
+    const std::vector<uint8_t> *entry = find(key);
+    if (entry == NULL || entry->size() > maxLength) return 0;
+    memcpy(buffer, entry->data(), entry->size());
+    return entry->size();
+  }
+
+  size_t putFloat(const char *key, float value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putBool(const char *key, bool value) {
+    uint8_t byte = value;
+    return putBytes(key, &byte, 1);
+  }
+  float getFloat(const char *key, float fallback = 0.0) { return get(key, fallback); }
+  int32_t getInt(const char *key, int32_t fallback = 0) { return get(key, fallback); }
+  bool getBool(const char *key, bool fallback = false) {
+    uint8_t byte = fallback;
+    return get(key, byte) != 0;
+  }
+
+private:
+  std::string space;
+  bool open = false;
+
+  const std::vector<uint8_t> *find(const char *key) {
+    Store::const_iterator it = store().find(space + "/" + key);
+    return it != store().end() ? &it->second : NULL;
+  }
+
+  template <typename T>
+  T get(const char *key, T fallback) {
+    const std::vector<uint8_t> *entry = find(key);
+    if (entry == NULL || entry->size() != sizeof(T)) return fallback;
+    T value;
+    memcpy(&value, entry->data(), sizeof(T));
+    return value;
+  }
+};
+
+#endif // SIM_PREFERENCES_H
@@ -0,0 +1,29 @@
+#ifndef SIM_STUNE_H
+#define SIM_STUNE_H
+
+// Host stand-in for the sTune library. Autotune is not simulated: the tuner
+// never finishes sampling and never produces output.
+class sTune {
+public:
+  enum TuningMethod { ZN_PID, DampedOsc_PID, NoOvershoot_PID, CohenCoon_PID, Mixed_PID,
+                      ZN_PI, DampedOsc_PI, NoOvershoot_PI, CohenCoon_PI, Mixed_PI };
+  enum Action { directIP, direct5T, reverseIP, reverse5T };
+  enum SerialMode { printOFF, printALL, printSUMMARY, printDEBUG, printPIDTUNER };
+  enum TunerStatus { sample, test, tunings, runPid, timerPID };
+
+  sTune(float *input, float *output, TuningMethod method, Action action, SerialMode mode)
+    : output(output) {}
+
+  void Configure(float inputSpan, float outputSpan, float outputStart, float outputStep,
+                 uint32_t testTimeSec, uint32_t settleTimeSec, uint16_t samples) {}
+  void SetEmergencyStop(float limit) {}
+  uint8_t Run() { *output = 0.0; return sample; }
+  float GetKp() { return 0.0; }
+  float GetKi() { return 0.0; }
+  float GetKd() { return 0.0; }
+
+private:
+  float *output;
+};
+
+#endif // SIM_STUNE_H
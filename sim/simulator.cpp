@@ -0,0 +1,157 @@
+#include "simulator.h"
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+#include "control_task.h"
+#include "heater_output.h"
+#include "temperature.h"
+#include "pid_control.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "trace_recorder.h"
+#include "shared_state.h"
+
+// ======= Firmware Globals =======
+// Normally defined in main.cpp, which is not part of the native build
+CoffeeConfig coffeeConfig;
+SystemState systemState;
+HostSerial Serial;
+
+GrindStatus getGrindStatus() {
+  // No grinder in the simulation
+  return GrindStatus();
+}
+
+// ======= Simulation State =======
+static BoilerModel boiler;
+static uint64_t clockUs = (uint64_t)SIM_START_MS * 1000;
+static uint32_t elapsedMs = 0;
+static bool ssrState = false;
+static bool pumpState = false;
+static float pumpFlow = SIM_PUMP_FLOW_ML_S;
+static uint32_t ssrSwitches = 0;
+static uint32_t ssrOnMs = 0;
+static float drawMlPerS = 0.0;
+static std::vector<SimSample> trace;
+static bool recording = true;
+
+// ======= Hardware Abstraction =======
+uint32_t halMillis() {
+  return (uint32_t)(clockUs / 1000);
+}
+
+int64_t halMicros() {
+  return (int64_t)clockUs;
+}
+
+void halWriteSsr(bool on) {
+  if (on != ssrState) {
+    ssrState = on;
+    ssrSwitches++;
+  }
+}
+
+void halWritePump(bool on) {
+  pumpState = on;
+}
+
+bool halReadThermocouple(Max31855Frame &frame) {
+  return decodeMax31855Frame(boiler.thermocoupleFrame(), frame);
+}
+
+// ======= Simulation Loop =======
+void simBegin(const BoilerParams &params, float startC) {
+  boiler.reset(params, startC);
+  trace.clear();
+  ssrOnMs = 0;
+  initPID();
+  initTraceRecorder();
+  publishConfig();   // As startControlTask(): readers see the options set before the run
+}
+
+static float totalDraw() {
+  return drawMlPerS + (pumpState ? pumpFlow : 0.0);
+}
+
+static void recordSample() {
+  ControlSnapshot control = getControlSnapshot();
+  TemperatureReading reading = getTemperatureReading();
+
+  SimSample sample;
+  sample.ms = elapsedMs;
+  sample.waterC = boiler.waterC();
+  sample.sensorC = boiler.sensorC();
+  sample.filteredC = reading.valid ? reading.celsius : -999.0;
+  sample.targetC = control.cycleCount > 0 ? control.targetTemp
+                                          : (systemState.has(STATE_STEAM_MODE) ? coffeeConfig.steamTemp
+                                                                   : coffeeConfig.brewTemp);
+  sample.duty = getHeaterDuty();
+  sample.ssr = ssrState;
+  sample.ssrOnMs = ssrOnMs;
+  sample.drawMlPerS = totalDraw();
+  trace.push_back(sample);
+}
+
+void simRun(uint32_t durationMs) {
+  for (uint32_t t = 0; t < durationMs; t += HEATER_OUTPUT_TICK_MS) {
+    stepHeaterOutput();
+    stepShotEngine();
+    boiler.step(HEATER_OUTPUT_TICK_MS / 1000.0, ssrState, totalDraw());
+    // Counted here, not from the trace: trace samples fall on the same
+    // phase of every SSR window and miss short pulses
+    if (ssrState) ssrOnMs += HEATER_OUTPUT_TICK_MS;
+
+    clockUs += HEATER_OUTPUT_TICK_MS * 1000;
+    elapsedMs += HEATER_OUTPUT_TICK_MS;
+
+    if (elapsedMs % TEMP_SAMPLE_PERIOD_MS == 0) {
+      acquireTemperatureSample(TEMP_SAMPLE_PERIOD_MS / 1000.0);
+    }
+    if (elapsedMs % coffeeConfig.tempUpdateInterval == 0) {
+      stepControl();
+    }
+    if (recording && elapsedMs % SIM_TRACE_PERIOD_MS == 0) {
+      recordSample();
+    }
+  }
+}
+
+void simSetDraw(float mlPerS) {
+  drawMlPerS = mlPerS;
+}
+
+void simSetPumpFlow(float mlPerS) {
+  pumpFlow = mlPerS;
+}
+
+void simSetSensorOpen(bool open) {
+  boiler.setSensorOpen(open);
+}
+
+void simSetNoise(float sigmaC) {
+  boiler.setNoise(sigmaC);
+}
+
+void simSetRecording(bool on) {
+  recording = on;
+}
+
+const std::vector<SimSample> &simTrace() {
+  return trace;
+}
+
+uint32_t simElapsedMs() {
+  return elapsedMs;
+}
+
+uint32_t simSsrSwitches() {
+  return ssrSwitches;
+}
+
+uint32_t simSsrOnMs() {
+  return ssrOnMs;
+}
+
+float simEnergyJ() {
+  return boiler.energyJ();
+}
@@ -0,0 +1,57 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdint.h>
+#include <vector>
+#include "boiler_model.h"
+
+// ======= Simulation Settings =======
+// The simulated clock starts above zero: the PID treats a last-update time
+// of 0 as "never ran".
+#define SIM_START_MS        1000
+#define SIM_TRACE_PERIOD_MS 100    // One trace sample per acquisition period
+#define SIM_PUMP_FLOW_ML_S  2.0    // Default draw while the pump runs
+
+// One trace point, taken after each acquisition sample
+struct SimSample {
+  uint32_t ms = 0;          // Since the start of the run
+  float waterC = 0.0;       // True boiler temperature
+  float sensorC = 0.0;      // Thermocouple junction temperature
+  float filteredC = 0.0;    // What the controller sees
+  float targetC = 0.0;
+  float duty = 0.0;         // Requested SSR duty (0-100%)
+  bool ssr = false;         // SSR output at the end of the period
+  uint32_t ssrOnMs = 0;     // SSR on-time since simBegin(), counted every output tick
+  float drawMlPerS = 0.0;   // Total draw, including the pump
+};
+
+// ======= Simulator =======
+// Runs the real acquisition, control and SSR output code against the boiler
+// model on a simulated clock: the output stage and shot engine every
+// HEATER_OUTPUT_TICK_MS,
+// acquisition every TEMP_SAMPLE_PERIOD_MS and the control cycle every
+// coffeeConfig.tempUpdateInterval, as the tasks do on the device.
+
+// Start a run (call once per process; controller state is not reset)
+void simBegin(const BoilerParams &params, float startC);
+
+// Advance the simulation
+void simRun(uint32_t durationMs);
+
+// Disturbances
+void simSetDraw(float mlPerS);
+void simSetPumpFlow(float mlPerS);   // Draw while the shot engine runs the pump
+void simSetSensorOpen(bool open);
+void simSetNoise(float sigmaC);
+
+// Stop appending to simTrace() (long runs)
+void simSetRecording(bool on);
+
+// Results
+const std::vector<SimSample> &simTrace();
+uint32_t simElapsedMs();
+uint32_t simSsrSwitches();
+uint32_t simSsrOnMs();      // Since simBegin(), counted every output tick
+float simEnergyJ();
+
+#endif // SIMULATOR_H
@@ -0,0 +1,486 @@
+#include "autotune.h"
+#include <atomic>
+#include <sTune.h>
+#include "heater_output.h"
+#include "hal.h"
+
+// Forward declaration for saving configuration
+void saveConfiguration();
+
+// ======= Gain Rule =======
+// Tyreus-Luyben PID from Ku/Pu (Kp = Ku/2.2, Ti = 2.2 Pu, Td = Pu/6.3):
+// Ziegler-Nichols (0.6 Ku, Ti = Pu/2) rings on a boiler whose element lags
+// the water by most of a period. Td is capped because the derivative of a
+// 0.25 °C resolution signal mostly amplifies noise beyond a few seconds.
+#define AUTOTUNE_KP_PER_KU   0.45
+#define AUTOTUNE_TI_PER_PU   2.2
+#define AUTOTUNE_TD_PER_PU   0.16
+#define AUTOTUNE_TD_MAX_S    3.0
+
+// ======= Requests =======
+// Written by any task, consumed by the control task
+static std::atomic<int> startRequest(-1);
+static std::atomic<bool> cancelRequest(false);
+static std::atomic<bool> active(false);
+
+// ======= Run State (control task only) =======
+static AutotuneStatus run;
+static uint32_t runStartMs = 0;
+
+static float tuneInput = 0.0;
+static float tuneOutput = 0.0;
+static sTune tuner = sTune(&tuneInput, &tuneOutput, sTune::ZN_PID, sTune::directIP, sTune::printOFF);
+
+static bool relayOn = false;
+static uint32_t relayLastSwitchMs = 0;
+static uint32_t relayLastOnMs = 0;     // Start of the cycle in progress (0 = none yet)
+static float cycleMaxC = 0.0;
+static float cycleMinC = 0.0;
+static uint32_t cycleOnMs = 0;
+static float periodsS[AUTOTUNE_RELAY_MAX_CYCLES];
+static float amplitudesC[AUTOTUNE_RELAY_MAX_CYCLES];
+static float dutiesPct[AUTOTUNE_RELAY_MAX_CYCLES];
+
+static float testTarget = 0.0;
+static PIDGains testGains;
+static uint32_t testStartMs = 0;
+static uint32_t testLastOutsideMs = 0;
+static float testPeakC = 0.0;
+static float holdDutyPct = 0.0;        // Estimated holding power at the setpoint
+
+// Published copy for other tasks
+static portMUX_TYPE autotuneMux = portMUX_INITIALIZER_UNLOCKED;
+static AutotuneStatus published;
+
+static void publish() {
+  portENTER_CRITICAL(&autotuneMux);
+  published = run;
+  portEXIT_CRITICAL(&autotuneMux);
+}
+
+static void setOperation(Operation op) {
+  systemState.operation = op;
+  systemState.operationStartMs = halMillis();
+}
+
+// ======= Run Control =======
+static void finish(AutotuneResult result, const char *message) {
+  if (run.phase == AUTOTUNE_IDLE) return;
+
+  run.phase = AUTOTUNE_IDLE;
+  run.result = result;
+  run.message = message;
+  run.remainingMs = 0;
+  active = false;
+  publish();
+
+  setHeatingElement(false);
+  setOperation(OP_IDLE);
+  Serial.printf("=== AutoTune %s: %s ===\n", autotuneResultName(result), message);
+}
+
+static void begin(AutotuneMethod method) {
+  cancelRequest = false;
+  run = AutotuneStatus();
+  run.method = method;
+  run.steam = systemState.has(STATE_STEAM_MODE);
+  run.setpoint = systemState.targetTemp;
+  run.cyclesNeeded = AUTOTUNE_RELAY_SKIP + AUTOTUNE_RELAY_CYCLES;
+  holdDutyPct = 0.0;
+  if (run.steam) {
+    run.previous.kp = coffeeConfig.steamKp;
+    run.previous.ki = coffeeConfig.steamKi;
+    run.previous.kd = coffeeConfig.steamKd;
+  } else {
+    run.previous.kp = coffeeConfig.pidKp;
+    run.previous.ki = coffeeConfig.pidKi;
+    run.previous.kd = coffeeConfig.pidKd;
+  }
+  runStartMs = halMillis();
+
+  if (method == AUTOTUNE_METHOD_STEP) {
+    // Configure autotune for espresso machine
+    tuner.Configure(50.0,     // Input span (temperature range, e.g., 50°C)
+                    255.0,    // Output span (0-255)
+                    0.0,      // Output start
+                    128.0,    // Output step (50% of range)
+                    10,       // Test time (seconds)
+                    10,       // Settle time (seconds)
+                    300);     // Samples
+    tuner.SetEmergencyStop(run.setpoint + AUTOTUNE_EMERGENCY_C);
+    run.phase = AUTOTUNE_STEP_RESPONSE;
+    setOperation(OP_AUTOTUNE_STEP);
+  } else {
+    relayOn = systemState.currentTemp < run.setpoint;
+    relayLastSwitchMs = runStartMs;
+    relayLastOnMs = 0;
+    setHeaterDuty(relayOn ? AUTOTUNE_RELAY_DUTY_PCT : 0.0);
+    run.phase = AUTOTUNE_RELAY;
+    setOperation(OP_AUTOTUNE_RELAY);
+  }
+  active = true;
+  publish();
+
+  Serial.printf("=== PID AutoTune Started (%s, %s set) ===\n",
+                method == AUTOTUNE_METHOD_STEP ? "step" : "relay", run.steam ? "steam" : "brew");
+  Serial.printf("Target Temperature: %.2f°C\n", run.setpoint);
+}
+
+// ======= Step Tests =======
+static void beginTest(AutotunePhase phase, float target, const PIDGains &gains) {
+  run.phase = phase;
+  testTarget = target;
+  testGains = gains;
+  testStartMs = halMillis();
+  testLastOutsideMs = testStartMs;
+  testPeakC = systemState.currentTemp;
+
+  // Every set starts from the holding power, not from the integral the
+  // previous phase left behind
+  setHeaterDuty(holdDutyPct);
+  resetPID();
+
+  switch (phase) {
+    case AUTOTUNE_SETTLE:
+    case AUTOTUNE_RESETTLE:         setOperation(OP_AUTOTUNE_SETTLE); break;
+    case AUTOTUNE_TEST_CANDIDATE:   setOperation(OP_AUTOTUNE_TEST_NEW); break;
+    default:                        setOperation(OP_AUTOTUNE_TEST_PREVIOUS); break;
+  }
+}
+
+static void beginValidation() {
+  Serial.printf("AutoTune candidate: Kp=%.3f, Ki=%.4f, Kd=%.2f\n",
+                run.candidate.kp, run.candidate.ki, run.candidate.kd);
+  beginTest(AUTOTUNE_SETTLE, run.setpoint, run.candidate);
+}
+
+static void decide() {
+  const StepTestResult &prev = run.previousTest;
+  const StepTestResult &cand = run.candidateTest;
+  Serial.printf("AutoTune step tests: previous %.2f C / %.0f s, new %.2f C / %.0f s\n",
+                prev.overshootC, prev.settleS, cand.overshootC, cand.settleS);
+
+  if (prev.settleS >= 0.0 &&
+      (cand.overshootC > prev.overshootC + AUTOTUNE_OVERSHOOT_TOL_C || cand.settleS > prev.settleS)) {
+    finish(AUTOTUNE_RESULT_REJECTED, "Previous gains performed better");
+    return;
+  }
+
+  updatePIDTunings(run.steam, run.candidate.kp, run.candidate.ki, run.candidate.kd);
+  if (run.model.gain > 0.0) {
+    coffeeConfig.modelGain = run.model.gain;
+    coffeeConfig.modelTauS = run.model.tauS;
+    coffeeConfig.modelDeadTimeS = run.model.deadTimeS;
+  }
+  saveConfiguration();
+  finish(AUTOTUNE_RESULT_SAVED, run.model.gain > 0.0 ? "New gains and boiler model saved"
+                                                     : "New gains saved");
+}
+
+// Relay runs only: Ku/Pu plus the holding power describe the boiler well
+// enough for the Smith predictor. Kept in the run until decide() accepts
+// the gains it was measured with.
+static void identifyModel() {
+  if (run.method != AUTOTUNE_METHOD_RELAY) return;
+  FopdtModel model;
+  if (!identifyFopdt(run.ku, run.puS, run.setpoint, holdDutyPct, model)) {
+    Serial.println("AutoTune: no boiler model from this run");
+    return;
+  }
+  Serial.printf("AutoTune boiler model: K=%.2f C/%%, tau=%.0f s, dead time=%.1f s\n",
+                model.gain, model.tauS, model.deadTimeS);
+  if (!smithDeadTimeFits(model.deadTimeS, coffeeConfig.tempUpdateInterval)) {
+    Serial.println("AutoTune: dead time too long for the Smith predictor, model not kept");
+    return;
+  }
+  run.model = model;
+}
+
+static void updateTest(uint32_t now) {
+  float temp = systemState.currentTemp;
+  updatePIDControlWithGains(temp, systemState.tempDerivative, testTarget, testGains);
+
+  if (temp > testPeakC) testPeakC = temp;
+  if (fabsf(temp - testTarget) > AUTOTUNE_SETTLE_BAND_C) testLastOutsideMs = now;
+
+  // A set that runs away fails its test early instead of ending the whole
+  // run at the emergency limit. The re-settle starts above its target and
+  // can only cool towards it.
+  bool runaway = run.phase != AUTOTUNE_RESETTLE && temp > testTarget + AUTOTUNE_TEST_ABORT_C;
+  bool settled = !runaway && now - testLastOutsideMs >= AUTOTUNE_SETTLE_HOLD_MS;
+  uint32_t timeoutMs = run.phase == AUTOTUNE_RESETTLE ? AUTOTUNE_RESETTLE_TIMEOUT_MS
+                                                      : AUTOTUNE_TEST_TIMEOUT_MS;
+  if (!settled && !runaway && now - testStartMs < timeoutMs) return;
+
+  StepTestResult result;
+  result.overshootC = testPeakC > testTarget ? testPeakC - testTarget : 0.0;
+  result.settleS = settled ? (testLastOutsideMs - testStartMs) / 1000.0 : -1.0;
+
+  // The new set goes first: if it cannot hold the setpoint or settle after
+  // the step, the previous set need not be tested (and cannot be disturbed
+  // by the heat a runaway leaves in the element). Otherwise the new set
+  // brings the boiler back to the setpoint, so the previous set makes the
+  // same step from the same settled state.
+  switch (run.phase) {
+    case AUTOTUNE_SETTLE:
+      if (!settled) {
+        finish(AUTOTUNE_RESULT_REJECTED, "New gains did not hold the setpoint");
+        break;
+      }
+      holdDutyPct = getHeaterDuty();
+      identifyModel();
+      beginTest(AUTOTUNE_TEST_CANDIDATE, run.setpoint + AUTOTUNE_STEP_C, run.candidate);
+      break;
+    case AUTOTUNE_TEST_CANDIDATE:
+      run.candidateTest = result;
+      if (!settled) {
+        finish(AUTOTUNE_RESULT_REJECTED, "New gains did not settle");
+        break;
+      }
+      beginTest(AUTOTUNE_RESETTLE, run.setpoint, run.candidate);
+      break;
+    case AUTOTUNE_RESETTLE:
+      if (!settled) {
+        finish(AUTOTUNE_RESULT_REJECTED, "New gains did not return to the setpoint");
+        break;
+      }
+      holdDutyPct = getHeaterDuty();
+      beginTest(AUTOTUNE_TEST_PREVIOUS, run.setpoint + AUTOTUNE_STEP_C, run.previous);
+      break;
+    default:
+      run.previousTest = result;
+      decide();
+      break;
+  }
+}
+
+// ======= Relay Oscillation =======
+static bool spreadOk(const float *values, int from, int count) {
+  float lo = values[from], hi = values[from], sum = 0.0;
+  for (int i = from; i < from + count; i++) {
+    if (values[i] < lo) lo = values[i];
+    if (values[i] > hi) hi = values[i];
+    sum += values[i];
+  }
+  return sum > 0.0 && (hi - lo) <= AUTOTUNE_RELAY_SPREAD * sum / count;
+}
+
+static float mean(const float *values, int from, int count) {
+  float sum = 0.0;
+  for (int i = from; i < from + count; i++) sum += values[i];
+  return sum / count;
+}
+
+static void completeCycle(uint32_t now) {
+  int n = run.cycles;
+  periodsS[n] = (now - relayLastOnMs) / 1000.0;
+  amplitudesC[n] = (cycleMaxC - cycleMinC) / 2.0;
+  dutiesPct[n] = AUTOTUNE_RELAY_DUTY_PCT * cycleOnMs / (now - relayLastOnMs);
+  run.cycles++;
+  Serial.printf("AutoTune relay cycle %d: period %.1f s, amplitude %.2f C\n",
+                run.cycles, periodsS[n], amplitudesC[n]);
+
+  if (run.cycles < AUTOTUNE_RELAY_SKIP + AUTOTUNE_RELAY_CYCLES) return;
+
+  int from = run.cycles - AUTOTUNE_RELAY_CYCLES;
+  if (!spreadOk(periodsS, from, AUTOTUNE_RELAY_CYCLES) ||
+      !spreadOk(amplitudesC, from, AUTOTUNE_RELAY_CYCLES)) {
+    if (run.cycles >= AUTOTUNE_RELAY_MAX_CYCLES) {
+      finish(AUTOTUNE_RESULT_FAILED, "Oscillation did not settle");
+    } else {
+      run.cyclesNeeded = run.cycles + 1;
+    }
+    return;
+  }
+
+  // Describing function of a relay with hysteresis: Ku = 4d / (pi * sqrt(a^2 - eps^2)),
+  // with d the relay half-swing in PID output units (0-255)
+  float amplitude = mean(amplitudesC, from, AUTOTUNE_RELAY_CYCLES);
+  float eps = AUTOTUNE_RELAY_HYST_C;
+  if (amplitude <= eps) {
+    finish(AUTOTUNE_RESULT_FAILED, "Oscillation smaller than the hysteresis");
+    return;
+  }
+  float d = AUTOTUNE_RELAY_DUTY_PCT * 2.55 / 2.0;
+  run.ku = 4.0 * d / (M_PI * sqrtf(amplitude * amplitude - eps * eps));
+  run.puS = mean(periodsS, from, AUTOTUNE_RELAY_CYCLES);
+
+  float kp = AUTOTUNE_KP_PER_KU * run.ku;
+  run.candidate.kp = kp;
+  run.candidate.ki = kp / (AUTOTUNE_TI_PER_PU * run.puS);
+  run.candidate.kd = kp * fminf(AUTOTUNE_TD_PER_PU * run.puS, AUTOTUNE_TD_MAX_S);
+  Serial.printf("AutoTune relay: Ku=%.2f, Pu=%.1f s\n", run.ku, run.puS);
+
+  holdDutyPct = mean(dutiesPct, from, AUTOTUNE_RELAY_CYCLES);
+  beginValidation();
+}
+
+static void updateRelay(uint32_t now) {
+  float temp = systemState.currentTemp;
+
+  if (relayOn && temp > run.setpoint + AUTOTUNE_RELAY_HYST_C) {
+    relayOn = false;
+    relayLastSwitchMs = now;
+    cycleOnMs = now - relayLastOnMs;
+    setHeaterDuty(0.0);
+  } else if (!relayOn && temp < run.setpoint - AUTOTUNE_RELAY_HYST_C) {
+    relayOn = true;
+    relayLastSwitchMs = now;
+    setHeaterDuty(AUTOTUNE_RELAY_DUTY_PCT);
+    // A cycle runs from one switch-on to the next
+    if (relayLastOnMs != 0) {
+      completeCycle(now);
+      if (run.phase != AUTOTUNE_RELAY) return;
+    }
+    relayLastOnMs = now;
+    cycleMaxC = cycleMinC = temp;
+  }
+
+  if (temp > cycleMaxC) cycleMaxC = temp;
+  if (temp < cycleMinC) cycleMinC = temp;
+
+  if (now - relayLastSwitchMs > AUTOTUNE_TEST_TIMEOUT_MS) {
+    finish(AUTOTUNE_RESULT_FAILED, "No oscillation (relay duty too low?)");
+  }
+}
+
+// ======= Step Response (sTune) =======
+static void updateStepResponse() {
+  tuneInput = systemState.currentTemp;
+
+  switch (tuner.Run()) {
+    case tuner.sample:
+      // Still sampling, control output based on tuner
+      // The output is stored in the tuneOutput variable by reference
+      setHeaterDuty((tuneOutput / 255.0) * 100.0);
+      break;
+
+    case tuner.tunings:
+      Serial.println("AutoTune sampling complete!");
+      run.candidate.kp = tuner.GetKp();
+      run.candidate.ki = tuner.GetKi();
+      run.candidate.kd = tuner.GetKd();
+      beginValidation();
+      break;
+
+    case tuner.runPid:
+      // Should not happen during autotune
+      break;
+  }
+}
+
+// ======= Progress =======
+// Each remaining test is assumed to take two ultimate periods plus the
+// settle hold; without Pu (step method) the test timeout is the bound.
+static int32_t estimateRemainingMs(uint32_t now) {
+  uint32_t testMs = run.puS > 0.0 ? (uint32_t)(2.0 * run.puS * 1000.0) + AUTOTUNE_SETTLE_HOLD_MS
+                                   : AUTOTUNE_TEST_TIMEOUT_MS;
+  uint32_t inTestMs = now - testStartMs;
+  uint32_t currentMs = testMs > inTestMs ? testMs - inTestMs : 0;
+
+  switch (run.phase) {
+    case AUTOTUNE_RELAY: {
+      if (run.cycles == 0) return -1;
+      float periodS = mean(periodsS, 0, run.cycles);
+      uint32_t relayMs = (uint32_t)((run.cyclesNeeded - run.cycles) * periodS * 1000.0);
+      testMs = (uint32_t)(2.0 * periodS * 1000.0) + AUTOTUNE_SETTLE_HOLD_MS;
+      return relayMs + 4 * testMs;
+    }
+    case AUTOTUNE_SETTLE:          return currentMs + 3 * testMs;
+    case AUTOTUNE_TEST_CANDIDATE:  return currentMs + 2 * testMs;
+    case AUTOTUNE_RESETTLE:        return currentMs + testMs;
+    case AUTOTUNE_TEST_PREVIOUS:   return currentMs;
+    default:                       return -1;
+  }
+}
+
+// ======= Public Interface =======
+bool startAutotune(AutotuneMethod method) {
+  if (isAutotuning()) return false;
+  startRequest = method;
+  return true;
+}
+
+void stopAutotune() {
+  startRequest = -1;
+  if (active) cancelRequest = true;
+}
+
+void abortAutotune(const char *reason) {
+  startRequest = -1;
+  finish(AUTOTUNE_RESULT_FAILED, reason);
+}
+
+void updateAutotune() {
+  int method = startRequest.exchange(-1);
+  if (method >= 0 && run.phase == AUTOTUNE_IDLE) {
+    begin((AutotuneMethod)method);
+  }
+  if (run.phase == AUTOTUNE_IDLE) return;
+
+  if (cancelRequest.exchange(false)) {
+    finish(AUTOTUNE_RESULT_CANCELLED, "Cancelled");
+    return;
+  }
+
+  uint32_t now = halMillis();
+  run.elapsedMs = now - runStartMs;
+  if (systemState.currentTemp > run.setpoint + AUTOTUNE_EMERGENCY_C) {
+    finish(AUTOTUNE_RESULT_FAILED, "Emergency stop (over temperature)");
+    return;
+  }
+  if (run.elapsedMs > AUTOTUNE_TIMEOUT_MS) {
+    finish(AUTOTUNE_RESULT_FAILED, "Timeout");
+    return;
+  }
+
+  switch (run.phase) {
+    case AUTOTUNE_STEP_RESPONSE:
+      updateStepResponse();
+      break;
+    case AUTOTUNE_RELAY:
+      updateRelay(now);
+      break;
+    default:
+      updateTest(now);
+      break;
+  }
+
+  if (run.phase != AUTOTUNE_IDLE) {
+    run.remainingMs = estimateRemainingMs(now);
+    publish();
+  }
+}
+
+bool isAutotuning() {
+  return active || startRequest >= 0;
+}
+
+AutotuneStatus getAutotuneStatus() {
+  portENTER_CRITICAL(&autotuneMux);
+  AutotuneStatus copy = published;
+  portEXIT_CRITICAL(&autotuneMux);
+  return copy;
+}
+
+const char *autotunePhaseName(AutotunePhase phase) {
+  switch (phase) {
+    case AUTOTUNE_STEP_RESPONSE:   return "step_response";
+    case AUTOTUNE_RELAY:           return "relay";
+    case AUTOTUNE_SETTLE:          return "settle";
+    case AUTOTUNE_TEST_CANDIDATE:  return "test_candidate";
+    case AUTOTUNE_RESETTLE:        return "resettle";
+    case AUTOTUNE_TEST_PREVIOUS:   return "test_previous";
+    default:                       return "idle";
+  }
+}
+
+const char *autotuneResultName(AutotuneResult result) {
+  switch (result) {
+    case AUTOTUNE_RESULT_SAVED:      return "saved";
+    case AUTOTUNE_RESULT_REJECTED:   return "rejected";
+    case AUTOTUNE_RESULT_FAILED:     return "failed";
+    case AUTOTUNE_RESULT_CANCELLED:  return "cancelled";
+    default:                         return "none";
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pid_control.h"
+#include "smith_predictor.h"
+
+// ======= Autotune Settings =======
+// Two ways to find gains for the set of the current mode (brew or steam):
+//   relay - Astrom-Hagglund relay feedback around the actual setpoint. The
+//           heater switches between 0 and AUTOTUNE_RELAY_DUTY_PCT on the
+//           temperature crossing setpoint +/- hysteresis; the oscillation's
+//           amplitude and period give the ultimate gain Ku and period Pu.
+//   step   - sTune open-loop step response (the original method)
+// Either way the new gains are only saved if a closed-loop step test beats
+// the gains they would replace. Both sets make the same step, setpoint to
+// setpoint + AUTOTUNE_STEP_C, from the boiler settled at the setpoint: the
+// new set settles there, steps, returns and settles again, then the
+// previous set steps.
+// A relay run also fits the Smith predictor's boiler model once the new set
+// has found the holding power; the model is saved with the new gains, only
+// if they pass the tests.
+#define AUTOTUNE_RELAY_DUTY_PCT    60.0     // Relay "on" duty (must exceed holding power)
+#define AUTOTUNE_RELAY_HYST_C      0.3      // Switching hysteresis around the setpoint
+#define AUTOTUNE_RELAY_SKIP        1        // First cycles are the approach, not measured
+#define AUTOTUNE_RELAY_CYCLES      3        // Consistent cycles needed for a result
+#define AUTOTUNE_RELAY_MAX_CYCLES  10
+#define AUTOTUNE_RELAY_SPREAD      0.15     // Allowed period/amplitude spread of those cycles
+#define AUTOTUNE_STEP_C            3.0      // Validation setpoint step
+#define AUTOTUNE_SETTLE_BAND_C     0.5      // Settled = inside target +/- this ...
+#define AUTOTUNE_SETTLE_HOLD_MS    30000    // ... for this long
+#define AUTOTUNE_TEST_TIMEOUT_MS   300000   // Per step test (and the initial settle)
+#define AUTOTUNE_RESETTLE_TIMEOUT_MS 900000 // Back to the setpoint: the boiler only cools passively
+#define AUTOTUNE_OVERSHOOT_TOL_C   0.25     // Thermocouple resolution
+#define AUTOTUNE_TEST_ABORT_C      3.0      // A test fails above its target + this
+#define AUTOTUNE_EMERGENCY_C       10.0     // Abort above setpoint + this
+#define AUTOTUNE_TIMEOUT_MS        1800000  // Whole run, including validation
+
+enum AutotuneMethod {
+  AUTOTUNE_METHOD_RELAY = 0,
+  AUTOTUNE_METHOD_STEP = 1
+};
+
+enum AutotunePhase {
+  AUTOTUNE_IDLE = 0,
+  AUTOTUNE_STEP_RESPONSE,    // sTune sampling
+  AUTOTUNE_RELAY,            // Relay oscillation
+  AUTOTUNE_SETTLE,           // New gains at the setpoint, before the tests
+  AUTOTUNE_TEST_CANDIDATE,   // Step test with the new gains
+  AUTOTUNE_RESETTLE,         // New gains back at the setpoint
+  AUTOTUNE_TEST_PREVIOUS     // Step test with the previous gains
+};
+
+enum AutotuneResult {
+  AUTOTUNE_RESULT_NONE = 0,
+  AUTOTUNE_RESULT_SAVED,       // New gains beat the previous set
+  AUTOTUNE_RESULT_REJECTED,    // Previous gains kept
+  AUTOTUNE_RESULT_FAILED,      // No usable oscillation, timeout, sensor fault, ...
+  AUTOTUNE_RESULT_CANCELLED
+};
+
+// Closed-loop step test: overshoot above the stepped setpoint and the time
+// until the temperature stayed inside the settle band (-1 = never)
+struct StepTestResult {
+  float overshootC = 0.0;
+  float settleS = -1.0;
+};
+
+struct AutotuneStatus {
+  AutotunePhase phase = AUTOTUNE_IDLE;
+  AutotuneMethod method = AUTOTUNE_METHOD_RELAY;
+  bool steam = false;             // Set being tuned
+  float setpoint = 0.0;
+  uint8_t cycles = 0;             // Relay cycles completed
+  uint8_t cyclesNeeded = 0;       // Lower bound until the cycles agree
+  uint32_t elapsedMs = 0;
+  int32_t remainingMs = -1;       // Estimate (-1 = unknown yet)
+  float ku = 0.0;                 // Ultimate gain (0-255 output per °C)
+  float puS = 0.0;                // Ultimate period
+  FopdtModel model;               // Boiler model fitted to the relay test (gain 0 = none)
+  PIDGains previous;
+  PIDGains candidate;
+  StepTestResult previousTest;
+  StepTestResult candidateTest;
+  AutotuneResult result = AUTOTUNE_RESULT_NONE;
+  const char *message = "";       // Reason for the last result
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Request a run or a cancellation from any task; the control task picks it
+// up at its next cycle. Start returns false if a run is already active.
+bool startAutotune(AutotuneMethod method);
+void stopAutotune();
+
+// Control task only: one autotune cycle (valid temperature), or abort the
+// run (sensor fault)
+void updateAutotune();
+void abortAutotune(const char *reason);
+
+bool isAutotuning();
+AutotuneStatus getAutotuneStatus();
+
+const char *autotunePhaseName(AutotunePhase phase);
+const char *autotuneResultName(AutotuneResult result);
+
+#endif // AUTOTUNE_H
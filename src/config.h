@@ -2,6 +2,7 @@
 #define CONFIG_H
 
 #include <Arduino.h>
+#include <type_traits>
 
 // Coffee Station Configuration Structure
 struct CoffeeConfig {
@@ -13,41 +14,122 @@ struct CoffeeConfig {
   float shotSizes[4] = {15.0, 25.0, 35.0, 45.0};  // Small, Medium, Large, Extra Large
   const char* shotNames[4] = {"Small", "Medium", "Large", "XL"};
   
+  // Shot profile (part of the shot length above)
+  int shotPreinfusionMs = 3000;    // Gentle pre-infusion at reduced pump duty
+  int shotPreinfusionDuty = 40;    // Pump duty during pre-infusion (%)
+  int shotRampMs = 2000;           // Ramp from pre-infusion duty to full
+  
+  // Shot feed-forward: heater boost while the pump runs (see feed_forward.h)
+  bool ffEnable = true;
+  bool ffLearn = true;             // Adapt the boost from each shot's droop
+  float ffBoostPct[4] = {30.0, 30.0, 30.0, 30.0};  // Boost per shot size (%)
+  int ffTailMs = 4000;             // Fade-out after the pump stops
+  
   // Grind amounts (grinder run time in seconds)
   float grindTimes[2] = {12.0, 18.0};  // Single shot, Double shot
   const char* grindNames[2] = {"Single", "Double"};
+  int grindMode = 0;                   // 0 = timed, 1 = dose from learned rate
+  float grindDoses[2] = {9.0, 18.0};   // Target dose (g) in dose mode
+  float grindRates[2] = {0.0, 0.0};    // Learned grinder output (g/s, 0 = not learned)
+  
+  // PID parameters at brewTemp, and at steamTemp (interpolated in between)
+  float pidKp = 15.0;
+  float pidKi = 0.2;
+  float pidKd = 60.0;
+  float steamKp = 25.0;
+  float steamKi = 0.4;
+  float steamKd = 200.0;
+  int controlMode = 0;  // 0 = on/off, 1 = PID, 2 = Smith predictor
   
-  // PID parameters
-  float pidKp = 2.0;
-  float pidKi = 5.0;
-  float pidKd = 1.0;
-  bool usePID = false;  // false = on/off control, true = PID control
+  // Boiler model for the Smith predictor (see smith_predictor.h)
+  float modelGain = 12.8;        // °C above ambient per % duty
+  float modelTauS = 6400.0;      // Time constant
+  float modelDeadTimeS = 28.0;   // Element/sensor dead time
+  float smithLambdaS = 20.0;     // Closed-loop time constant (0 = tau)
+  
+  // SSR time-proportioning output (PID mode)
+  int ssrWindowMs = 1000;      // Duty cycle window length
+  int ssrMinSwitchMs = 20;     // Minimum on/off time (2 mains half-cycles)
   
   // System settings
   bool enableInfluxDB = true;
+  bool telemetrySpoolFlash = false;  // Spill offline telemetry to LittleFS
+  bool healthRestart = false;        // Restart on a lasting memory alert while idle
   int tempUpdateInterval = 2000;   // milliseconds (2 seconds)
+  int eventIntervalMs = 250;       // Minimum time between /api/events pushes
+  
+  // Temperature filter (samples taken every 100 ms)
+  int tempMedianSize = 5;          // Median-of-N spike rejection (odd, 1-9)
+  int tempFilterMode = 0;          // 0 = EMA, 1 = Kalman
+  float tempFilterAlpha = 0.3;     // EMA smoothing factor
+  float tempKalmanQ = 0.01;        // Kalman process noise
+  
+  // Touch screen calibration (see touch_calibration.h); the defaults are
+  // the fixed raw 300-3800 mapping used before calibration existed
+  float touchCal[6] = {-0.0685714, 0.0, 260.5714, 0.0, -0.0914286, 347.4286};
+  bool touchCalibrated = false;    // Run the calibration screen at boot until set
   
   // Network settings (for future use)
   char customSSID[32] = "";
   char customPassword[64] = "";
 };
 
-// Current system state
+// ======= System State =======
+// Runtime state, written by the control task only (see shared_state.h).
+// Plain data without heap members: the control snapshot takes it with a
+// memcpy, and status text comes from the name tables below rather than
+// strings stored in the state.
+enum Operation : uint8_t {
+  OP_IDLE = 0,
+  OP_BREW_MODE,
+  OP_STEAM_MODE,
+  OP_AUTOTUNE_STEP,
+  OP_AUTOTUNE_RELAY,
+  OP_AUTOTUNE_SETTLE,
+  OP_AUTOTUNE_TEST_NEW,
+  OP_AUTOTUNE_TEST_PREVIOUS,
+  OP_COUNT
+};
+
+// SystemState flags
+#define STATE_HEATING      0x01   // Heating element requested on
+#define STATE_STEAM_MODE   0x02
+#define STATE_PUMP         0x04   // Shot running with the pump on
+#define STATE_GRINDER      0x08
+
 struct SystemState {
   float currentTemp = 0.0;
+  float tempDerivative = 0.0;  // Filtered rate of change (°C/s)
   float targetTemp = 0.0;
-  bool heatingElement = false;
-  bool heating = false;  // Display-friendly heating state
-  bool pump = false;
-  bool grinder = false;
-  bool steamMode = false;
-  String currentOperation = "Idle";
-  unsigned long operationStartTime = 0;
+  uint32_t operationStartMs = 0;
+  uint8_t flags = 0;           // STATE_*
+  Operation operation = OP_IDLE;
   
   // Display selections
-  int selectedShotSize = 0;    // 0-3 for shot sizes
-  int selectedGrindTime = 0;   // 0-1 for grind times
+  uint8_t selectedShotSize = 0;    // 0-3 for shot sizes
+  uint8_t selectedGrindTime = 0;   // 0-1 for grind times
+  
+  bool has(uint8_t flag) const { return (flags & flag) != 0; }
+  void set(uint8_t flag, bool on) { flags = on ? (flags | flag) : (flags & ~flag); }
 };
 
+static_assert(std::is_trivially_copyable<SystemState>::value,
+              "SystemState is copied with memcpy");
+
+inline const char *operationName(Operation op) {
+  static const char *const names[] = {
+    "Idle",
+    "Brew Mode",
+    "Steam Mode",
+    "AutoTune: step response",
+    "AutoTune: relay",
+    "AutoTune: settling",
+    "AutoTune: test new",
+    "AutoTune: test previous",
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == OP_COUNT, "one name per Operation");
+  return op < OP_COUNT ? names[op] : "Unknown";
+}
+
 #endif // CONFIG_H
 
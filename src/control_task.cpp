@@ -0,0 +1,253 @@
+#include "control_task.h"
+#include <atomic>
+#include "temperature.h"
+#include "pid_control.h"
+#include "autotune.h"
+#include "heater_output.h"
+#include "feed_forward.h"
+#include "trace_recorder.h"
+#include "shared_state.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "hal.h"
+
+// ======= Control Task State =======
+static std::atomic<bool> timingResetRequested(false);
+
+// Owned by the control task only
+static ControlTiming timing;
+static uint32_t cycleCount = 0;
+
+// ======= Snapshot Publication (seqlock) =======
+// Single writer (control task), any number of readers. Readers retry if the
+// sequence number was odd or changed while they copied the snapshot.
+static ControlSnapshot snapshot;
+static std::atomic<uint32_t> snapshotSeq(0);
+static std::atomic<uint32_t> snapshotReads(0);
+static std::atomic<uint32_t> snapshotRetries(0);
+
+static void publishSnapshot(const ControlSnapshot& next) {
+  uint32_t seq = snapshotSeq.load(std::memory_order_relaxed);
+  snapshotSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  snapshot = next;
+  snapshotSeq.store(seq + 2, std::memory_order_release);
+}
+
+ControlSnapshot getControlSnapshot() {
+  ControlSnapshot copy;
+  uint32_t before, after;
+  snapshotReads.fetch_add(1, std::memory_order_relaxed);
+  for (;;) {
+    before = snapshotSeq.load(std::memory_order_acquire);
+    copy = snapshot;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = snapshotSeq.load(std::memory_order_relaxed);
+    if (!(before & 1) && before == after) break;
+    snapshotRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+  return copy;
+}
+
+void getSnapshotContention(uint32_t &reads, uint32_t &retries) {
+  reads = snapshotReads.load(std::memory_order_relaxed);
+  retries = snapshotRetries.load(std::memory_order_relaxed);
+}
+
+// System state as last set by the control task and the commands it applied
+static void captureState(ControlSnapshot& out) {
+  systemState.set(STATE_PUMP, getShotStatus().pumpDuty > 0.0);
+  systemState.set(STATE_GRINDER, getGrindStatus().running);
+  memcpy(&out.state, &systemState, sizeof(SystemState));
+}
+
+// ======= Control Cycle =======
+// Everything that decides the heater state; nothing here may block on
+// network or display work.
+static void runControlCycle(ControlSnapshot& out) {
+  TemperatureReading reading = getTemperatureReading();
+
+  if (reading.valid) {
+    systemState.currentTemp = reading.celsius;
+    systemState.tempDerivative = reading.derivative;
+    systemState.targetTemp = systemState.has(STATE_STEAM_MODE) ? coffeeConfig.steamTemp
+                                                                : coffeeConfig.brewTemp;
+
+    // If autotuning, use autotune control, otherwise use normal control
+    if (isAutotuning()) {
+      updateAutotune();
+    } else {
+      updateHeatingControl();
+      updateFeedForwardLearning();
+    }
+    out.sensorFault = false;
+  } else {
+    systemState.currentTemp = -999.0;
+    systemState.tempDerivative = 0.0;
+    // Turn off heating if sensor fails
+    if (systemState.has(STATE_HEATING)) {
+      setHeatingElement(false);
+    }
+    // Stop autotune if running
+    if (isAutotuning()) {
+      abortAutotune("Sensor fault");
+    }
+    out.sensorFault = true;
+  }
+
+  out.currentTemp = systemState.currentTemp;
+  out.tempDerivative = systemState.tempDerivative;
+  out.rawTemp = reading.raw;
+  out.coldJunctionTemp = reading.coldJunction;
+  out.sensorFaults = reading.faults;
+  out.targetTemp = systemState.targetTemp;
+  out.heatingElement = systemState.has(STATE_HEATING);
+  out.heaterDuty = getHeaterDuty();
+  out.autotuning = isAutotuning();
+  out.pid = getPIDTerms();
+  out.smith = getSmithTerms();
+  captureState(out);
+}
+
+// Run one cycle and publish its snapshot (called by the control task, or by
+// the simulation clock on the host)
+void stepControl() {
+  int64_t startUs = halMicros();
+  
+  applyCommands();
+  ControlSnapshot next;
+  runControlCycle(next);
+  
+  timing.execLastUs = (uint32_t)(halMicros() - startUs);
+  if (timing.execLastUs > timing.execMaxUs) timing.execMaxUs = timing.execLastUs;
+  
+  next.cycleCount = ++cycleCount;
+  next.timestampMs = halMillis();
+  next.timing = timing;
+  publishSnapshot(next);
+  publishConfig();
+  noteTraceControl(next);
+}
+
+#ifdef ARDUINO
+// ======= Jitter Statistics =======
+static uint32_t jitterHistogram[CONTROL_JITTER_BUCKETS];
+
+static void clearTiming(uint32_t nominalPeriodUs) {
+  timing = ControlTiming();
+  timing.nominalPeriodUs = nominalPeriodUs;
+  memset(jitterHistogram, 0, sizeof(jitterHistogram));
+}
+
+static void recordPeriod(uint32_t periodUs) {
+  timing.periodLastUs = periodUs;
+  if (timing.samples == 0 || periodUs < timing.periodMinUs) timing.periodMinUs = periodUs;
+  if (periodUs > timing.periodMaxUs) timing.periodMaxUs = periodUs;
+  timing.samples++;
+
+  uint32_t deviation = periodUs > timing.nominalPeriodUs ? periodUs - timing.nominalPeriodUs
+                                                         : timing.nominalPeriodUs - periodUs;
+  if (deviation > timing.jitterMaxUs) timing.jitterMaxUs = deviation;
+  uint32_t bucket = deviation / CONTROL_JITTER_BUCKET_US;
+  if (bucket >= CONTROL_JITTER_BUCKETS) bucket = CONTROL_JITTER_BUCKETS - 1;
+  jitterHistogram[bucket]++;
+
+  // p99 = upper edge of the bucket holding the 99th percentile sample
+  uint32_t threshold = (timing.samples * 99 + 99) / 100;
+  uint32_t cumulative = 0;
+  for (int i = 0; i < CONTROL_JITTER_BUCKETS; i++) {
+    cumulative += jitterHistogram[i];
+    if (cumulative >= threshold) {
+      timing.jitterP99Us = (i == CONTROL_JITTER_BUCKETS - 1) ? timing.jitterMaxUs
+                                                             : (i + 1) * CONTROL_JITTER_BUCKET_US;
+      break;
+    }
+  }
+}
+
+void resetControlTiming() {
+  timingResetRequested = true;
+}
+
+// Apply commands posted since the last cycle and republish the state part
+// of the snapshot, so a button press shows without waiting for the next cycle
+static void serviceCommands() {
+  if (applyCommands() == 0) return;
+  ControlSnapshot next = snapshot;   // Only this task writes it
+  next.targetTemp = systemState.targetTemp;
+  next.heatingElement = systemState.has(STATE_HEATING);
+  next.heaterDuty = getHeaterDuty();
+  captureState(next);
+  publishSnapshot(next);
+}
+
+// ======= Control Task =======
+static TaskHandle_t controlTaskHandle = NULL;
+
+static void controlTask(void *param) {
+  uint32_t periodMs = coffeeConfig.tempUpdateInterval;
+  clearTiming(periodMs * 1000UL);
+
+  TickType_t lastWake = xTaskGetTickCount();
+  int64_t lastStartUs = 0;
+
+  for (;;) {
+    // Sleep until the next period; posted commands wake the task early
+    TickType_t due = lastWake + pdMS_TO_TICKS(periodMs);
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(due - now) > 0 && ulTaskNotifyTake(pdTRUE, due - now) > 0) {
+      serviceCommands();
+      continue;
+    }
+    lastWake = due;
+
+    int64_t startUs = halMicros();
+    if (lastStartUs != 0) {
+      recordPeriod((uint32_t)(startUs - lastStartUs));
+    }
+    lastStartUs = startUs;
+
+    stepControl();
+
+    // Pick up a new period (or a reset request) for the next cycle
+    uint32_t requestedMs = coffeeConfig.tempUpdateInterval;
+    if (requestedMs != periodMs || timingResetRequested.exchange(false)) {
+      periodMs = requestedMs;
+      clearTiming(periodMs * 1000UL);
+      lastStartUs = 0;
+    }
+  }
+}
+
+void wakeControlTask() {
+  if (controlTaskHandle != NULL) {
+    xTaskNotifyGive(controlTaskHandle);
+  }
+}
+
+// ======= Task Startup =======
+void startControlTask() {
+  if (controlTaskHandle != NULL) {
+    return;
+  }
+
+  // Readers of getConfigSnapshot() may start before the first cycle
+  publishConfig();
+
+  BaseType_t created = xTaskCreatePinnedToCore(controlTask, "control",
+                                               CONTROL_TASK_STACK_SIZE, NULL,
+                                               CONTROL_TASK_PRIORITY,
+                                               &controlTaskHandle,
+                                               CONTROL_TASK_CORE);
+  if (created == pdPASS) {
+    Serial.printf("Control task started on core %d (period %d ms)\n",
+                  CONTROL_TASK_CORE, coffeeConfig.tempUpdateInterval);
+  } else {
+    Serial.println("Error: Failed to create control task!");
+  }
+}
+#else
+// The simulation applies commands at the start of each stepControl()
+void wakeControlTask() {
+}
+#endif // ARDUINO
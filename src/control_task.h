@@ -0,0 +1,78 @@
+#ifndef CONTROL_TASK_H
+#define CONTROL_TASK_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "pid_control.h"
+#include "smith_predictor.h"
+
+// ======= Control Task Settings =======
+// The Arduino loop (LVGL, OTA, telemetry) runs on core 1; the control task
+// gets core 0 at a priority above the Arduino loop so redraws cannot delay it.
+#define CONTROL_TASK_CORE        0
+#define CONTROL_TASK_PRIORITY    (configMAX_PRIORITIES - 3)
+#define CONTROL_TASK_STACK_SIZE  4096
+
+// Period jitter histogram: |actual - nominal| in fixed-width buckets
+#define CONTROL_JITTER_BUCKET_US 50
+#define CONTROL_JITTER_BUCKETS   64
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Control period timing statistics (microseconds)
+struct ControlTiming {
+  uint32_t nominalPeriodUs = 0;
+  uint32_t samples = 0;
+  uint32_t periodMinUs = 0;
+  uint32_t periodMaxUs = 0;
+  uint32_t jitterP99Us = 0;   // 99th percentile of |period - nominal|
+  uint32_t jitterMaxUs = 0;
+  uint32_t periodLastUs = 0;  // Measured length of the last period
+  uint32_t execLastUs = 0;    // Duration of the last control cycle
+  uint32_t execMaxUs = 0;
+};
+
+// Results of one control cycle and the system state, published atomically
+// to UI/web readers (republished when a command changes the state)
+struct ControlSnapshot {
+  float currentTemp = 0.0;      // Filtered
+  float rawTemp = 0.0;          // Latest unfiltered sample
+  float tempDerivative = 0.0;   // °C/s
+  float coldJunctionTemp = 0.0;
+  uint8_t sensorFaults = 0;     // MAX31855_FAULT_* bits
+  float targetTemp = 0.0;
+  bool heatingElement = false;
+  float heaterDuty = 0.0;       // Requested SSR duty cycle (0-100%)
+  bool sensorFault = false;
+  bool autotuning = false;
+  SystemState state;            // Mode, pump/grinder, selections, operation
+  PIDTerms pid;                 // Valid in PID mode
+  SmithTerms smith;             // Valid in Smith predictor mode
+  uint32_t cycleCount = 0;
+  uint32_t timestampMs = 0;
+  ControlTiming timing;
+};
+
+// Start the periodic control task (call once from setup)
+void startControlTask();
+
+// Run one control cycle and publish its snapshot. Called by the control
+// task on the device, or by the simulation clock on the host.
+void stepControl();
+
+// Latest published control results (lock-free, safe from any task)
+ControlSnapshot getControlSnapshot();
+
+// Clear the jitter statistics (e.g. after changing the period)
+void resetControlTiming();
+
+// Wake the control task early to apply posted commands (no-op on the host)
+void wakeControlTask();
+
+// getControlSnapshot() calls, and copies retried because they overlapped a
+// publication
+void getSnapshotContention(uint32_t &reads, uint32_t &retries);
+
+#endif // CONTROL_TASK_H
@@ -1,11 +1,22 @@
 #include "display.h"
-#include <XPT2046_Touchscreen.h>
+#include "control_task.h"
+#include "ui_binding.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "shared_state.h"
+#include "profiler.h"
+#include "touch_calibration.h"
 #include <SPI.h>
+#include <esp_heap_caps.h>
 
-// Touch calibration mode
-static bool calibrationMode = true;
+// Touch calibration mode (four corner targets, see touch_calibration.h)
+static bool calibrationMode = false;
 static int calibrationStep = 0;
-static unsigned long lastTouchDebug = 0;
+static volatile bool calibrationRequested = false;
+static bool calibrationSavePending = false;   // Posted to the control task when it accepts it
+static TouchPoint calibrationRaw[TOUCH_CAL_POINTS];
+static bool touchCalibrated = false;
+static float touchMatrix[6];
 
 // ============================================================================
 // DISPLAY HARDWARE
@@ -19,10 +30,30 @@ static TFT_eSPI tft = TFT_eSPI();
 #define TOUCH_MISO 39
 #define TOUCH_CLK 25
 
-static XPT2046_Touchscreen touch(TOUCH_CS, TOUCH_IRQ);
+// Touch input is interrupt driven: PENIRQ falls when the panel is pressed,
+// which resumes LVGL's input read timer; the timer pauses again on
+// release, so an idle screen causes no SPI traffic.
+static lv_timer_t *touchReadTimer = NULL;
+static volatile bool touchIrqPending = false;
+static volatile uint32_t touchIrqCount = 0;
+static bool touchPressed = false;
+static TouchPoint touchLastRaw;
+static lv_point_t touchLastPoint = {0, 0};
+static uint32_t touchReads = 0;
+static uint32_t touchPresses = 0;
+
 static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf1[DISPLAY_WIDTH * 10];
-static lv_color_t buf2[DISPLAY_WIDTH * 10];
+static lv_color_t *buf1 = NULL;
+static lv_color_t *buf2 = NULL;
+static uint16_t bufferLines = 0;
+
+// DMA flush state. While a strip is on the wire the TFT write transaction
+// stays open; finishFlush() closes it (endWrite waits for the DMA) before
+// anything else touches the SPI bus.
+static bool dmaReady = false;
+static bool useDma = false;
+static bool writeOpen = false;
+static volatile bool benchmarkRequested = false;
 
 // ============================================================================
 // UI ELEMENTS
@@ -36,62 +67,142 @@ static lv_obj_t *shot_btns[4];
 static lv_obj_t *grind_btns[2];
 static lv_obj_t *status_label;
 
+// Button states as last drawn (refreshed from the control snapshot)
+static bool shownValid = false;
+static bool shownHeating = false;
+static bool shownSteamMode = false;
+static int shownShotSize = 0;
+static int shownGrindTime = 0;
+
+// Cached label contents - see ui_binding.h
+static UiNumberBinding temp_binding;
+static UiNumberBinding target_binding;
+static UiTextBinding status_binding;
+
+// Flush accounting
+static uint32_t flushWindowPixels = 0;
+static uint32_t flushWindowStartMs = 0;
+static DisplayStats displayStats;
+
 // ============================================================================
 // LVGL TOUCH INPUT CALLBACK
 // ============================================================================
-void lvgl_touch_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
-    if (touch.touched()) {
-        TS_Point p = touch.getPoint();
-        
-        // Only process if pressure is reasonable
-        if (p.z > 200 && p.z < 4000) {
-            // Always show raw touch coordinates for calibration
-            if (millis() - lastTouchDebug > 200) {  // Throttle output
-                lastTouchDebug = millis();
-                Serial.printf("\n=== TOUCH DEBUG ===");
-                Serial.printf("\nRaw touch: X=%d, Y=%d, Pressure=%d", p.x, p.y, p.z);
-                
-                if (calibrationMode) {
-                    Serial.printf("\n[CALIBRATION STEP %d]", calibrationStep);
-                    switch(calibrationStep) {
-                        case 0: Serial.print(" -> Please touch TOP-LEFT corner"); break;
-                        case 1: Serial.print(" -> Please touch TOP-RIGHT corner"); break;
-                        case 2: Serial.print(" -> Please touch BOTTOM-RIGHT corner"); break;
-                        case 3: Serial.print(" -> Please touch BOTTOM-LEFT corner"); break;
-                        case 4: Serial.print(" -> Calibration complete! Reboot to use."); break;
-                    }
-                    if (calibrationStep < 4) {
-                        calibrationStep++;
-                    }
-                }
-                Serial.println();
-            }
-            
-            // Calibrated mapping based on actual touch data
-            // X: right(~300) to left(~3800) -> display 240 to 0 (inverted)
-            // Y: bottom(~300) to top(~3800) -> display 320 to 0 (inverted)
-            data->point.x = map(p.x, 300, 3800, 240, 0);
-            data->point.y = map(p.y, 300, 3800, 320, 0);
-            data->state = LV_INDEV_STATE_PRESSED;
-        } else {
-            data->state = LV_INDEV_STATE_RELEASED;
+static void finishFlush() {
+    if (writeOpen) {
+        tft.endWrite();
+        writeOpen = false;
+    }
+}
+
+static void IRAM_ATTR onTouchIrq() {
+    touchIrqPending = true;
+    touchIrqCount++;
+}
+
+// One pressure reading and TOUCH_SAMPLES position readings in a single
+// transaction (XPT2046: each transfer returns the previous conversion and
+// starts the next). Returns false if the panel is not pressed. Positions
+// are the median of the samples, in the raw orientation the calibration
+// expects (x from the Y plate, mirrored).
+static bool readTouchRaw(TouchPoint &raw) {
+    int16_t xs[TOUCH_SAMPLES];
+    int16_t ys[TOUCH_SAMPLES];
+    
+    SPI.beginTransaction(SPISettings(TOUCH_SPI_HZ, MSBFIRST, SPI_MODE0));
+    digitalWrite(TOUCH_CS, LOW);
+    SPI.transfer(0xB1);                            // Start Z1
+    int z1 = SPI.transfer16(0xC1) >> 3;            // Z1, start Z2
+    int z2 = SPI.transfer16(0x91) >> 3;            // Z2, start X
+    int z = z1 + 4095 - z2;
+    bool pressed = z > TOUCH_Z_MIN && z < TOUCH_Z_MAX;
+    if (pressed) {
+        SPI.transfer16(0x91);                      // First X is noisy, start again
+        for (int i = 0; i < TOUCH_SAMPLES; i++) {
+            xs[i] = SPI.transfer16(0xD1) >> 3;     // X, start Y
+            ys[i] = SPI.transfer16(0x91) >> 3;     // Y, start X
         }
-    } else {
+    }
+    SPI.transfer16(0xD0);                          // Power down with PENIRQ enabled
+    SPI.transfer16(0);
+    digitalWrite(TOUCH_CS, HIGH);
+    SPI.endTransaction();
+    touchReads++;
+    
+    if (!pressed) return false;
+    int16_t x = touchMedian(xs, TOUCH_SAMPLES);
+    int16_t y = touchMedian(ys, TOUCH_SAMPLES);
+    raw.x = 4095 - y;
+    raw.y = x;
+    return true;
+}
+
+static void acceptCalibrationPoint();
+
+void lvgl_touch_read(lv_indev_drv_t *indev_driver, lv_indev_data_t *data) {
+    PROFILE_SCOPE("lvgl_touch_read");
+    
+    // A spurious edge (GPIO36 also glitches with WiFi active) finds the
+    // line high and costs no SPI read
+    TouchPoint raw;
+    bool pressed = false;
+    if (digitalRead(TOUCH_IRQ) == LOW) {
+        finishFlush();  // Touch shares the SPI peripheral with the TFT
+        pressed = readTouchRaw(raw);
+    }
+    
+    if (!pressed) {
+        // Released: sleep until the next PENIRQ edge
+        if (touchPressed && calibrationMode) acceptCalibrationPoint();
+        touchPressed = false;
+        touchIrqPending = false;
+        lv_timer_pause(indev_driver->read_timer);
+        data->point = touchLastPoint;
+        data->state = LV_INDEV_STATE_RELEASED;
+        return;
+    }
+    
+    if (!touchPressed) touchPresses++;
+    touchPressed = true;
+    touchLastRaw = raw;
+    if (calibrationMode) {
+        // The point is taken on release; the UI underneath sees no press
+        data->point = touchLastPoint;
         data->state = LV_INDEV_STATE_RELEASED;
+        return;
     }
+    
+    TouchPoint p = applyTouchCalibration(touchMatrix, raw.x, raw.y);
+    touchLastPoint.x = constrain(p.x, 0, DISPLAY_WIDTH - 1);
+    touchLastPoint.y = constrain(p.y, 0, DISPLAY_HEIGHT - 1);
+    data->point = touchLastPoint;
+    data->state = LV_INDEV_STATE_PRESSED;
 }
 
 // ============================================================================
 // LVGL DISPLAY FLUSH CALLBACK
 // ============================================================================
 void lvgl_flush_cb(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
+    PROFILE_SCOPE("lvgl_flush_cb");
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
 
-    tft.startWrite();
-    tft.setAddrWindow(area->x1, area->y1, w, h);
-    tft.pushColors((uint16_t *)&color_p->full, w * h, true);
-    tft.endWrite();
+    if (useDma) {
+        if (!writeOpen) {
+            tft.startWrite();
+            writeOpen = true;
+        }
+        // Waits for the previous strip, byte-swaps this one in place and
+        // queues it. LVGL renders the next strip into the other buffer
+        // while this one is transferred.
+        tft.pushImageDMA(area->x1, area->y1, w, h, (uint16_t *)&color_p->full);
+    } else {
+        tft.startWrite();
+        tft.setAddrWindow(area->x1, area->y1, w, h);
+        tft.pushColors((uint16_t *)&color_p->full, w * h, true);
+        tft.endWrite();
+    }
+
+    flushWindowPixels += w * h;
 
     lv_disp_flush_ready(disp);
 }
@@ -107,35 +218,42 @@ void lvglTick() {
 // ============================================================================
 // BUTTON EVENT HANDLERS
 // ============================================================================
+// State changes are posted to the control task; the buttons are redrawn
+// from the snapshot it republishes (see refreshControls)
 void onPowerButtonPressed(lv_event_t * e) {
-    bool newState = !systemState.heatingElement;
-    setHeatingElement(newState);
-    updatePowerButton();
-    
-    Serial.print("Power button pressed - Heating: ");
-    Serial.println(newState ? "ON" : "OFF");
+    postCommand(CMD_TOGGLE_HEATING);
+    Serial.println("Power button pressed");
 }
 
 void onModeButtonPressed(lv_event_t * e) {
-    systemState.steamMode = !systemState.steamMode;
-    systemState.targetTemp = systemState.steamMode ? coffeeConfig.steamTemp : coffeeConfig.brewTemp;
-    updateModeDisplay();
-    saveConfiguration();
-    
-    Serial.print("Mode changed to: ");
-    Serial.println(systemState.steamMode ? "STEAM" : "BREW");
+    postCommand(CMD_TOGGLE_STEAM_MODE);
+    Serial.println("Mode button pressed");
 }
 
 void onShotSizePressed(lv_event_t * e) {
     lv_obj_t * btn = lv_event_get_target(e);
     
+    // Any shot button stops a running shot
+    ShotPhase phase = getShotStatus().phase;
+    if (phase != SHOT_IDLE && phase != SHOT_STOP) {
+        stopShot();
+        Serial.println("Shot stopped from touch screen");
+        return;
+    }
+    
     // Find which button was pressed
+    int selected = getControlSnapshot().state.selectedShotSize;
     for (int i = 0; i < 4; i++) {
         if (btn == shot_btns[i]) {
-            systemState.selectedShotSize = i;
-            updateShotSizeDisplay();
+            // Tapping the selected size again pulls the shot
+            if (selected == i) {
+                startShot(i);
+                break;
+            }
+            postCommand(CMD_SELECT_SHOT_SIZE, i);
+            CoffeeConfig config = getConfigSnapshot();
             Serial.printf("Shot size selected: %s (%.1fs)\n", 
-                         coffeeConfig.shotNames[i], coffeeConfig.shotSizes[i]);
+                         config.shotNames[i], config.shotSizes[i]);
             break;
         }
     }
@@ -144,13 +262,26 @@ void onShotSizePressed(lv_event_t * e) {
 void onGrindTimePressed(lv_event_t * e) {
     lv_obj_t * btn = lv_event_get_target(e);
     
+    // Any grind button stops the grinder
+    if (getGrindStatus().running) {
+        stopGrind();
+        Serial.println("Grinder stopped from touch screen");
+        return;
+    }
+    
     // Find which button was pressed
+    int selected = getControlSnapshot().state.selectedGrindTime;
     for (int i = 0; i < 2; i++) {
         if (btn == grind_btns[i]) {
-            systemState.selectedGrindTime = i;
-            updateGrindTimeDisplay();
+            // Tapping the selected preset again starts grinding
+            if (selected == i) {
+                startGrind(i);
+                break;
+            }
+            postCommand(CMD_SELECT_GRIND, i);
+            CoffeeConfig config = getConfigSnapshot();
             Serial.printf("Grind time selected: %s (%.1fs)\n", 
-                         coffeeConfig.grindNames[i], coffeeConfig.grindTimes[i]);
+                         config.grindNames[i], config.grindTimes[i]);
             break;
         }
     }
@@ -162,35 +293,33 @@ void onGrindTimePressed(lv_event_t * e) {
 void updateTemperatureDisplay() {
     if (!temp_label || !target_label) return;
     
-    char temp_str[32];
-    snprintf(temp_str, sizeof(temp_str), "%.1f°C", systemState.currentTemp);
-    lv_label_set_text(temp_label, temp_str);
+    ControlSnapshot control = getControlSnapshot();
     
-    char target_str[32];
-    snprintf(target_str, sizeof(target_str), "Target:%.0f°C", systemState.targetTemp);
-    lv_label_set_text(target_label, target_str);
+    // Labels are only re-rendered when the shown value changes
+    uiSetNumber(temp_binding, control.currentTemp);
+    uiSetNumber(target_binding, control.targetTemp);
 }
 
-void updateModeDisplay() {
+void updateModeDisplay(bool steamMode) {
     if (!mode_btn) return;
     
-    const char* mode_text = systemState.steamMode ? "STEAM" : "BREW";
+    const char* mode_text = steamMode ? "STEAM" : "BREW";
     lv_label_set_text(lv_obj_get_child(mode_btn, 0), mode_text);
     
     // Change color based on mode
     lv_obj_t *label = lv_obj_get_child(mode_btn, 0);
-    if (systemState.steamMode) {
+    if (steamMode) {
         lv_obj_set_style_bg_color(mode_btn, lv_color_hex(0xFF0000), 0); // Pure red for steam
     } else {
         lv_obj_set_style_bg_color(mode_btn, lv_color_hex(0x0099FF), 0); // Pure blue for brew
     }
 }
 
-void updateShotSizeDisplay() {
+void updateShotSizeDisplay(int selected) {
     for (int i = 0; i < 4; i++) {
         if (!shot_btns[i]) continue;
         
-        if (i == systemState.selectedShotSize) {
+        if (i == selected) {
             lv_obj_set_style_bg_color(shot_btns[i], lv_color_hex(0x00FF00), 0); // Pure green when selected
         } else {
             lv_obj_set_style_bg_color(shot_btns[i], lv_color_hex(0x808080), 0); // Medium gray when not selected
@@ -198,11 +327,11 @@ void updateShotSizeDisplay() {
     }
 }
 
-void updateGrindTimeDisplay() {
+void updateGrindTimeDisplay(int selected) {
     for (int i = 0; i < 2; i++) {
         if (!grind_btns[i]) continue;
         
-        if (i == systemState.selectedGrindTime) {
+        if (i == selected) {
             lv_obj_set_style_bg_color(grind_btns[i], lv_color_hex(0x00FF00), 0); // Pure green when selected
         } else {
             lv_obj_set_style_bg_color(grind_btns[i], lv_color_hex(0x808080), 0); // Medium gray when not selected
@@ -210,20 +339,41 @@ void updateGrindTimeDisplay() {
     }
 }
 
-void updatePowerButton() {
+void updatePowerButton(bool heating) {
     if (!power_btn) return;
     
-    const char* power_text = systemState.heatingElement ? "POWER\nON" : "POWER\nOFF";
+    const char* power_text = heating ? "POWER\nON" : "POWER\nOFF";
     lv_label_set_text(lv_obj_get_child(power_btn, 0), power_text);
     
     // Change color based on state
-    if (systemState.heatingElement) {
+    if (heating) {
         lv_obj_set_style_bg_color(power_btn, lv_color_hex(0x00FF00), 0); // Pure green when on
     } else {
         lv_obj_set_style_bg_color(power_btn, lv_color_hex(0x808080), 0); // Medium gray when off
     }
 }
 
+// Redraw the buttons whose state changed since they were last drawn
+static void refreshControls(const ControlSnapshot &control) {
+    if (!shownValid || control.heatingElement != shownHeating) {
+        shownHeating = control.heatingElement;
+        updatePowerButton(shownHeating);
+    }
+    if (!shownValid || control.state.has(STATE_STEAM_MODE) != shownSteamMode) {
+        shownSteamMode = control.state.has(STATE_STEAM_MODE);
+        updateModeDisplay(shownSteamMode);
+    }
+    if (!shownValid || control.state.selectedShotSize != shownShotSize) {
+        shownShotSize = control.state.selectedShotSize;
+        updateShotSizeDisplay(shownShotSize);
+    }
+    if (!shownValid || control.state.selectedGrindTime != shownGrindTime) {
+        shownGrindTime = control.state.selectedGrindTime;
+        updateGrindTimeDisplay(shownGrindTime);
+    }
+    shownValid = true;
+}
+
 // ============================================================================
 // MAIN UI CREATION
 // ============================================================================
@@ -333,16 +483,178 @@ void createMainUI() {
     lv_obj_set_style_text_color(status_label, lv_color_hex(0x95A5A6), 0);
     lv_obj_align(status_label, LV_ALIGN_BOTTOM_MID, 0, -5);
     
+    uiBindNumber(temp_binding, temp_label, "%.1f°C", UI_TEMP_RESOLUTION, UI_TEMP_MIN_INTERVAL_MS);
+    uiBindNumber(target_binding, target_label, "Target:%.0f°C", 1.0, UI_TEMP_MIN_INTERVAL_MS);
+    uiBindText(status_binding, status_label, UI_STATUS_MIN_INTERVAL_MS);
+    
     // Initialize UI state
-    updatePowerButton();
-    updateModeDisplay();
-    updateShotSizeDisplay();
-    updateGrindTimeDisplay();
+    shownValid = false;
+    refreshControls(getControlSnapshot());
     updateTemperatureDisplay();
     
     Serial.println("UI created successfully");
 }
 
+// ============================================================================
+// DRAW BUFFERS
+// ============================================================================
+// Both buffers come from internal DMA-capable RAM. If the configured height
+// does not fit, halve it until it does.
+static bool allocateDrawBuffers() {
+    for (uint16_t lines = DISPLAY_BUFFER_LINES; lines >= 10; lines /= 2) {
+        size_t bytes = DISPLAY_WIDTH * lines * sizeof(lv_color_t);
+        buf1 = (lv_color_t *)heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        buf2 = (lv_color_t *)heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (buf1 && buf2) {
+            bufferLines = lines;
+            return true;
+        }
+        heap_caps_free(buf1);
+        heap_caps_free(buf2);
+        buf1 = buf2 = NULL;
+    }
+    return false;
+}
+
+// ============================================================================
+// FULL-SCREEN REDRAW BENCHMARK
+// ============================================================================
+static uint32_t timeFullRedraw() {
+    lv_obj_invalidate(lv_scr_act());
+    uint32_t start = micros();
+    lv_refr_now(NULL);
+    finishFlush();
+    return micros() - start;
+}
+
+static uint32_t redrawKBps(uint32_t frameUs) {
+    if (frameUs == 0) return 0;
+    uint64_t bytes = (uint64_t)DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(lv_color_t);
+    return (uint32_t)(bytes * 1000 / frameUs);  // bytes/ms == kB/s
+}
+
+// Redraw the whole screen once with each flush path
+static void runDisplayBenchmark() {
+    bool dmaSetting = useDma;
+    
+    useDma = false;
+    displayStats.benchBlockingFrameUs = timeFullRedraw();
+    displayStats.benchBlockingKBps = redrawKBps(displayStats.benchBlockingFrameUs);
+    
+    if (dmaReady) {
+        useDma = true;
+        displayStats.benchDmaFrameUs = timeFullRedraw();
+        displayStats.benchDmaKBps = redrawKBps(displayStats.benchDmaFrameUs);
+    }
+    
+    useDma = dmaSetting;
+    Serial.printf("Display redraw (%d-line buffers): blocking %lu us (%lu kB/s), DMA %lu us (%lu kB/s)\n",
+                  bufferLines,
+                  (unsigned long)displayStats.benchBlockingFrameUs, (unsigned long)displayStats.benchBlockingKBps,
+                  (unsigned long)displayStats.benchDmaFrameUs, (unsigned long)displayStats.benchDmaKBps);
+}
+
+void requestDisplayBenchmark() {
+    benchmarkRequested = true;
+}
+
+// ============================================================================
+// TOUCH CALIBRATION SCREEN
+// ============================================================================
+// A cross at each corner target in turn, on the top layer over the UI.
+// The raw position is taken when the finger lifts; after the fourth point
+// the affine map is fitted, and a fit that misses a target starts over.
+static const TouchPoint CALIBRATION_TARGETS[TOUCH_CAL_POINTS] = {
+    {TOUCH_CAL_INSET, TOUCH_CAL_INSET},                                    // Top-left
+    {DISPLAY_WIDTH - 1 - TOUCH_CAL_INSET, TOUCH_CAL_INSET},                // Top-right
+    {DISPLAY_WIDTH - 1 - TOUCH_CAL_INSET, DISPLAY_HEIGHT - 1 - TOUCH_CAL_INSET},  // Bottom-right
+    {TOUCH_CAL_INSET, DISPLAY_HEIGHT - 1 - TOUCH_CAL_INSET}                // Bottom-left
+};
+static const char *const CALIBRATION_CORNERS[TOUCH_CAL_POINTS] = {
+    "TOP-LEFT", "TOP-RIGHT", "BOTTOM-RIGHT", "BOTTOM-LEFT"
+};
+
+static lv_obj_t *calibration_overlay = NULL;
+static lv_obj_t *calibration_cross[2];
+static lv_obj_t *calibration_label;
+
+static lv_obj_t *createCalibrationBar(lv_coord_t w, lv_coord_t h) {
+    lv_obj_t *bar = lv_obj_create(calibration_overlay);
+    lv_obj_remove_style_all(bar);
+    lv_obj_set_size(bar, w, h);
+    lv_obj_set_style_bg_color(bar, lv_color_hex(0xFF0000), 0);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_COVER, 0);
+    return bar;
+}
+
+static void showCalibrationTarget() {
+    const TouchPoint &t = CALIBRATION_TARGETS[calibrationStep];
+    lv_obj_set_pos(calibration_cross[0], t.x - 10, t.y - 1);
+    lv_obj_set_pos(calibration_cross[1], t.x - 1, t.y - 10);
+    lv_label_set_text_fmt(calibration_label, "Touch the cross\n%d of %d",
+                          calibrationStep + 1, TOUCH_CAL_POINTS);
+    Serial.printf("[CALIBRATION STEP %d] -> Please touch %s corner\n", calibrationStep,
+                  CALIBRATION_CORNERS[calibrationStep]);
+}
+
+static void startCalibration() {
+    if (calibration_overlay == NULL) {
+        calibration_overlay = lv_obj_create(lv_layer_top());
+        lv_obj_remove_style_all(calibration_overlay);
+        lv_obj_set_size(calibration_overlay, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        lv_obj_set_style_bg_color(calibration_overlay, lv_color_hex(0x000000), 0);
+        lv_obj_set_style_bg_opa(calibration_overlay, LV_OPA_COVER, 0);
+        calibration_cross[0] = createCalibrationBar(21, 3);
+        calibration_cross[1] = createCalibrationBar(3, 21);
+        calibration_label = lv_label_create(calibration_overlay);
+        lv_obj_set_style_text_color(calibration_label, lv_color_hex(0xFFFFFF), 0);
+        lv_obj_set_style_text_align(calibration_label, LV_TEXT_ALIGN_CENTER, 0);
+        lv_obj_center(calibration_label);
+    }
+    lv_obj_clear_flag(calibration_overlay, LV_OBJ_FLAG_HIDDEN);
+    calibrationMode = true;
+    calibrationStep = 0;
+    
+    Serial.println("\n\n===========================================");
+    Serial.println("   TOUCH CALIBRATION MODE");
+    Serial.println("===========================================");
+    Serial.println("Touch the red cross at each corner when prompted.\n");
+    showCalibrationTarget();
+}
+
+static void acceptCalibrationPoint() {
+    calibrationRaw[calibrationStep] = touchLastRaw;
+    Serial.printf("Touch calibration: %s at raw X=%d, Y=%d\n", CALIBRATION_CORNERS[calibrationStep],
+                  touchLastRaw.x, touchLastRaw.y);
+    if (++calibrationStep < TOUCH_CAL_POINTS) {
+        showCalibrationTarget();
+        return;
+    }
+    
+    float matrix[6];
+    float maxError = 0.0;
+    if (!solveTouchCalibration(calibrationRaw, CALIBRATION_TARGETS, matrix, maxError)) {
+        if (maxError > 0.0) {
+            Serial.printf("Touch calibration rejected (worst miss %.1f px) - starting over\n", maxError);
+        } else {
+            Serial.println("Touch calibration rejected (points too close together) - starting over");
+        }
+        calibrationStep = 0;
+        showCalibrationTarget();
+        return;
+    }
+    memcpy(touchMatrix, matrix, sizeof(touchMatrix));
+    touchCalibrated = true;
+    calibrationSavePending = true;
+    calibrationMode = false;
+    lv_obj_add_flag(calibration_overlay, LV_OBJ_FLAG_HIDDEN);
+    Serial.printf("Touch calibration complete (worst miss %.1f px)\n", maxError);
+}
+
+void requestTouchCalibration() {
+    calibrationRequested = true;
+}
+
 // ============================================================================
 // DISPLAY INITIALIZATION
 // ============================================================================
@@ -353,6 +665,15 @@ void initDisplay() {
     tft.begin();
     tft.setRotation(1); // Landscape mode
     tft.fillScreen(TFT_BLACK);
+    tft.setSwapBytes(true);  // LVGL renders RGB565 little-endian
+    
+#if DISPLAY_USE_DMA
+    dmaReady = tft.initDMA();
+    useDma = dmaReady;
+    if (!dmaReady) {
+        Serial.println("Warning: TFT DMA unavailable - using blocking flush");
+    }
+#endif
     
     // Test backlight (GPIO 21 on ESP32-2432S028R)
     pinMode(21, OUTPUT);
@@ -363,8 +684,13 @@ void initDisplay() {
     // Initialize LVGL
     lv_init();
     
-    // Setup display buffer
-    lv_disp_draw_buf_init(&draw_buf, buf1, buf2, DISPLAY_WIDTH * 10);
+    // Setup display buffers
+    if (!allocateDrawBuffers()) {
+        Serial.println("Error: Failed to allocate display buffers!");
+        return;
+    }
+    lv_disp_draw_buf_init(&draw_buf, buf1, buf2, DISPLAY_WIDTH * bufferLines);
+    Serial.printf("Display buffers: 2 x %d lines, %s flush\n", bufferLines, useDma ? "DMA" : "blocking");
     
     // Initialize display driver
     static lv_disp_drv_t disp_drv;
@@ -378,41 +704,105 @@ void initDisplay() {
     // Initialize touch controller (separate SPI bus)
     Serial.println("Initializing touch controller...");
     SPI.begin(TOUCH_CLK, TOUCH_MISO, TOUCH_MOSI, TOUCH_CS);
-    touch.begin();
-    touch.setRotation(0);  // Use raw orientation; we handle mapping/rotation in code
-    
-    // Register touch input device with LVGL
+    pinMode(TOUCH_CS, OUTPUT);
+    digitalWrite(TOUCH_CS, HIGH);
+    pinMode(TOUCH_IRQ, INPUT);
+    TouchPoint unused;
+    readTouchRaw(unused);  // Leaves the controller powered down with PENIRQ enabled
+    attachInterrupt(digitalPinToInterrupt(TOUCH_IRQ), onTouchIrq, FALLING);
+    
+    CoffeeConfig config = getConfigSnapshot();
+    memcpy(touchMatrix, config.touchCal, sizeof(touchMatrix));
+    touchCalibrated = config.touchCalibrated;
+    
+    // Register touch input device with LVGL; its read timer only runs
+    // while the panel is pressed
     static lv_indev_drv_t indev_drv;
     lv_indev_drv_init(&indev_drv);
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     indev_drv.read_cb = lvgl_touch_read;
-    lv_indev_drv_register(&indev_drv);
+    lv_indev_t *indev = lv_indev_drv_register(&indev_drv);
+    touchReadTimer = indev->driver->read_timer;
+    lv_timer_pause(touchReadTimer);
     
     Serial.println("Display and touch initialized successfully");
     
-    Serial.println("\n\n===========================================");
-    Serial.println("   TOUCH CALIBRATION MODE");
-    Serial.println("===========================================");
-    Serial.println("Please touch the screen at each corner when prompted.");
-    Serial.println("This will help identify correct touch mapping.\n");
-    
     // Create the UI
     createMainUI();
+    
+    if (!touchCalibrated) {
+        startCalibration();
+    }
 }
 
 // ============================================================================
 // DISPLAY UPDATE (call regularly from main loop)
 // ============================================================================
 void updateDisplay() {
-    lv_timer_handler();
+    if (!buf1) return;  // Display failed to initialize
+    
+    // Wake the touch read timer on a PENIRQ edge, or if the line is still
+    // low (a press that began while the timer was being paused)
+    if (touchReadTimer->paused && (touchIrqPending || digitalRead(TOUCH_IRQ) == LOW)) {
+        lv_timer_resume(touchReadTimer);
+        lv_timer_ready(touchReadTimer);
+    }
+    if (calibrationRequested) {
+        calibrationRequested = false;
+        startCalibration();
+    }
+    
+    {
+        PROFILE_SCOPE("lv_timer_handler");
+        lv_timer_handler();
+    }
+    
+    if (benchmarkRequested) {
+        benchmarkRequested = false;
+        runDisplayBenchmark();
+    }
+    if (calibrationSavePending) {
+        // Stored with the configuration; retried while an update is in flight
+        CoffeeConfig config = getConfigSnapshot();
+        memcpy(config.touchCal, touchMatrix, sizeof(config.touchCal));
+        config.touchCalibrated = true;
+        calibrationSavePending = !postConfig(config, configField("touchCal") |
+                                                     configField("touchCalibrated"));
+    }
     updateTemperatureDisplay();
     
-    // Update status label with current operation
-    if (status_label) {
-        lv_label_set_text(status_label, systemState.currentOperation.c_str());
+    // Buttons and status label follow the state the control task published
+    ControlSnapshot control = getControlSnapshot();
+    refreshControls(control);
+    uiSetText(status_binding, operationName(control.state.operation));
+    
+    // Per-second flush and binding counters
+    uiBindingTick();
+    uint32_t now = millis();
+    uint32_t elapsed = now - flushWindowStartMs;
+    if (elapsed >= 1000) {
+        displayStats.flushedPixelsPerSec = (uint32_t)((uint64_t)flushWindowPixels * 1000 / elapsed);
+        flushWindowPixels = 0;
+        flushWindowStartMs = now;
     }
 }
 
+DisplayStats getDisplayStats() {
+    UiBindingStats binding = getUiBindingStats();
+    DisplayStats stats = displayStats;
+    stats.bufferLines = bufferLines;
+    stats.dma = useDma;
+    stats.labelUpdates = binding.updates;
+    stats.labelSkips = binding.skips;
+    stats.savedPixelsPerSec = binding.savedPixelsPerSec;
+    stats.touchIrqs = touchIrqCount;
+    stats.touchReads = touchReads;
+    stats.touchPresses = touchPresses;
+    stats.touchCalibrated = touchCalibrated;
+    stats.touchCalibrating = calibrationMode;
+    return stats;
+}
+
 // ============================================================================
 // TOUCH HANDLING (placeholder for now)
 // ============================================================================
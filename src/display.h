@@ -12,13 +12,57 @@
 #define DISPLAY_HEIGHT 320
 #define LVGL_TICK_PERIOD_MS 5
 
+// LVGL draw buffers: two buffers of this many lines in internal DMA RAM.
+// Halved at startup until the allocation succeeds.
+#ifndef DISPLAY_BUFFER_LINES
+#define DISPLAY_BUFFER_LINES 40
+#endif
+
+// Flush strips with TFT_eSPI DMA so LVGL renders the next strip meanwhile
+#ifndef DISPLAY_USE_DMA
+#define DISPLAY_USE_DMA 1
+#endif
+
+// Touch input (XPT2046): read only while pressed, woken by PENIRQ
+#define TOUCH_SAMPLES       5       // Position samples per report, median-filtered (odd)
+#define TOUCH_Z_MIN         200     // Pressure range of a real press
+#define TOUCH_Z_MAX         4000
+#define TOUCH_SPI_HZ        2000000
+#define TOUCH_CAL_INSET     20      // Calibration targets this far in from the corners
+
+// Label update limits (see ui_binding.h)
+#define UI_TEMP_RESOLUTION        0.1   // °C change that re-renders the temperature
+#define UI_TEMP_MIN_INTERVAL_MS   200   // Temperature labels at most 5 Hz
+#define UI_STATUS_MIN_INTERVAL_MS 100
+
+// Rendering counters
+struct DisplayStats {
+    uint32_t flushedPixelsPerSec = 0;  // Pixels actually sent to the panel
+    uint32_t savedPixelsPerSec = 0;    // Label redraws avoided by the bindings
+    uint32_t labelUpdates = 0;
+    uint32_t labelSkips = 0;
+    uint16_t bufferLines = 0;
+    bool dma = false;
+    
+    // Last full-screen redraw benchmark, per flush path
+    uint32_t benchBlockingFrameUs = 0;
+    uint32_t benchBlockingKBps = 0;
+    uint32_t benchDmaFrameUs = 0;
+    uint32_t benchDmaKBps = 0;
+    
+    // Touch input
+    uint32_t touchIrqs = 0;            // PENIRQ falling edges
+    uint32_t touchReads = 0;           // SPI reads (only while pressed)
+    uint32_t touchPresses = 0;
+    bool touchCalibrated = false;      // Stored calibration in use
+    bool touchCalibrating = false;
+};
+
 // ============================================================================
 // EXTERNAL DEPENDENCIES
 // ============================================================================
 extern CoffeeConfig coffeeConfig;
 extern SystemState systemState;
-extern void setHeatingElement(bool state);
-extern void saveConfiguration();
 
 // ============================================================================
 // DISPLAY FUNCTIONS
@@ -27,16 +71,19 @@ void initDisplay();
 void updateDisplay();
 void handleDisplayTouch();
 void lvglTick();
+DisplayStats getDisplayStats();
+void requestDisplayBenchmark();   // Runs on the next updateDisplay()
+void requestTouchCalibration();   // Shows the calibration screen on the next updateDisplay()
 
 // ============================================================================
 // UI ELEMENT FUNCTIONS
 // ============================================================================
 void createMainUI();
 void updateTemperatureDisplay();
-void updateModeDisplay();
-void updateShotSizeDisplay();
-void updateGrindTimeDisplay();
-void updatePowerButton();
+void updateModeDisplay(bool steamMode);
+void updateShotSizeDisplay(int selected);
+void updateGrindTimeDisplay(int selected);
+void updatePowerButton(bool heating);
 
 // ============================================================================
 // TOUCH HANDLERS
@@ -0,0 +1,104 @@
+#include "feed_forward.h"
+#include <atomic>
+#include "shot_engine.h"
+#include "temperature.h"
+#include "autotune.h"
+#include "shared_state.h"
+
+// Forward declaration for saving configuration
+void saveConfiguration();
+
+// ======= Feed-Forward State =======
+static std::atomic<float> appliedDuty(0.0);
+
+// Learner state, owned by the control task; stats copies under ffMux
+static portMUX_TYPE ffMux = portMUX_INITIALIZER_UNLOCKED;
+static FeedForwardStats stats;
+static ShotRecord learnRecord;   // Too large for the control task stack
+static uint32_t lastSeenShotId = 0;
+
+// ======= Boost Profile =======
+static float boostFor(const CoffeeConfig &config, const ShotStatus &shot) {
+  float boost = config.ffBoostPct[shot.size];
+
+  switch (shot.phase) {
+    case SHOT_PREINFUSION:
+    case SHOT_RAMP:
+    case SHOT_BREW:
+      // Water drawn follows the pump duty
+      return boost * shot.pumpDuty / 100.0;
+    case SHOT_STOP:
+      // The element lags the water; fade out rather than cut
+      if (config.ffTailMs <= 0 || shot.sinceStopMs >= (uint32_t)config.ffTailMs) {
+        return 0.0;
+      }
+      return boost * (1.0 - (float)shot.sinceStopMs / config.ffTailMs);
+    default:
+      return 0.0;
+  }
+}
+
+// Runs in the heater output timer; the learner in the control task writes
+// ffBoostPct, so this reads the configuration snapshot
+float getFeedForwardDuty() {
+  float duty = 0.0;
+  CoffeeConfig config = getConfigSnapshot();
+
+  if (config.ffEnable && !systemState.has(STATE_STEAM_MODE) && !isAutotuning()) {
+    ShotStatus shot = getShotStatus();
+    if (shot.phase != SHOT_IDLE) {
+      // Never boost without a valid reading or above the target band
+      TemperatureReading reading = getTemperatureReading();
+      if (reading.valid && reading.celsius < config.brewTemp + FF_MAX_ABOVE_TARGET_C) {
+        duty = constrain(boostFor(config, shot), 0.0f, 100.0f);
+      }
+    }
+  }
+
+  appliedDuty = duty;
+  return duty;
+}
+
+// ======= Learning =======
+// Net droop = how far the shot pulled the temperature down minus how far
+// the boost pushed it up. Positive means too little boost.
+void updateFeedForwardLearning() {
+  uint32_t latestId = 0;
+  if (getShotIds(&latestId, 1) == 0 || latestId == lastSeenShotId) {
+    return;
+  }
+  lastSeenShotId = latestId;
+
+  if (!coffeeConfig.ffEnable || !coffeeConfig.ffLearn) return;
+  if (!getShotRecord(latestId, learnRecord)) return;
+
+  const ShotRecord &shot = learnRecord;
+  if (shot.aborted || shot.actualMs < FF_LEARN_MIN_SHOT_MS || shot.sampleCount == 0) return;
+  if (fabsf(shot.startTemp - coffeeConfig.brewTemp) > FF_LEARN_START_BAND_C) return;
+
+  float droop = shot.startTemp - shot.minTemp;
+  float rise = shot.maxTemp - shot.startTemp;
+  float &boost = coffeeConfig.ffBoostPct[shot.size];
+  float previous = boost;
+  boost = constrain(boost + FF_LEARN_GAIN * (droop - rise), 0.0f, 100.0f);
+  saveConfiguration();
+
+  portENTER_CRITICAL(&ffMux);
+  stats.learnedShots++;
+  stats.lastShotId = latestId;
+  stats.lastDroopC = droop;
+  stats.lastRiseC = rise;
+  portEXIT_CRITICAL(&ffMux);
+
+  Serial.printf("Feed-forward: shot %lu droop %.2f, rise %.2f C -> %s boost %.1f%% (was %.1f%%)\n",
+                (unsigned long)latestId, droop, rise, coffeeConfig.shotNames[shot.size],
+                boost, previous);
+}
+
+FeedForwardStats getFeedForwardStats() {
+  portENTER_CRITICAL(&ffMux);
+  FeedForwardStats copy = stats;
+  portEXIT_CRITICAL(&ffMux);
+  copy.dutyPct = appliedDuty.load();
+  return copy;
+}
@@ -0,0 +1,41 @@
+#ifndef FEED_FORWARD_H
+#define FEED_FORWARD_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Feed-Forward Settings =======
+// Cold water enters the boiler as soon as the pump starts, but the feedback
+// controllers only see the drop a sensor lag and a control period later.
+// The feed-forward adds heater duty for the known disturbance instead: the
+// boost for the selected shot size, scaled by the pump profile duty, and
+// faded out over ffTailMs after the pump stops. It is added in the SSR
+// output stage, so it applies on top of both on/off and PID control.
+#define FF_MAX_ABOVE_TARGET_C  2.0     // No boost above target + this
+#define FF_LEARN_GAIN          4.0     // Boost change (%) per °C of net droop
+#define FF_LEARN_MIN_SHOT_MS   10000   // Shorter shots are not learned from
+#define FF_LEARN_START_BAND_C  1.5     // Shot must start this close to target
+
+struct FeedForwardStats {
+  float dutyPct = 0.0;          // Boost applied right now
+  uint32_t learnedShots = 0;
+  uint32_t lastShotId = 0;      // Last shot looked at by the learner
+  float lastDroopC = 0.0;       // Start temperature minus shot minimum
+  float lastRiseC = 0.0;        // Shot maximum minus start temperature
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Heater boost for the current point of the shot (0-100%); called by the
+// output stage at each SSR window start
+float getFeedForwardDuty();
+
+// Adapt ffBoostPct[size] from the droop of the last completed shot (called
+// from the control cycle; does nothing until a new shot has completed)
+void updateFeedForwardLearning();
+
+FeedForwardStats getFeedForwardStats();
+
+#endif // FEED_FORWARD_H
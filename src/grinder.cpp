@@ -0,0 +1,196 @@
+#include "grinder.h"
+#include <time.h>
+#include "pin_mapping.h"
+#include "shared_state.h"
+
+// ======= Grinder State =======
+// Written from the cutoff timer and from start/stop requests (web, UI);
+// every access holds grindMux.
+static portMUX_TYPE grindMux = portMUX_INITIALIZER_UNLOCKED;
+static bool running = false;
+static int64_t startUs = 0;
+static esp_timer_handle_t stopTimer = NULL;
+
+static GrindRecord records[GRIND_HISTORY_SIZE];
+static uint32_t nextGrindId = 1;
+static int activeSlot = -1;
+
+static void writeGrinder(bool on) {
+  digitalWrite(GRINDER_PIN, on ? HIGH : LOW);
+}
+
+// Stop the motor and close the record (caller holds grindMux)
+static void finishGrindLocked(bool aborted) {
+  if (!running) return;
+
+  writeGrinder(false);
+  GrindRecord &record = records[activeSlot];
+  record.actualMs = (uint32_t)((esp_timer_get_time() - startUs) / 1000);
+  record.aborted = aborted;
+  running = false;
+  activeSlot = -1;
+}
+
+static void grindStopTimerCallback(void *arg) {
+  portENTER_CRITICAL(&grindMux);
+  finishGrindLocked(false);
+  portEXIT_CRITICAL(&grindMux);
+}
+
+void initGrinder() {
+  pinMode(GRINDER_PIN, OUTPUT);
+  writeGrinder(false);
+
+  esp_timer_create_args_t stopArgs = {};
+  stopArgs.callback = grindStopTimerCallback;
+  stopArgs.dispatch_method = ESP_TIMER_TASK;
+  stopArgs.name = "grind_stop";
+  if (esp_timer_create(&stopArgs, &stopTimer) != ESP_OK) {
+    Serial.println("Error: Failed to create grinder timer!");
+    return;
+  }
+  Serial.println("Grinder initialized (OFF)");
+}
+
+// ======= Planning =======
+// Callers run on the web and UI tasks, so they work on a configuration
+// snapshot: the control task updates grindRates while they read
+static uint32_t plannedMsFor(const CoffeeConfig &config, int preset) {
+  float seconds = config.grindTimes[preset];
+  if (config.grindMode == GRIND_MODE_DOSE && config.grindRates[preset] > 0.0) {
+    seconds = config.grindDoses[preset] / config.grindRates[preset];
+  }
+  uint32_t ms = (uint32_t)(seconds * 1000.0);
+  return constrain(ms, (uint32_t)GRIND_MIN_MS, (uint32_t)GRIND_MAX_MS);
+}
+
+uint32_t grindPlannedMs(int preset) {
+  return plannedMsFor(getConfigSnapshot(), preset);
+}
+
+// ======= Public Interface =======
+bool startGrind(int preset) {
+  if (preset < 0 || preset > 1 || stopTimer == NULL) return false;
+
+  CoffeeConfig config = getConfigSnapshot();
+  bool doseMode = config.grindMode == GRIND_MODE_DOSE && config.grindRates[preset] > 0.0;
+  uint32_t plannedMs = plannedMsFor(config, preset);
+  time_t now = time(NULL);
+
+  portENTER_CRITICAL(&grindMux);
+  if (running) {
+    portEXIT_CRITICAL(&grindMux);
+    return false;
+  }
+  activeSlot = (nextGrindId - 1) % GRIND_HISTORY_SIZE;
+  GrindRecord &record = records[activeSlot];
+  record = GrindRecord();
+  record.id = nextGrindId++;
+  record.startMs = millis();
+  record.startEpoch = now > 1600000000 ? (uint32_t)now : 0;  // Only once NTP has synced
+  record.preset = preset;
+  record.mode = doseMode ? GRIND_MODE_DOSE : GRIND_MODE_TIMED;
+  record.plannedMs = plannedMs;
+  if (doseMode) {
+    record.rate = config.grindRates[preset];
+    record.targetDose = config.grindDoses[preset];
+  }
+  uint32_t id = record.id;
+
+  running = true;
+  startUs = esp_timer_get_time();
+  writeGrinder(true);
+  portEXIT_CRITICAL(&grindMux);
+
+  esp_timer_stop(stopTimer);
+  esp_timer_start_once(stopTimer, plannedMs * 1000ULL);
+
+  postCommand(CMD_SELECT_GRIND, preset);
+  if (doseMode) {
+    Serial.printf("Grind %lu started: %s, %.1f g at %.2f g/s = %.2f s\n", (unsigned long)id,
+                  config.grindNames[preset], config.grindDoses[preset],
+                  config.grindRates[preset], plannedMs / 1000.0);
+  } else {
+    Serial.printf("Grind %lu started: %s, %.2f s\n", (unsigned long)id,
+                  config.grindNames[preset], plannedMs / 1000.0);
+  }
+  return true;
+}
+
+void stopGrind() {
+  if (stopTimer != NULL) {
+    esp_timer_stop(stopTimer);
+  }
+  portENTER_CRITICAL(&grindMux);
+  finishGrindLocked(true);
+  portEXIT_CRITICAL(&grindMux);
+}
+
+bool recordGrindDose(uint32_t id, float grams) {
+  if (grams <= 0.0) return false;
+
+  portENTER_CRITICAL(&grindMux);
+  if (id == 0) {
+    id = nextGrindId - 1;
+  }
+  int slot = id > 0 ? (id - 1) % GRIND_HISTORY_SIZE : -1;
+  bool usable = slot >= 0 && slot != activeSlot && records[slot].id == id &&
+                !records[slot].aborted && records[slot].actualMs >= GRIND_MIN_MS;
+  int preset = 0;
+  float measuredRate = 0.0;
+  if (usable) {
+    GrindRecord &record = records[slot];
+    record.weighedDose = grams;
+    preset = record.preset;
+    measuredRate = grams * 1000.0 / record.actualMs;
+  }
+  portEXIT_CRITICAL(&grindMux);
+  if (!usable) return false;
+
+  // The control task folds it into the learned rate (coffeeConfig is its own)
+  postCommand(CMD_LEARN_GRIND_RATE, preset, measuredRate);
+
+  Serial.printf("Grind %lu weighed %.1f g (%.2f g/s)\n", (unsigned long)id, grams, measuredRate);
+  return true;
+}
+
+GrindStatus getGrindStatus() {
+  GrindStatus status;
+  portENTER_CRITICAL(&grindMux);
+  status.running = running;
+  if (running) {
+    const GrindRecord &record = records[activeSlot];
+    status.id = record.id;
+    status.preset = record.preset;
+    status.plannedMs = record.plannedMs;
+    status.elapsedMs = (uint32_t)((esp_timer_get_time() - startUs) / 1000);
+  }
+  portEXIT_CRITICAL(&grindMux);
+  return status;
+}
+
+uint32_t getGrindIds(uint32_t *ids, uint32_t maxIds) {
+  uint32_t count = 0;
+  portENTER_CRITICAL(&grindMux);
+  for (uint32_t id = nextGrindId - 1; id >= 1 && count < maxIds; id--) {
+    int slot = (id - 1) % GRIND_HISTORY_SIZE;
+    if (records[slot].id != id) break;      // Overwritten
+    if (slot == activeSlot) continue;       // Still running
+    ids[count++] = id;
+  }
+  portEXIT_CRITICAL(&grindMux);
+  return count;
+}
+
+bool getGrindRecord(uint32_t id, GrindRecord &record) {
+  if (id == 0) return false;
+  int slot = (id - 1) % GRIND_HISTORY_SIZE;
+  bool found = false;
+  portENTER_CRITICAL(&grindMux);
+  if (records[slot].id == id && slot != activeSlot) {
+    record = records[slot];
+    found = true;
+  }
+  portEXIT_CRITICAL(&grindMux);
+  return found;
+}
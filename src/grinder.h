@@ -0,0 +1,70 @@
+#ifndef GRINDER_H
+#define GRINDER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Grinder Settings =======
+// The grinder is switched on directly and switched off by a one-shot
+// esp_timer armed for the planned time, so the cutoff does not depend on
+// loop() timing.
+#define GRIND_MIN_MS          500     // Shortest grind a dose can ask for
+#define GRIND_MAX_MS          60000   // Longest grind a dose can ask for
+#define GRIND_RATE_ALPHA      0.3     // Weight of a new weighing in the learned rate
+#define GRIND_HISTORY_SIZE    8       // Grind events kept in RAM
+
+enum GrindMode {
+  GRIND_MODE_TIMED = 0,     // Run for grindTimes[preset]
+  GRIND_MODE_DOSE = 1       // Run for grindDoses[preset] / grindRates[preset]
+};
+
+struct GrindRecord {
+  uint32_t id = 0;
+  uint32_t startMs = 0;       // millis() at motor start
+  uint32_t startEpoch = 0;    // Unix time at motor start (0 before NTP sync)
+  uint8_t preset = 0;         // Index into grindTimes/grindDoses
+  uint8_t mode = GRIND_MODE_TIMED;
+  uint32_t plannedMs = 0;
+  uint32_t actualMs = 0;      // Motor start to motor stop
+  bool aborted = false;
+  float rate = 0.0;           // Learned g/s used to plan it (0 = timed)
+  float targetDose = 0.0;     // g (dose mode only)
+  float weighedDose = 0.0;    // g as entered afterwards (0 = not weighed)
+};
+
+struct GrindStatus {
+  bool running = false;
+  uint32_t id = 0;
+  uint8_t preset = 0;
+  uint32_t elapsedMs = 0;
+  uint32_t plannedMs = 0;
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Initialize grinder pin and the cutoff timer
+void initGrinder();
+
+// Grind time for a preset in the current mode. Dose mode falls back to the
+// timed setting until a rate has been learned.
+uint32_t grindPlannedMs(int preset);
+
+// Start grinding preset 0 (single) or 1 (double); false if already running
+bool startGrind(int preset);
+
+// Stop the running grind early (recorded as aborted)
+void stopGrind();
+
+// Enter the weighed dose of grind id (0 = latest) and update the learned
+// rate of its preset. False if the grind is unknown, aborted or too short.
+bool recordGrindDose(uint32_t id, float grams);
+
+GrindStatus getGrindStatus();
+
+// Completed grinds, newest first
+uint32_t getGrindIds(uint32_t *ids, uint32_t maxIds);
+bool getGrindRecord(uint32_t id, GrindRecord &record);
+
+#endif // GRINDER_H
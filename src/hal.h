@@ -0,0 +1,26 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include "max31855.h"
+
+// ======= Hardware Abstraction =======
+// The hardware touch points of the control path (acquisition, controllers,
+// SSR output stage, shot engine). The ESP32 build implements them in
+// hal_esp32.cpp; the native build implements them on top of the boiler model
+// in sim/.
+
+// Monotonic clock
+uint32_t halMillis();
+int64_t halMicros();
+
+// SSR drive (true = heater on)
+void halWriteSsr(bool on);
+
+// Pump drive (true = pump on)
+void halWritePump(bool on);
+
+// One thermocouple conversion; returns false on a sensor fault
+bool halReadThermocouple(Max31855Frame &frame);
+
+#endif // HAL_H
@@ -0,0 +1,26 @@
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "hal.h"
+#include "pin_mapping.h"
+
+// ======= ESP32 Hardware Abstraction =======
+uint32_t halMillis() {
+  return millis();
+}
+
+int64_t halMicros() {
+  return esp_timer_get_time();
+}
+
+void halWriteSsr(bool on) {
+  digitalWrite(SSR_HEATING_PIN, on ? HIGH : LOW);
+}
+
+void halWritePump(bool on) {
+  digitalWrite(PUMP_PIN, on ? HIGH : LOW);
+}
+
+bool halReadThermocouple(Max31855Frame &frame) {
+  return readMax31855(frame);
+}
+#endif // ARDUINO
@@ -0,0 +1,208 @@
+#include "health_monitor.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <lvgl.h>
+#include "shot_engine.h"
+#include "grinder.h"
+#include "autotune.h"
+#include "storage.h"
+#include "shared_state.h"
+
+// ======= Monitor State =======
+// Written by loop(), copied out under healthMux for the web handlers
+static portMUX_TYPE healthMux = portMUX_INITIALIZER_UNLOCKED;
+static HealthStatus status;
+static unsigned long lastSampleMs = 0;
+
+// LVGL runs in loopTask, so its stack use shows up there
+static const char *const TASK_NAMES[HEALTH_TASK_COUNT] = {
+  "loopTask", "async_tcp", "control", "temp_acq", "storage"
+};
+static TaskHandle_t taskHandles[HEALTH_TASK_COUNT];
+
+// Kept across ESP.restart() (not a power cycle), so the next boot can tell
+// it was restarted by the monitor and why
+#define HEALTH_RESTART_MAGIC  0x48524553UL  // "HRES"
+struct RestartRecord {
+  uint32_t magic;
+  uint32_t count;
+  uint8_t alerts;
+};
+RTC_NOINIT_ATTR static RestartRecord restartRecord;
+
+static const char *resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:   return "power-on";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "interrupt watchdog";
+    case ESP_RST_TASK_WDT:  return "task watchdog";
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    default:                return "unknown";
+  }
+}
+
+// ======= Sampling =======
+static uint8_t percentOf(uint32_t part, uint32_t whole) {
+  return whole > 0 ? (uint8_t)(part * 100ULL / whole) : 0;
+}
+
+static void sampleHeap(HealthStatus &s) {
+  const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  s.freeHeap = heap_caps_get_free_size(caps);
+  s.minFreeHeap = heap_caps_get_minimum_free_size(caps);
+  s.largestBlock = heap_caps_get_largest_free_block(caps);
+  s.heapFragPct = s.freeHeap > 0 ? 100 - percentOf(s.largestBlock, s.freeHeap) : 0;
+}
+
+static void sampleStacks(HealthStatus &s) {
+  s.minStackFree = UINT32_MAX;
+  for (int i = 0; i < HEALTH_TASK_COUNT; i++) {
+    // Tasks started after boot (async_tcp) are looked up until they exist
+    if (taskHandles[i] == NULL) taskHandles[i] = xTaskGetHandle(TASK_NAMES[i]);
+    TaskHealth &task = s.tasks[i];
+    task.name = TASK_NAMES[i];
+    task.found = taskHandles[i] != NULL;
+    if (!task.found) continue;
+    // Stack is counted in bytes on ESP-IDF
+    task.stackFree = uxTaskGetStackHighWaterMark(taskHandles[i]);
+    if (task.stackFree < s.minStackFree) s.minStackFree = task.stackFree;
+  }
+  if (s.minStackFree == UINT32_MAX) s.minStackFree = 0;
+}
+
+static void sampleLvgl(HealthStatus &s) {
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  s.lvglTotal = mon.total_size;
+  s.lvglFree = mon.free_size;
+  s.lvglLargest = mon.free_biggest_size;
+  s.lvglMaxUsed = mon.max_used;
+  s.lvglUsedPct = mon.used_pct;
+  s.lvglFragPct = mon.frag_pct;
+}
+
+static uint8_t checkThresholds(const HealthStatus &s) {
+  uint8_t alerts = 0;
+  if (s.freeHeap < HEALTH_MIN_FREE_HEAP) alerts |= HEALTH_ALERT_HEAP;
+  if (s.largestBlock < HEALTH_MIN_LARGEST_BLOCK) alerts |= HEALTH_ALERT_FRAGMENTED;
+  for (int i = 0; i < HEALTH_TASK_COUNT; i++) {
+    if (s.tasks[i].found && s.tasks[i].stackFree < HEALTH_MIN_STACK_FREE) alerts |= HEALTH_ALERT_STACK;
+  }
+  if (s.lvglUsedPct > HEALTH_MAX_LVGL_USED_PCT || s.lvglFragPct > HEALTH_MAX_LVGL_FRAG_PCT) {
+    alerts |= HEALTH_ALERT_LVGL;
+  }
+  return alerts;
+}
+
+// Log each alert once, when it starts
+static void logNewAlerts(const HealthStatus &s, uint8_t raised) {
+  if (raised & HEALTH_ALERT_HEAP) {
+    Serial.printf("Health: free heap low (%lu bytes, minimum %lu)\n",
+                  (unsigned long)s.freeHeap, (unsigned long)s.minFreeHeap);
+  }
+  if (raised & HEALTH_ALERT_FRAGMENTED) {
+    Serial.printf("Health: heap fragmented (largest block %lu of %lu bytes free)\n",
+                  (unsigned long)s.largestBlock, (unsigned long)s.freeHeap);
+  }
+  if (raised & HEALTH_ALERT_STACK) {
+    for (int i = 0; i < HEALTH_TASK_COUNT; i++) {
+      if (s.tasks[i].found && s.tasks[i].stackFree < HEALTH_MIN_STACK_FREE) {
+        Serial.printf("Health: task %s has %lu stack bytes left\n", s.tasks[i].name,
+                      (unsigned long)s.tasks[i].stackFree);
+      }
+    }
+  }
+  if (raised & HEALTH_ALERT_LVGL) {
+    Serial.printf("Health: LVGL pool %u%% used, %u%% fragmented\n",
+                  (unsigned)s.lvglUsedPct, (unsigned)s.lvglFragPct);
+  }
+}
+
+// ======= Controlled Restart =======
+static bool machineIdle() {
+  return getShotStatus().phase == SHOT_IDLE && !getGrindStatus().running &&
+         !isAutotuning() && !otaInProgress;
+}
+
+static void restartForHealth(uint8_t alerts) {
+  Serial.printf("Health: restarting (alerts 0x%02x)\n", (unsigned)alerts);
+  flushConfiguration();
+  restartRecord.magic = HEALTH_RESTART_MAGIC;
+  restartRecord.alerts = alerts;
+  restartRecord.count++;
+  delay(100);  // Let the log line out
+  ESP.restart();
+}
+
+// ======= Public API =======
+void initHealthMonitor() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT ||
+      (restartRecord.magic != 0 && restartRecord.magic != HEALTH_RESTART_MAGIC)) {
+    // RTC memory holds garbage after power loss
+    memset(&restartRecord, 0, sizeof(restartRecord));
+  }
+
+  HealthStatus s;
+  s.resetReason = resetReasonName(reason);
+  s.healthRestarts = restartRecord.count;
+  if (restartRecord.magic == HEALTH_RESTART_MAGIC && reason == ESP_RST_SW) {
+    s.restartAlerts = restartRecord.alerts;
+    Serial.printf("Health: restarted by the monitor (alerts 0x%02x, %lu since power-on)\n",
+                  (unsigned)s.restartAlerts, (unsigned long)s.healthRestarts);
+  }
+  restartRecord.magic = 0;  // A later reset is not the monitor's unless it says so again
+
+  portENTER_CRITICAL(&healthMux);
+  status = s;
+  portEXIT_CRITICAL(&healthMux);
+
+  lastSampleMs = millis() - HEALTH_SAMPLE_MS;
+  updateHealthMonitor();
+}
+
+void updateHealthMonitor() {
+  unsigned long now = millis();
+  if (now - lastSampleMs < HEALTH_SAMPLE_MS) return;
+  lastSampleMs = now;
+
+  HealthStatus s = getHealthStatus();
+  sampleHeap(s);
+  sampleStacks(s);
+  sampleLvgl(s);
+  s.samples++;
+  s.sampledMs = now;
+
+  uint8_t alerts = checkThresholds(s);
+  uint8_t raised = alerts & ~s.alerts;
+  if (raised) {
+    s.alertEvents++;
+    logNewAlerts(s, raised);
+  } else if (s.alerts && !alerts) {
+    Serial.println("Health: alerts cleared");
+  }
+  s.alerts = alerts;
+  s.alertsSeen |= alerts;
+  s.alertSamples = alerts ? s.alertSamples + 1 : 0;
+  s.restartPending = getConfigSnapshot().healthRestart && s.alertSamples >= HEALTH_RESTART_SAMPLES &&
+                     s.healthRestarts < HEALTH_MAX_RESTARTS;
+
+  portENTER_CRITICAL(&healthMux);
+  status = s;
+  portEXIT_CRITICAL(&healthMux);
+
+  if (s.restartPending && machineIdle()) {
+    restartForHealth(alerts);
+  }
+}
+
+HealthStatus getHealthStatus() {
+  portENTER_CRITICAL(&healthMux);
+  HealthStatus copy = status;
+  portEXIT_CRITICAL(&healthMux);
+  return copy;
+}
@@ -0,0 +1,79 @@
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Health Monitor Settings =======
+// Samples heap, task stacks and the LVGL pool from loop() (the LVGL thread,
+// so lv_mem_monitor() needs no lock). A threshold crossing is logged once
+// when it starts; with coffeeConfig.healthRestart set, an alert that lasts
+// HEALTH_RESTART_SAMPLES samples restarts the board as soon as the machine
+// is idle (no shot, grind, autotune or OTA).
+#define HEALTH_SAMPLE_MS            10000
+#define HEALTH_MIN_FREE_HEAP        24576   // Internal heap bytes
+#define HEALTH_MIN_LARGEST_BLOCK    8192    // Largest allocatable block (fragmentation)
+#define HEALTH_MIN_STACK_FREE       512     // Unused stack bytes in any watched task
+#define HEALTH_MAX_LVGL_USED_PCT    90
+#define HEALTH_MAX_LVGL_FRAG_PCT    60
+#define HEALTH_RESTART_SAMPLES      6       // Alert held this long (1 min) before a restart
+#define HEALTH_MAX_RESTARTS         3       // Per power-on, so a bad threshold cannot boot-loop
+#define HEALTH_TASK_COUNT           5
+
+// Alert bits
+#define HEALTH_ALERT_HEAP        0x01   // Free heap low
+#define HEALTH_ALERT_FRAGMENTED  0x02   // Largest free block small
+#define HEALTH_ALERT_STACK       0x04   // A task is close to its stack end
+#define HEALTH_ALERT_LVGL        0x08   // LVGL pool full or fragmented
+
+struct TaskHealth {
+  const char *name = "";
+  bool found = false;          // Task exists (async_tcp starts with the server)
+  uint32_t stackFree = 0;      // Minimum unused stack since start (bytes)
+};
+
+struct HealthStatus {
+  uint32_t samples = 0;
+  uint32_t sampledMs = 0;
+
+  // Internal heap (bytes)
+  uint32_t freeHeap = 0;
+  uint32_t minFreeHeap = 0;    // Lowest since boot
+  uint32_t largestBlock = 0;
+  uint8_t heapFragPct = 0;     // 100 - largest block / free
+
+  TaskHealth tasks[HEALTH_TASK_COUNT];
+  uint32_t minStackFree = 0;   // Smallest of the tasks found
+
+  // LVGL pool (LV_MEM_SIZE)
+  uint32_t lvglTotal = 0;
+  uint32_t lvglFree = 0;
+  uint32_t lvglLargest = 0;
+  uint32_t lvglMaxUsed = 0;
+  uint8_t lvglUsedPct = 0;
+  uint8_t lvglFragPct = 0;
+
+  uint8_t alerts = 0;          // HEALTH_ALERT_* at the last sample
+  uint8_t alertsSeen = 0;      // Any since boot
+  uint32_t alertEvents = 0;    // Alerts raised (rising edges)
+  uint32_t alertSamples = 0;   // Consecutive samples with an alert
+  bool restartPending = false; // Waiting for the machine to go idle
+
+  const char *resetReason = "";
+  uint32_t healthRestarts = 0; // Restarts by the monitor since power-on
+  uint8_t restartAlerts = 0;   // Alerts that caused the last one (0 = other reset)
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern bool otaInProgress;
+
+// Look up the watched tasks and take the first sample
+void initHealthMonitor();
+
+// Sample every HEALTH_SAMPLE_MS (call from loop)
+void updateHealthMonitor();
+
+HealthStatus getHealthStatus();
+
+#endif // HEALTH_MONITOR_H
@@ -0,0 +1,142 @@
+#include "heater_output.h"
+#include <atomic>
+#include "hal.h"
+#include "feed_forward.h"
+#include "shared_state.h"
+
+// ======= Heater Output State =======
+static std::atomic<float> requestedDuty(0.0);
+static std::atomic<bool> outputState(false);
+static std::atomic<bool> forcedOff(false);    // 0% requested mid-window
+
+// Owned by the timer callback only
+static uint32_t windowPositionMs = 0;
+static uint32_t windowLengthMs = 0;   // ssrWindowMs, taken at the window start
+static uint32_t windowOnMs = 0;
+static float feedForwardDuty = 0.0;   // Shot boost for the current window
+static std::atomic<float> windowDuty(0.0);
+static float residualOnMs = 0.0;  // Carried over so short pulses are not lost
+
+static void writeOutput(bool on) {
+  if (outputState.load() != on) {
+    halWriteSsr(on);
+    outputState = on;
+  }
+}
+
+// ======= Window Planning =======
+// Convert the requested duty into an on-time for the next window, rounded to
+// whole ticks and respecting the minimum on/off time. Whatever could not be
+// applied is carried into the next window so the average power stays right.
+static uint32_t planWindow(float duty, uint32_t windowMs, uint32_t minSwitchMs) {
+  if (duty <= 0.0) {
+    residualOnMs = 0.0;
+    return 0;
+  }
+  if (duty >= 100.0) {
+    residualOnMs = 0.0;
+    return windowMs;
+  }
+
+  float desiredMs = duty / 100.0 * windowMs + residualOnMs;
+  uint32_t onMs = 0;
+  if (desiredMs > 0.0) {
+    onMs = ((uint32_t)(desiredMs + HEATER_OUTPUT_TICK_MS / 2) / HEATER_OUTPUT_TICK_MS) * HEATER_OUTPUT_TICK_MS;
+  }
+  if (onMs > windowMs) onMs = windowMs;
+
+  if (onMs < minSwitchMs) {
+    onMs = 0;
+  } else if (windowMs - onMs < minSwitchMs) {
+    onMs = windowMs;
+  }
+
+  residualOnMs = constrain(desiredMs - onMs, -(float)windowMs, (float)windowMs);
+  return onMs;
+}
+
+// ======= Output Tick =======
+void stepHeaterOutput() {
+  float duty = requestedDuty.load();
+
+  if (forcedOff.exchange(false)) {
+    feedForwardDuty = 0.0;
+    windowOnMs = 0;
+    windowDuty = 0.0;
+  }
+
+  if (windowPositionMs == 0) {
+    // The feed-forward boost is added on top of whatever the on/off or PID
+    // path asked for, and picked up within one window of pump start
+    feedForwardDuty = getFeedForwardDuty();
+    CoffeeConfig config = getConfigSnapshot();
+    windowLengthMs = config.ssrWindowMs;
+    float total = constrain(duty + feedForwardDuty, 0.0f, 100.0f);
+    windowDuty = total;
+    windowOnMs = planWindow(total, windowLengthMs, config.ssrMinSwitchMs);
+  }
+
+  // Switching off is never deferred to the next window; a 0% request also
+  // drops the boost until the next window start
+  bool on = (duty > 0.0 || feedForwardDuty > 0.0) && windowPositionMs < windowOnMs;
+  writeOutput(on);
+
+  windowPositionMs += HEATER_OUTPUT_TICK_MS;
+  if (windowPositionMs >= windowLengthMs) {
+    windowPositionMs = 0;
+  }
+}
+
+// ======= Timer Setup =======
+#ifdef ARDUINO
+#include "pin_mapping.h"
+
+static esp_timer_handle_t outputTimer = NULL;
+
+static void heaterOutputTick(void *arg) {
+  stepHeaterOutput();
+}
+
+void initHeaterOutput() {
+  pinMode(SSR_HEATING_PIN, OUTPUT);
+  digitalWrite(SSR_HEATING_PIN, LOW);  // Start with heating OFF
+  outputState = false;
+  Serial.println("Heating element pin initialized (OFF)");
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = heaterOutputTick;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "heater_out";
+  if (esp_timer_create(&timerArgs, &outputTimer) != ESP_OK ||
+      esp_timer_start_periodic(outputTimer, HEATER_OUTPUT_TICK_MS * 1000ULL) != ESP_OK) {
+    Serial.println("Error: Failed to start heater output timer!");
+    return;
+  }
+
+  Serial.printf("Heater output: %d ms window, %d ms minimum switch time\n",
+                coffeeConfig.ssrWindowMs, coffeeConfig.ssrMinSwitchMs);
+}
+#endif // ARDUINO
+
+// ======= Public Interface =======
+void setHeaterDuty(float percent) {
+  percent = constrain(percent, 0.0f, 100.0f);
+  requestedDuty = percent;
+  systemState.set(STATE_HEATING, percent > 0.0);
+  if (percent <= 0.0) {
+    forcedOff = true;
+    writeOutput(false);
+  }
+}
+
+float getHeaterDuty() {
+  return requestedDuty.load();
+}
+
+float getAppliedHeaterDuty() {
+  return windowDuty.load();
+}
+
+bool getHeaterOutputState() {
+  return outputState.load();
+}
@@ -0,0 +1,37 @@
+#ifndef HEATER_OUTPUT_H
+#define HEATER_OUTPUT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Heater Output Settings =======
+// The output stage runs from an esp_timer callback at one mains half-cycle
+// (50 Hz). A zero-cross SSR can only switch on these boundaries anyway, so
+// on-times are quantized to this tick.
+#define HEATER_OUTPUT_TICK_MS  10
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Initialize SSR pin and start the time-proportioning timer
+void initHeaterOutput();
+
+// Advance the output stage by one HEATER_OUTPUT_TICK_MS tick (called by the
+// timer on the device, by the simulation clock on the host)
+void stepHeaterOutput();
+
+// Set heater duty cycle (0-100%). Takes effect at the next window start,
+// except 0% which switches the SSR off immediately.
+void setHeaterDuty(float percent);
+
+// Currently requested duty cycle (0-100%)
+float getHeaterDuty();
+
+// Duty planned for the current window, including the shot feed-forward
+float getAppliedHeaterDuty();
+
+// Actual SSR pin state right now
+bool getHeaterOutputState();
+
+#endif // HEATER_OUTPUT_H
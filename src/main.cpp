@@ -1,7 +1,6 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <ESPmDNS.h>
-#include <WiFiUdp.h>
 #include <ArduinoOTA.h>
 
 // Coffee Station Modules
@@ -11,16 +10,22 @@
 #include "storage.h"
 #include "web_server.h"
 #include "display.h"
+#include "control_task.h"
+#include "shared_state.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "telemetry.h"
+#include "telemetry_spool.h"
+#include "health_monitor.h"
+#include "profiler.h"
 #include "credentials.h"  // WiFi and InfluxDB credentials (not in git)
 
 // ======= WiFi Settings =======
 const char* ssid = WIFI_SSID;
 const char* password = WIFI_PASSWORD;
 
-// ======= InfluxDB Settings =======
-WiFiUDP udp;
-byte udp_host[] = {INFLUXDB_HOST[0], INFLUXDB_HOST[1], INFLUXDB_HOST[2], INFLUXDB_HOST[3]};
-int udp_port = INFLUXDB_PORT;
+// ======= InfluxDB / Time Settings =======
+const char* ntpServer = "pool.ntp.org";  // Needed for telemetry timestamps
 
 // ======= mDNS Settings =======
 const char* hostname = "coffee";
@@ -28,17 +33,22 @@ const int maxMDNSTries = 20;
 
 // ======= Global Variables =======
 String hostnameStr = "coffee";
-String payload = "default";
 AsyncWebServer webServer(80);
 
 // Configuration and state instances
 CoffeeConfig coffeeConfig;
 SystemState systemState;
 
-// Timing variables
-unsigned long previousMillis = 0;
+// Telemetry bookkeeping
+uint32_t lastLoggedCycle = 0;
+unsigned long lastLoopMicros = 0;
+uint32_t loopMaxMicros = 0;
 bool otaInProgress = false;
 
+// Serial console command being typed
+char serialLine[32];
+size_t serialLength = 0;
+
 // ======= Helper Functions =======
 bool connectToWiFi(const char* ssid, const char* password, int maxTries = 50) {
   WiFi.begin(ssid, password);
@@ -76,14 +86,65 @@ bool startMDNS() {
   return false;
 }
 
-void send_value(String location, String value) {
-  payload = "temp";
-  payload += ",host="     + hostnameStr;
-  payload += ",location=" + location;
-  payload += " value="    + value;
-  udp.beginPacket(udp_host, udp_port);
-  udp.print(payload);
-  udp.endPacket();
+void logControlSample(const ControlSnapshot& control) {
+  TelemetrySample sample;
+  sample.timestampNs = telemetryNowNs();
+  sample.capturedMs = millis();
+  sample.temp = control.currentTemp;
+  sample.rawTemp = control.rawTemp;
+  sample.target = control.targetTemp;
+  sample.rate = control.tempDerivative;
+  sample.duty = control.heaterDuty;
+  sample.pidP = control.pid.p;
+  sample.pidI = control.pid.i;
+  sample.pidD = control.pid.d;
+  sample.freeHeap = ESP.getFreeHeap();
+  HealthStatus health = getHealthStatus();
+  sample.heapLargest = health.largestBlock;
+  sample.heapMin = health.minFreeHeap;
+  sample.stackMin = health.minStackFree;
+  sample.lvglUsedPct = health.lvglUsedPct;
+  sample.lvglFragPct = health.lvglFragPct;
+  sample.healthAlerts = health.alerts;
+  sample.rssi = WiFi.RSSI();
+  sample.loopMaxUs = loopMaxMicros;
+  sample.controlPeriodUs = control.timing.periodLastUs;
+  sample.controlExecUs = control.timing.execLastUs;
+  sample.sensorFaults = control.sensorFaults;
+  if (!control.sensorFault) sample.flags |= TELEMETRY_FLAG_TEMP_VALID;
+  if (control.state.has(STATE_STEAM_MODE)) sample.flags |= TELEMETRY_FLAG_STEAM_MODE;
+  if (control.heatingElement) sample.flags |= TELEMETRY_FLAG_HEATING;
+  if (control.state.has(STATE_PUMP)) sample.flags |= TELEMETRY_FLAG_PUMP;
+  if (control.state.has(STATE_GRINDER)) sample.flags |= TELEMETRY_FLAG_GRINDER;
+  
+  telemetryAddSample(sample);
+  loopMaxMicros = 0;
+}
+
+// ======= Serial Commands =======
+// One command per line: "profile" prints the hot-path timers,
+// "profile reset" clears them, "calibrate" shows the touch calibration
+// screen
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (serialLength < sizeof(serialLine) - 1) serialLine[serialLength++] = c;
+      continue;
+    }
+    serialLine[serialLength] = '\0';
+    if (strcmp(serialLine, "profile") == 0) {
+      printProfile();
+    } else if (strcmp(serialLine, "profile reset") == 0) {
+      resetProfile();
+      Serial.println("Profile reset");
+    } else if (strcmp(serialLine, "calibrate") == 0) {
+      requestTouchCalibration();
+    } else if (serialLength > 0) {
+      Serial.printf("Unknown command: %s (profile, profile reset, calibrate)\n", serialLine);
+    }
+    serialLength = 0;
+  }
 }
 
 // ======= Setup =======
@@ -99,12 +160,27 @@ void setup() {
   initStorage();
   loadConfiguration();
   
+  // Offline telemetry spool (RAM, optionally LittleFS)
+  initTelemetrySpool(coffeeConfig.telemetrySpoolFlash);
+  
   // Initialize temperature sensor and heating control
   initTemperatureSensor();
   
+  // Pump output and shot timers (pump OFF)
+  initShotEngine();
+  
+  // Grinder output and cutoff timer (grinder OFF)
+  initGrinder();
+  
   // Initialize PID controller
   initPID();
   
+  // Control-cycle trace ring (before the control task starts writing it)
+  initTraceRecorder();
+  
+  // Start the periodic control task (independent of loop() from here on)
+  startControlTask();
+  
   // Connect to WiFi
   if (!connectToWiFi(ssid, password)) {
     Serial.println("Failed to connect to WiFi. Check your credentials and network.");
@@ -127,6 +203,7 @@ void setup() {
   // Set up OTA with priority handling
   ArduinoOTA.onStart([]() {
     otaInProgress = true;
+    flushConfiguration();
     String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
     Serial.println("OTA Start: Updating " + type);
     Serial.println(">>> All normal operations suspended for OTA <<<");
@@ -156,19 +233,36 @@ void setup() {
   Serial.println("OTA ready. Flash with hostname: " + hostnameStr + ".local");
   Serial.println("InfluxDB will use hostname: " + hostnameStr);
   
+  // Telemetry (batched InfluxDB line protocol over UDP, NTP timestamps)
+  configTime(0, 0, ntpServer);
+  initTelemetry(hostnameStr.c_str(), INFLUXDB_HOST, INFLUXDB_PORT);
+  
   // Initialize web server
   setupWebServer();
   
   // Initialize display (LVGL + TFT_eSPI)
   initDisplay();
   
+  // Heap, stack and LVGL pool monitoring (after the tasks and LVGL exist)
+  initHealthMonitor();
+  
   Serial.println("\n========================================");
   Serial.println("   System Ready");
   Serial.println("========================================\n");
 }
 
 // ======= Main Loop =======
+// Heater control runs in its own task (control_task.cpp); loop() only
+// services OTA, the display, the serial console, health monitoring and
+// telemetry.
 void loop() {
+  // Track the longest loop() iteration for telemetry
+  unsigned long nowMicros = micros();
+  if (lastLoopMicros != 0 && nowMicros - lastLoopMicros > loopMaxMicros) {
+    loopMaxMicros = nowMicros - lastLoopMicros;
+  }
+  lastLoopMicros = nowMicros;
+  
   // OTA has highest priority - handle first
   ArduinoOTA.handle();
   
@@ -180,55 +274,32 @@ void loop() {
     return;  // Give OTA full CPU time
   }
   
-  unsigned long currentMillis = millis();
-
-  if (currentMillis - previousMillis >= coffeeConfig.tempUpdateInterval) {
-    previousMillis = currentMillis;
-    
-    // Read temperature from K-type sensor
-    float temperature = readTemperature();
-    
-    if (temperature != -999.0) {
-      // Update system state
-      systemState.currentTemp = temperature;
-      systemState.targetTemp = systemState.steamMode ? coffeeConfig.steamTemp : coffeeConfig.brewTemp;
-      
-      // TEMP: Disabled for touch calibration
-      // Serial.print("Coffee Temperature: ");
-      // Serial.print(temperature);
-      // Serial.print("°C (Target: ");
-      // Serial.print(systemState.targetTemp);
-      // Serial.println("°C)");
-      
-      // Send temperature to InfluxDB if enabled
-      if (coffeeConfig.enableInfluxDB) {
-        send_value("coffee-brew-01", String(temperature));
-        send_value("coffe_target-01", String(systemState.targetTemp));
-      }
-      
-      // Update heating control based on temperature
-      // If autotuning, use autotune control, otherwise use normal control
-      if (isAutotuning()) {
-        updateAutotune();
-      } else {
-        updateHeatingControl();
-      }
-      
-    } else {
-      // TEMP: Disabled for touch calibration
-      // Serial.println("Temperature reading failed - check sensor connection");
-      systemState.currentTemp = -999.0;
-      // Turn off heating if sensor fails
-      if (systemState.heatingElement) {
-        setHeatingElement(false);
-      }
-      // Stop autotune if running
-      if (isAutotuning()) {
-        stopAutotune(false);
-      }
-    }
+  // Serial console commands
+  handleSerialCommands();
+  
+  // Push status changes to web clients (Server-Sent Events)
+  updateEventStream();
+  
+  // Heap, stack and LVGL pool sample (may restart the board while idle)
+  updateHealthMonitor();
+  
+  // Flush old telemetry packets, probe InfluxDB, replay the offline spool
+  bool influxEnabled = getConfigSnapshot().enableInfluxDB;
+  if (influxEnabled) {
+    telemetryLoop();
+  }
+  
+  // Log each new control cycle once
+  ControlSnapshot control = getControlSnapshot();
+  if (control.cycleCount == lastLoggedCycle) {
+    return;
+  }
+  lastLoggedCycle = control.cycleCount;
+  
+  // Queue a telemetry sample for InfluxDB if enabled
+  if (influxEnabled) {
+    logControlSample(control);
   }
 }
 
 // ======= End of main loop =======
-
@@ -0,0 +1,55 @@
+#include "max31855.h"
+
+// ======= Frame Decoding =======
+// D31..D18  thermocouple temperature, signed, 0.25 °C
+// D16       fault (any of D2..D0)
+// D15..D4   cold-junction temperature, signed, 0.0625 °C
+// D2..D0    SCV, SCG, OC
+bool decodeMax31855Frame(uint32_t raw, Max31855Frame &frame) {
+  frame.raw = raw;
+  frame.faults = 0;
+
+  if (raw == 0x00000000 || raw == 0xFFFFFFFF) {
+    frame.faults = MAX31855_FAULT_NO_DEVICE;
+    return false;
+  }
+
+  // Arithmetic shift of the signed fields sign-extends them
+  int32_t thermocouple = (int32_t)raw >> 18;
+  int32_t coldJunction = (int32_t)(raw << 16) >> 20;
+  frame.thermocoupleC = thermocouple * 0.25;
+  frame.coldJunctionC = coldJunction * 0.0625;
+
+  if (raw & 0x00010000) {
+    frame.faults = raw & (MAX31855_FAULT_OPEN | MAX31855_FAULT_SHORT_GND | MAX31855_FAULT_SHORT_VCC);
+    return false;
+  }
+  return true;
+}
+
+#ifdef ARDUINO
+#include <SPI.h>
+#include "pin_mapping.h"
+
+// ======= Hardware SPI =======
+// The display and touch use VSPI; the thermocouple gets HSPI routed to its own pins.
+// Reads are wrapped in SPI transactions so other devices can share the host.
+static SPIClass thermocoupleSpi(HSPI);
+static const SPISettings max31855Settings(MAX31855_SPI_HZ, MSBFIRST, SPI_MODE0);
+
+void initMax31855() {
+  pinMode(MAX31855_CS_PIN, OUTPUT);
+  digitalWrite(MAX31855_CS_PIN, HIGH);
+  thermocoupleSpi.begin(MAX31855_CLK_PIN, MAX31855_DO_PIN, -1, MAX31855_CS_PIN);
+}
+
+bool readMax31855(Max31855Frame &frame) {
+  thermocoupleSpi.beginTransaction(max31855Settings);
+  digitalWrite(MAX31855_CS_PIN, LOW);
+  uint32_t raw = thermocoupleSpi.transfer32(0);
+  digitalWrite(MAX31855_CS_PIN, HIGH);
+  thermocoupleSpi.endTransaction();
+
+  return decodeMax31855Frame(raw, frame);
+}
+#endif // ARDUINO
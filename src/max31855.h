@@ -0,0 +1,32 @@
+#ifndef MAX31855_H
+#define MAX31855_H
+
+#include <stdint.h>
+
+// ======= MAX31855 Settings =======
+#define MAX31855_SPI_HZ  4000000   // Datasheet maximum is 5 MHz
+
+// Fault bits (D2..D0 of the 32-bit frame), plus a driver-level flag
+#define MAX31855_FAULT_OPEN       0x01  // Thermocouple not connected
+#define MAX31855_FAULT_SHORT_GND  0x02  // Shorted to GND
+#define MAX31855_FAULT_SHORT_VCC  0x04  // Shorted to VCC
+#define MAX31855_FAULT_NO_DEVICE  0x80  // Bus idle (all 0s or all 1s)
+
+// One decoded 32-bit conversion result
+struct Max31855Frame {
+  float thermocoupleC = 0.0;   // 14-bit, 0.25 °C resolution
+  float coldJunctionC = 0.0;   // 12-bit, 0.0625 °C resolution
+  uint8_t faults = 0;          // MAX31855_FAULT_* bits
+  uint32_t raw = 0;
+};
+
+// Decode a raw frame; returns false if any fault is set
+bool decodeMax31855Frame(uint32_t raw, Max31855Frame &frame);
+
+// Hardware SPI reader using the pins from pin_mapping.h
+void initMax31855();
+
+// Read and decode one frame in a single 32-bit SPI transaction
+bool readMax31855(Max31855Frame &frame);
+
+#endif // MAX31855_H
@@ -1,174 +1,148 @@
 #include "pid_control.h"
-#include <PID_v1.h>
-#include <sTune.h>
-
-// Forward declaration for saving configuration
-void saveConfiguration();
+#include "heater_output.h"
+#include "temperature.h"
+#include "hal.h"
+#include "profiler.h"
 
 // ======= PID Control Variables =======
-static double pidInput = 0.0;      // Current temperature (input to PID)
-static double pidOutput = 0.0;     // PID output (0-255)
-static double pidSetpoint = 0.0;   // Target temperature (setpoint for PID)
-static PID heatingPID(&pidInput, &pidOutput, &pidSetpoint, 
-                      2.0, 5.0, 1.0, DIRECT);  // Initial values, will be updated
+// Same form as PID_v1 (proportional on error, clamped integral, derivative
+// on measurement), but the derivative comes from the filtered acquisition
+// stage instead of differencing two noisy samples.
+#define PID_OUTPUT_MIN 0.0
+#define PID_OUTPUT_MAX 255.0
+#define PID_REINIT_PERIODS 3    // Re-initialize after this many missed updates
 
-// ======= PID AutoTune Variables =======
-static float tuneInput = 0.0;
-static float tuneOutput = 0.0;
-static sTune tuner = sTune(&tuneInput, &tuneOutput, sTune::ZN_PID, sTune::directIP, sTune::printOFF);
-static bool autotuning = false;
-static unsigned long autotuneStartTime = 0;
-static const unsigned long AUTOTUNE_TIMEOUT = 600000; // 10 minutes timeout
+static float pidIntegral = 0.0;
+static float pidOutput = 0.0;      // PID output (0-255)
+static PIDTerms pidTerms;
+static unsigned long pidLastUpdate = 0;
+static float pidLastTarget = 0.0;
+static float pidLastKp = 0.0;
 
 // ======= PID Initialization =======
 void initPID() {
-  heatingPID.SetMode(AUTOMATIC);
-  heatingPID.SetOutputLimits(0, 255);
-  heatingPID.SetSampleTime(1000); // 1 second sample time
-  heatingPID.SetTunings(coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd);
+  pidIntegral = 0.0;
+  pidOutput = 0.0;
+  pidLastUpdate = 0;
   
   Serial.println("PID controller initialized");
-  Serial.printf("PID Parameters: Kp=%.3f, Ki=%.3f, Kd=%.3f, Mode=%s\n", 
+  Serial.printf("PID Parameters: Kp=%.3f, Ki=%.3f, Kd=%.3f (steam %.3f/%.3f/%.3f), Mode=%s\n",
                 coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd,
-                coffeeConfig.usePID ? "PID" : "On/Off");
+                coffeeConfig.steamKp, coffeeConfig.steamKi, coffeeConfig.steamKd,
+                controlModeName(coffeeConfig.controlMode));
 }
 
 // ======= Update PID Tunings =======
-void updatePIDTunings(float kp, float ki, float kd) {
-  coffeeConfig.pidKp = kp;
-  coffeeConfig.pidKi = ki;
-  coffeeConfig.pidKd = kd;
-  heatingPID.SetTunings(kp, ki, kd);
-  Serial.printf("PID tunings updated: Kp=%.3f, Ki=%.3f, Kd=%.3f\n", kp, ki, kd);
-}
-
-// ======= PID Control Update =======
-void updatePIDControl(float currentTemp, float targetTemp) {
-  pidInput = currentTemp;
-  pidSetpoint = targetTemp;
-  
-  heatingPID.Compute();
-  
-  // PID output is 0-255, convert to percentage and use threshold
-  // For SSR: >50% = ON, <=50% = OFF (you can adjust this threshold)
-  float outputPercent = (pidOutput / 255.0) * 100.0;
-  
-  if (outputPercent > 50.0) {
-    if (!systemState.heatingElement) {
-      setHeatingElement(true);
-    }
+void updatePIDTunings(bool steam, float kp, float ki, float kd) {
+  if (steam) {
+    coffeeConfig.steamKp = kp;
+    coffeeConfig.steamKi = ki;
+    coffeeConfig.steamKd = kd;
   } else {
-    if (systemState.heatingElement) {
-      setHeatingElement(false);
-    }
-  }
-  
-  // Optional: Print PID debug info
-  static unsigned long lastDebug = 0;
-  if (millis() - lastDebug > 5000) {
-    lastDebug = millis();
-    Serial.printf("PID: Input=%.2f, Setpoint=%.2f, Output=%.2f (%.1f%%)\n", 
-                  pidInput, pidSetpoint, pidOutput, outputPercent);
+    coffeeConfig.pidKp = kp;
+    coffeeConfig.pidKi = ki;
+    coffeeConfig.pidKd = kd;
   }
+  Serial.printf("PID %s tunings updated: Kp=%.3f, Ki=%.3f, Kd=%.3f\n",
+                steam ? "steam" : "brew", kp, ki, kd);
 }
 
-// ======= AutoTune Functions =======
-void startAutotune() {
-  if (autotuning) {
-    Serial.println("Autotune already running!");
-    return;
-  }
-  
-  // Configure autotune for espresso machine
-  tuner.Configure(50.0,     // Input span (temperature range, e.g., 50°C)
-                  255.0,    // Output span (0-255)
-                  0.0,      // Output start
-                  128.0,    // Output step (50% of range)
-                  10,       // Test time (seconds)
-                  10,       // Settle time (seconds)
-                  300);     // Samples
-  
-  tuner.SetEmergencyStop(systemState.targetTemp + 10.0); // Emergency stop 10°C above target
-  
-  autotuning = true;
-  autotuneStartTime = millis();
-  systemState.currentOperation = "AutoTuning PID";
-  
-  Serial.println("=== PID AutoTune Started ===");
-  Serial.printf("Target Temperature: %.2f°C\n", systemState.targetTemp);
+// ======= Gain Schedule =======
+// The brew set applies at or below brewTemp, the steam set at or above
+// steamTemp, linearly interpolated in between. Scheduling on the measured
+// temperature moves the gains gradually while the boiler heats or cools
+// between the two setpoints.
+PIDGains getScheduledGains(float temp) {
+  float span = coffeeConfig.steamTemp - coffeeConfig.brewTemp;
+  float w = span > 0.0 ? constrain((temp - coffeeConfig.brewTemp) / span, 0.0f, 1.0f) : 0.0;
+
+  PIDGains gains;
+  gains.kp = coffeeConfig.pidKp + w * (coffeeConfig.steamKp - coffeeConfig.pidKp);
+  gains.ki = coffeeConfig.pidKi + w * (coffeeConfig.steamKi - coffeeConfig.pidKi);
+  gains.kd = coffeeConfig.pidKd + w * (coffeeConfig.steamKd - coffeeConfig.pidKd);
+  return gains;
 }
 
-void stopAutotune(bool saveResults) {
-  if (!autotuning) {
-    return;
-  }
+// ======= PID Control Update =======
+void updatePIDControl(float currentTemp, float derivative, float targetTemp) {
+  updatePIDControlWithGains(currentTemp, derivative, targetTemp, getScheduledGains(currentTemp));
+}
+
+void updatePIDControlWithGains(float currentTemp, float derivative, float targetTemp,
+                               const PIDGains &gains) {
+  PROFILE_SCOPE("updatePIDControl");
+  unsigned long now = halMillis();
+  float dt = (now - pidLastUpdate) / 1000.0;
+  float error = targetTemp - currentTemp;
   
-  autotuning = false;
+  // Coming back from on/off mode or autotune: start from the current output
+  // (like PID_v1's Initialize) instead of a stale integral
+  if (pidLastUpdate == 0 ||
+      now - pidLastUpdate > (unsigned long)coffeeConfig.tempUpdateInterval * PID_REINIT_PERIODS) {
+    pidIntegral = constrain(getHeaterDuty() * 2.55f, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
+    dt = coffeeConfig.tempUpdateInterval / 1000.0;
+    pidLastTarget = targetTemp;
+    pidLastKp = gains.kp;
+  }
+  pidLastUpdate = now;
   
-  if (saveResults) {
-    // Get the tuned parameters
-    coffeeConfig.pidKp = tuner.GetKp();
-    coffeeConfig.pidKi = tuner.GetKi();
-    coffeeConfig.pidKd = tuner.GetKd();
-    
-    // Update the PID controller with new parameters
-    heatingPID.SetTunings(coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd);
-    
-    // Save to flash
-    saveConfiguration();
-    
-    Serial.println("=== AutoTune Complete - Parameters Saved ===");
-    Serial.printf("Kp: %.3f, Ki: %.3f, Kd: %.3f\n", 
-                  coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd);
-  } else {
-    Serial.println("=== AutoTune Cancelled ===");
+  // Setpoint jump (brew <-> steam): the integral holds the power needed to
+  // balance the losses at the old setpoint. Losses scale with the distance
+  // to ambient, so carry it over in that ratio instead of letting the
+  // integrator unwind through a long overshoot.
+  if (fabsf(targetTemp - pidLastTarget) > PID_SETPOINT_JUMP_C &&
+      pidLastTarget > PID_AMBIENT_C + 1.0 && targetTemp > PID_AMBIENT_C) {
+    float ratio = (targetTemp - PID_AMBIENT_C) / (pidLastTarget - PID_AMBIENT_C);
+    pidIntegral = constrain(pidIntegral * ratio, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
+    Serial.printf("PID: setpoint %.1f -> %.1f, integral rescaled x%.2f\n",
+                  pidLastTarget, targetTemp, ratio);
   }
+  pidLastTarget = targetTemp;
   
-  systemState.currentOperation = "Idle";
-  // Turn off heating element
-  setHeatingElement(false);
-}
-
-void updateAutotune() {
-  if (!autotuning) {
-    return;
+  pidTerms.p = gains.kp * error;
+  pidTerms.d = -gains.kd * derivative;
+  float unclamped = pidTerms.p + pidIntegral + pidTerms.d;
+  
+  // Bumpless gain change: keep Kp * error + integral continuous when the
+  // schedule moves Kp. While the output is saturated there is no bump to
+  // hide and the correction would only drain the integral.
+  bool saturated = unclamped >= PID_OUTPUT_MAX || unclamped <= PID_OUTPUT_MIN;
+  if (!saturated) {
+    pidIntegral = constrain(pidIntegral + (pidLastKp - gains.kp) * error,
+                            PID_OUTPUT_MIN, PID_OUTPUT_MAX);
   }
+  pidLastKp = gains.kp;
   
-  // Check for timeout
-  if (millis() - autotuneStartTime > AUTOTUNE_TIMEOUT) {
-    Serial.println("AutoTune timeout - stopping");
-    stopAutotune(false);
-    return;
+  // Anti-windup (conditional integration): do not integrate while the
+  // output is saturated in the direction the error pushes it, so a large
+  // setpoint step arrives with the integral near its holding-power estimate
+  bool windingUp = (unclamped >= PID_OUTPUT_MAX && error > 0.0) ||
+                   (unclamped <= PID_OUTPUT_MIN && error < 0.0);
+  if (!windingUp) {
+    pidIntegral = constrain(pidIntegral + gains.ki * error * dt, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
   }
+  pidTerms.i = pidIntegral;
+  pidOutput = constrain(pidTerms.p + pidTerms.i + pidTerms.d, PID_OUTPUT_MIN, PID_OUTPUT_MAX);
+  pidTerms.output = pidOutput;
+  pidTerms.gains = gains;
   
-  // Update autotune with current temperature
-  tuneInput = systemState.currentTemp;
+  // PID output is 0-255, convert to a duty cycle for the SSR output window
+  float outputPercent = (pidOutput / 255.0) * 100.0;
+  setHeaterDuty(outputPercent);
   
-  // Run the tuner
-  switch (tuner.Run()) {
-    case tuner.sample:
-      // Still sampling, control output based on tuner
-      // The output is stored in the tuneOutput variable by reference
-      if (tuneOutput > 128) {
-        setHeatingElement(true);
-      } else {
-        setHeatingElement(false);
-      }
-      break;
-      
-    case tuner.tunings:
-      // Tuning complete
-      Serial.println("AutoTune sampling complete!");
-      stopAutotune(true);
-      break;
-      
-    case tuner.runPid:
-      // Should not happen during autotune
-      break;
+  // Optional: Print PID debug info
+  static unsigned long lastDebug = 0;
+  if (halMillis() - lastDebug > 5000) {
+    lastDebug = halMillis();
+    Serial.printf("PID: Input=%.2f (%.3f/s), Setpoint=%.2f, Output=%.2f (%.1f%%)\n", 
+                  currentTemp, derivative, targetTemp, pidOutput, outputPercent);
   }
 }
 
-bool isAutotuning() {
-  return autotuning;
+void resetPID() {
+  pidLastUpdate = 0;
 }
 
+PIDTerms getPIDTerms() {
+  return pidTerms;
+}
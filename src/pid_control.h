@@ -8,23 +8,50 @@
 extern CoffeeConfig coffeeConfig;
 extern SystemState systemState;
 
+// ======= Gain Scheduling =======
+#define PID_SETPOINT_JUMP_C  5.0    // Larger setpoint changes rescale the integral
+#define PID_AMBIENT_C        25.0   // Loss reference for that rescale
+
+struct PIDGains {
+  float kp = 0.0;
+  float ki = 0.0;
+  float kd = 0.0;
+};
+
+// Contribution of each PID term to the last output (0-255 scale)
+struct PIDTerms {
+  float p = 0.0;
+  float i = 0.0;
+  float d = 0.0;
+  float output = 0.0;
+  PIDGains gains;       // Scheduled gains used for it
+};
+
 // Forward declaration of heating control
 void setHeatingElement(bool state);
 
 // Initialize PID controller
 void initPID();
 
-// Update PID tuning parameters
-void updatePIDTunings(float kp, float ki, float kd);
+// Update the brew (steam = false) or steam tuning set
+void updatePIDTunings(bool steam, float kp, float ki, float kd);
+
+// Gains interpolated between the brew and steam sets for this temperature
+PIDGains getScheduledGains(float temp);
 
 // PID control update (called from temperature module)
-void updatePIDControl(float currentTemp, float targetTemp);
+// derivative is the filtered temperature rate (°C/s) from the acquisition stage
+void updatePIDControl(float currentTemp, float derivative, float targetTemp);
+
+// Same update with fixed gains instead of the schedule (autotune step tests)
+void updatePIDControlWithGains(float currentTemp, float derivative, float targetTemp,
+                               const PIDGains &gains);
+
+// Start the next update from the current heater duty, as after a pause
+void resetPID();
 
-// AutoTune functions
-void startAutotune();
-void stopAutotune(bool saveResults);
-void updateAutotune();
-bool isAutotuning();
+// Terms of the most recent PID update
+PIDTerms getPIDTerms();
 
 #endif // PID_CONTROL_H
 
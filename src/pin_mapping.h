@@ -9,13 +9,23 @@
 // ============================================================================
 #define MAX31855_CS_PIN   16  // Chip Select pin (was GPIO 5, now GPIO 16)
 #define MAX31855_CLK_PIN  17  // Clock pin (was GPIO 18, now GPIO 17)  
-#define MAX31855_DO_PIN   27  // Data Out pin (was GPIO 19, now GPIO 27)
+#define MAX31855_DO_PIN   35  // Data Out pin (was GPIO 27, now GPIO 35 on P3; input-only is fine)
 
 // ============================================================================
 // HEATING ELEMENT CONTROL - Remapped to avoid touch/SD conflicts
 // ============================================================================
 #define SSR_HEATING_PIN  26  // SSR control (was GPIO 2)
 
+// ============================================================================
+// PUMP CONTROL
+// ============================================================================
+#define PUMP_PIN         22  // Pump SSR/relay (CN1 connector)
+
+// ============================================================================
+// GRINDER CONTROL
+// ============================================================================
+#define GRINDER_PIN      27  // Grinder relay (CN1 connector)
+
 // ============================================================================
 // DISPLAY PINS (Internal to ESP32-2432S028R - DO NOT CHANGE)
 // ============================================================================
@@ -24,24 +34,35 @@
 // - GPIO 21, 22 (DC, RST)
 // - GPIO 15 (Backlight)
 
-// Touch Controller:
-// - GPIO 2, 4 (Touch I2C)
+// TFT Display (SPI):
+// - GPIO 12, 13, 14, 15 (MISO, MOSI, SCLK, CS)
+// - GPIO 2 (DC)
+// - GPIO 21 (Backlight, also on P3)
+
+// Touch Controller (XPT2046, own SPI):
+// - GPIO 25, 32, 39, 33 (CLK, MOSI, MISO, CS)
+// - GPIO 36 (PENIRQ)
+
+// SD Card (SPI):
+// - GPIO 5, 18, 19, 23
 
-// SD Card:
-// - GPIO 15, 2 (SD SPI)
+// RGB LED (active low):
+// - GPIO 4, 16, 17 (red, green, blue pads)
 
 // ============================================================================
-// AVAILABLE GPIOs FOR FUTURE EXPANSION
+// HEADER PINS
 // ============================================================================
-// GPIO 0, 4, 16, 17, 21, 22, 23, 25, 26, 27, 32, 33
-// Note: Some may be used by display internally
+// CN1: GPIO 22, 27    P3: GPIO 21 (backlight), 22, 35 (input only)
+// All header pins are in use; the MAX31855 CS/CLK take the green/blue LED pads
 
 // ============================================================================
 // PIN VALIDATION
 // ============================================================================
 // Verify these pins don't conflict with display:
-// - MAX31855: 16, 17, 27 ✓ (safe)
-// - SSR: 26 ✓ (safe)
+// - MAX31855: 16, 17, 35 ✓ (safe)
+// - SSR: 26 ✓ (speaker connector)
+// - Pump: 22 ✓ (safe)
+// - Grinder: 27 ✓ (safe)
 // - All pins are 3.3V compatible ✓
 
 #endif // PIN_MAPPING_H
@@ -0,0 +1,125 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+#include <string.h>
+
+// ======= Site Table =======
+// Sites register themselves the first time their scope runs and are never
+// removed. Records come from several tasks on both cores, so the table is
+// guarded by one spinlock; a record holds it for a few dozen cycles.
+static portMUX_TYPE profileMux = portMUX_INITIALIZER_UNLOCKED;
+static ProfileSite sites[PROFILE_MAX_SITES];
+static int siteCount = 0;
+static uint32_t cyclesPerUs = 0;           // CPU clock in MHz, read at the first registration
+
+ProfileSite *profileRegister(const char *name) {
+  if (cyclesPerUs == 0) cyclesPerUs = getCpuFrequencyMhz();
+  ProfileSite *site = NULL;
+  portENTER_CRITICAL(&profileMux);
+  // Scopes in inline code can register the same name more than once
+  for (int i = 0; i < siteCount && site == NULL; i++) {
+    if (strcmp(sites[i].name, name) == 0) site = &sites[i];
+  }
+  if (site == NULL && siteCount < PROFILE_MAX_SITES) {
+    site = &sites[siteCount++];
+    site->name = name;
+  }
+  portEXIT_CRITICAL(&profileMux);
+  if (site == NULL) {
+    Serial.printf("Profiler: table full, %s not timed\n", name);
+  }
+  return site;
+}
+
+static int bucketOf(uint32_t us) {
+  int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+  return bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1;
+}
+
+void profileRecord(ProfileSite *site, uint32_t cycles) {
+  int bucket = bucketOf(cycles / cyclesPerUs);
+  portENTER_CRITICAL(&profileMux);
+  if (site->count == 0 || cycles < site->minCycles) site->minCycles = cycles;
+  if (cycles > site->maxCycles) site->maxCycles = cycles;
+  site->count++;
+  site->totalCycles += cycles;
+  site->buckets[bucket]++;
+  portEXIT_CRITICAL(&profileMux);
+}
+
+void profileMigrated(ProfileSite *site) {
+  portENTER_CRITICAL(&profileMux);
+  site->migrated++;
+  portEXIT_CRITICAL(&profileMux);
+}
+
+// ======= Readout =======
+int getProfileSiteCount() {
+  portENTER_CRITICAL(&profileMux);
+  int count = siteCount;
+  portEXIT_CRITICAL(&profileMux);
+  return count;
+}
+
+bool getProfileSite(int index, ProfileSite &out) {
+  bool valid = false;
+  portENTER_CRITICAL(&profileMux);
+  if (index >= 0 && index < siteCount) {
+    out = sites[index];
+    valid = true;
+  }
+  portEXIT_CRITICAL(&profileMux);
+  return valid;
+}
+
+uint32_t profileCyclesPerUs() {
+  return cyclesPerUs;
+}
+
+void resetProfile() {
+  portENTER_CRITICAL(&profileMux);
+  for (int i = 0; i < siteCount; i++) {
+    const char *name = sites[i].name;
+    sites[i] = ProfileSite();
+    sites[i].name = name;
+  }
+  portEXIT_CRITICAL(&profileMux);
+}
+
+void printProfile() {
+  int count = getProfileSiteCount();
+  Serial.printf("%-26s %9s %11s %9s %9s %9s\n", "site", "count", "total ms", "mean us",
+                "min us", "max us");
+  for (int i = 0; i < count; i++) {
+    ProfileSite site;
+    if (!getProfileSite(i, site) || site.count == 0) continue;
+    Serial.printf("%-26s %9lu %11.1f %9.1f %9.1f %9.1f\n", site.name, (unsigned long)site.count,
+                  site.totalCycles / (cyclesPerUs * 1000.0),
+                  site.totalCycles / (double)cyclesPerUs / site.count,
+                  site.minCycles / (double)cyclesPerUs, site.maxCycles / (double)cyclesPerUs);
+  }
+}
+
+#else
+// ======= Built Without the Profiler =======
+#include <Arduino.h>
+
+int getProfileSiteCount() {
+  return 0;
+}
+
+bool getProfileSite(int, ProfileSite &) {
+  return false;
+}
+
+uint32_t profileCyclesPerUs() {
+  return 0;
+}
+
+void resetProfile() {
+}
+
+void printProfile() {
+  Serial.println("Profiler not built in (add -D ENABLE_PROFILER to build_flags)");
+}
+#endif // ENABLE_PROFILER
@@ -0,0 +1,82 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// ======= Profiler Settings =======
+// Scoped timers on the CPU cycle counter for the hot paths. Each
+// PROFILE_SCOPE("name") times the rest of its block and adds it to the
+// site's count, total, min, max and histogram. Times are inclusive: the
+// LVGL timer handler also contains the flushes and touch reads it calls.
+// Built with -D ENABLE_PROFILER (platformio.ini); without it the macro
+// expands to nothing and no table is kept.
+#define PROFILE_MAX_SITES   48
+#define PROFILE_BUCKETS     20   // Bucket n: [2^(n-1), 2^n) µs, 0: under 1 µs, last: open-ended
+
+struct ProfileSite {
+  const char *name = 0;
+  uint32_t count = 0;
+  uint64_t totalCycles = 0;
+  uint32_t minCycles = 0;
+  uint32_t maxCycles = 0;
+  uint32_t migrated = 0;     // Dropped: the task moved to the other core meanwhile
+  uint32_t buckets[PROFILE_BUCKETS] = {};
+};
+
+#ifdef ENABLE_PROFILER
+#include <Arduino.h>
+#define PROFILER_ENABLED 1
+
+// Find or add the site for a name (stored by pointer, use a literal).
+// NULL when the table is full.
+ProfileSite *profileRegister(const char *name);
+
+// Add one timing to a site
+void profileRecord(ProfileSite *site, uint32_t cycles);
+void profileMigrated(ProfileSite *site);
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfileSite *site)
+      : site(site), core(xPortGetCoreID()), start(ESP.getCycleCount()) {}
+  ~ProfileScope() {
+    uint32_t cycles = ESP.getCycleCount() - start;
+    if (site == 0) return;
+    // The cycle counters of the two cores are unrelated
+    if ((int)xPortGetCoreID() == core) {
+      profileRecord(site, cycles);
+    } else {
+      profileMigrated(site);
+    }
+  }
+
+ private:
+  ProfileSite *site;
+  int core;
+  uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name)                                                           \
+  static ProfileSite *const PROFILE_CONCAT(profileSite, __LINE__) = profileRegister(name); \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileSite, __LINE__))
+
+#else
+#define PROFILER_ENABLED 0
+#define PROFILE_SCOPE(name) do {} while (0)
+#endif // ENABLE_PROFILER
+
+// Sites registered so far (0 when built without the profiler)
+int getProfileSiteCount();
+
+// Copy of one site, consistent with itself. False past the end.
+bool getProfileSite(int index, ProfileSite &out);
+
+uint32_t profileCyclesPerUs();
+void resetProfile();
+
+// Table on the serial console ("profile" command)
+void printProfile();
+
+#endif // PROFILER_H
@@ -0,0 +1,268 @@
+#include "shared_state.h"
+#include <atomic>
+#include <stddef.h>
+#include "control_task.h"
+#include "temperature.h"
+#include "grinder.h"
+#include "storage.h"
+#include "hal.h"
+
+// ======= Command Queue =======
+// Bounded multi-producer queue (Vyukov): a poster claims a position with a
+// compare-and-swap on enqueuePos, fills the slot, then releases it by
+// advancing the slot's sequence. The control task is the only consumer.
+// Sequences are stored relative to the slot index, so the zero-initialized
+// queue is empty and usable before any init call.
+static_assert((COMMAND_QUEUE_SIZE & (COMMAND_QUEUE_SIZE - 1)) == 0,
+              "COMMAND_QUEUE_SIZE must be a power of two");
+
+struct CommandSlot {
+  std::atomic<uint32_t> seq;
+  Command command;
+};
+
+static CommandSlot slots[COMMAND_QUEUE_SIZE];
+static std::atomic<uint32_t> enqueuePos(0);
+static uint32_t dequeuePos = 0;               // Control task only
+
+// Staged configuration for CMD_APPLY_CONFIG; only stagedFields are applied
+enum StageState { STAGE_FREE = 0, STAGE_WRITING, STAGE_READY };
+static CoffeeConfig stagedConfig;
+static ConfigFields stagedFields = 0;
+static std::atomic<int> stageState(STAGE_FREE);
+
+// Where each ConfigFields bit lives in CoffeeConfig (bit n = entry n)
+struct ConfigFieldInfo {
+  const char *key;
+  size_t offset;
+  size_t size;
+};
+
+#define CONFIG_FIELD(name) { #name, offsetof(CoffeeConfig, name), sizeof(CoffeeConfig::name) }
+
+static const ConfigFieldInfo CONFIG_FIELDS[] = {
+  CONFIG_FIELD(brewTemp), CONFIG_FIELD(steamTemp), CONFIG_FIELD(shotSizes),
+  CONFIG_FIELD(shotPreinfusionMs), CONFIG_FIELD(shotPreinfusionDuty), CONFIG_FIELD(shotRampMs),
+  CONFIG_FIELD(ffEnable), CONFIG_FIELD(ffLearn), CONFIG_FIELD(ffBoostPct), CONFIG_FIELD(ffTailMs),
+  CONFIG_FIELD(grindTimes), CONFIG_FIELD(grindMode), CONFIG_FIELD(grindDoses), CONFIG_FIELD(grindRates),
+  CONFIG_FIELD(pidKp), CONFIG_FIELD(pidKi), CONFIG_FIELD(pidKd),
+  CONFIG_FIELD(steamKp), CONFIG_FIELD(steamKi), CONFIG_FIELD(steamKd), CONFIG_FIELD(controlMode),
+  CONFIG_FIELD(modelGain), CONFIG_FIELD(modelTauS), CONFIG_FIELD(modelDeadTimeS), CONFIG_FIELD(smithLambdaS),
+  CONFIG_FIELD(ssrWindowMs), CONFIG_FIELD(ssrMinSwitchMs),
+  CONFIG_FIELD(enableInfluxDB), CONFIG_FIELD(telemetrySpoolFlash), CONFIG_FIELD(healthRestart),
+  CONFIG_FIELD(tempUpdateInterval), CONFIG_FIELD(eventIntervalMs),
+  CONFIG_FIELD(tempMedianSize), CONFIG_FIELD(tempFilterMode), CONFIG_FIELD(tempFilterAlpha),
+  CONFIG_FIELD(tempKalmanQ), CONFIG_FIELD(touchCal), CONFIG_FIELD(touchCalibrated)
+};
+
+#undef CONFIG_FIELD
+
+static const size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+static_assert(CONFIG_FIELD_COUNT <= 64,
+              "one ConfigFields bit per field");
+
+// Counters
+static std::atomic<uint32_t> posted(0);
+static std::atomic<uint32_t> applied(0);
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<uint32_t> maxDepth(0);
+static std::atomic<uint32_t> postRetries(0);
+static std::atomic<uint32_t> configBusy(0);
+static std::atomic<uint32_t> configReads(0);
+static std::atomic<uint32_t> configRetries(0);
+
+static uint32_t slotSeq(uint32_t pos) {
+  return slots[pos % COMMAND_QUEUE_SIZE].seq.load(std::memory_order_acquire) +
+         pos % COMMAND_QUEUE_SIZE;
+}
+
+static void setSlotSeq(uint32_t pos, uint32_t seq) {
+  slots[pos % COMMAND_QUEUE_SIZE].seq.store(seq - pos % COMMAND_QUEUE_SIZE,
+                                            std::memory_order_release);
+}
+
+bool postCommand(CommandType type, int32_t value, float arg) {
+  uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+  for (;;) {
+    int32_t diff = (int32_t)(slotSeq(pos) - pos);
+    if (diff == 0) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      postRetries.fetch_add(1, std::memory_order_relaxed);
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  Command &command = slots[pos % COMMAND_QUEUE_SIZE].command;
+  command.type = type;
+  command.value = value;
+  command.arg = arg;
+  setSlotSeq(pos, pos + 1);
+
+  posted.fetch_add(1, std::memory_order_relaxed);
+  uint32_t depth = pos + 1 - applied.load(std::memory_order_relaxed);
+  uint32_t seen = maxDepth.load(std::memory_order_relaxed);
+  while (depth > seen && !maxDepth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+  }
+  wakeControlTask();
+  return true;
+}
+
+static bool takeCommand(Command &command) {
+  if ((int32_t)(slotSeq(dequeuePos) - (dequeuePos + 1)) < 0) return false;
+  command = slots[dequeuePos % COMMAND_QUEUE_SIZE].command;
+  setSlotSeq(dequeuePos, dequeuePos + COMMAND_QUEUE_SIZE);
+  dequeuePos++;
+  return true;
+}
+
+ConfigFields configField(const char *key) {
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (strcmp(CONFIG_FIELDS[i].key, key) == 0) return (ConfigFields)1 << i;
+  }
+  return 0;
+}
+
+bool postConfig(const CoffeeConfig &config, ConfigFields fields) {
+  int expected = STAGE_FREE;
+  if (!stageState.compare_exchange_strong(expected, STAGE_WRITING)) {
+    configBusy.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  memcpy(&stagedConfig, &config, sizeof(CoffeeConfig));
+  stagedFields = fields;
+  stageState.store(STAGE_READY, std::memory_order_release);
+  if (!postCommand(CMD_APPLY_CONFIG)) {
+    stageState = STAGE_FREE;
+    return false;
+  }
+  return true;
+}
+
+// ======= Command Handling (control task) =======
+// Copy the staged fields into coffeeConfig; true if any value changed
+static bool applyStagedConfig() {
+  bool changed = false;
+  for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+    if (!(stagedFields & ((ConfigFields)1 << i))) continue;
+    uint8_t *to = (uint8_t *)&coffeeConfig + CONFIG_FIELDS[i].offset;
+    const uint8_t *from = (const uint8_t *)&stagedConfig + CONFIG_FIELDS[i].offset;
+    if (memcmp(to, from, CONFIG_FIELDS[i].size) != 0) {
+      memcpy(to, from, CONFIG_FIELDS[i].size);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+static void setSteamMode(bool steam) {
+  systemState.set(STATE_STEAM_MODE, steam);
+  systemState.targetTemp = steam ? coffeeConfig.steamTemp : coffeeConfig.brewTemp;
+  systemState.operation = steam ? OP_STEAM_MODE : OP_BREW_MODE;
+  systemState.operationStartMs = halMillis();
+}
+
+static void apply(const Command &command) {
+  switch (command.type) {
+    case CMD_TOGGLE_HEATING:
+      setHeatingElement(!systemState.has(STATE_HEATING));
+      break;
+    case CMD_SET_STEAM_MODE:
+      setSteamMode(command.value != 0);
+      break;
+    case CMD_TOGGLE_STEAM_MODE:
+      setSteamMode(!systemState.has(STATE_STEAM_MODE));
+      break;
+    case CMD_SELECT_SHOT_SIZE:
+      if (command.value >= 0 && command.value <= 3) systemState.selectedShotSize = command.value;
+      break;
+    case CMD_SELECT_GRIND:
+      if (command.value >= 0 && command.value <= 1) systemState.selectedGrindTime = command.value;
+      break;
+    case CMD_APPLY_CONFIG:
+      // The controller reads its gains from coffeeConfig every cycle and
+      // bumps its integral itself when they change. Fields the sender did
+      // not edit keep the control task's values, even if its snapshot was
+      // older than a learning step or an autotune result.
+      if (stageState.load(std::memory_order_acquire) == STAGE_READY) {
+        bool changed = applyStagedConfig();
+        stageState = STAGE_FREE;
+        if (changed) saveConfiguration();
+      }
+      break;
+    case CMD_LEARN_GRIND_RATE:
+      if (command.value >= 0 && command.value <= 1) {
+        // Exponential average so one odd weighing does not throw the rate off
+        float &rate = coffeeConfig.grindRates[command.value];
+        rate = rate > 0.0 ? rate + GRIND_RATE_ALPHA * (command.arg - rate) : command.arg;
+        saveConfiguration();
+        Serial.printf("%s grind rate now %.2f g/s\n", coffeeConfig.grindNames[command.value], rate);
+      }
+      break;
+  }
+}
+
+int applyCommands() {
+  int count = 0;
+  Command command;
+  while (takeCommand(command)) {
+    apply(command);
+    applied.fetch_add(1, std::memory_order_relaxed);
+    count++;
+  }
+  if (count > 0) publishConfig();
+  return count;
+}
+
+// ======= Configuration Publication (seqlock) =======
+// Same scheme as the control snapshot: the control task copies coffeeConfig
+// here whenever it changed (commands, autotune, learning), readers retry a
+// copy that overlapped it.
+static CoffeeConfig publishedConfig;
+static std::atomic<uint32_t> configSeq(0);
+
+void publishConfig() {
+  if (memcmp(&publishedConfig, &coffeeConfig, sizeof(CoffeeConfig)) == 0 &&
+      configSeq.load(std::memory_order_relaxed) != 0) {
+    return;
+  }
+  uint32_t seq = configSeq.load(std::memory_order_relaxed);
+  configSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&publishedConfig, &coffeeConfig, sizeof(CoffeeConfig));
+  configSeq.store(seq + 2, std::memory_order_release);
+}
+
+CoffeeConfig getConfigSnapshot() {
+  CoffeeConfig copy;
+  uint32_t before, after;
+  configReads.fetch_add(1, std::memory_order_relaxed);
+  for (;;) {
+    before = configSeq.load(std::memory_order_acquire);
+    memcpy(&copy, &publishedConfig, sizeof(CoffeeConfig));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = configSeq.load(std::memory_order_relaxed);
+    if (!(before & 1) && before == after) break;
+    configRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+  return copy;
+}
+
+// ======= Statistics =======
+SharedStateStats getSharedStateStats() {
+  SharedStateStats stats;
+  stats.posted = posted.load();
+  stats.applied = applied.load();
+  stats.dropped = dropped.load();
+  stats.depth = stats.posted - stats.applied;
+  stats.maxDepth = maxDepth.load();
+  stats.postRetries = postRetries.load();
+  stats.configBusy = configBusy.load();
+  getSnapshotContention(stats.snapshotReads, stats.snapshotRetries);
+  stats.configReads = configReads.load();
+  stats.configRetries = configRetries.load();
+  return stats;
+}
@@ -0,0 +1,78 @@
+#ifndef SHARED_STATE_H
+#define SHARED_STATE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Shared State Settings =======
+// systemState and coffeeConfig belong to the control task. Other tasks (the
+// AsyncTCP web handlers, loop() with LVGL) never write them: they post a
+// command, which the control task applies between cycles (it is woken for
+// it, so the delay is a few milliseconds), and they read the published
+// copies - getControlSnapshot() for the state, getConfigSnapshot() for the
+// configuration. Both queues and copies are lock-free.
+#define COMMAND_QUEUE_SIZE   16     // Power of two
+
+enum CommandType {
+  CMD_TOGGLE_HEATING = 0,
+  CMD_SET_STEAM_MODE,         // value: 0 = brew, 1 = steam
+  CMD_TOGGLE_STEAM_MODE,
+  CMD_SELECT_SHOT_SIZE,       // value: 0-3
+  CMD_SELECT_GRIND,           // value: 0-1
+  CMD_APPLY_CONFIG,           // Staged by postConfig()
+  CMD_LEARN_GRIND_RATE        // value: preset, arg: measured g/s
+};
+
+struct Command {
+  uint8_t type = 0;           // CommandType
+  int32_t value = 0;
+  float arg = 0.0;
+};
+
+// Queue and snapshot counters
+struct SharedStateStats {
+  uint32_t posted = 0;
+  uint32_t applied = 0;
+  uint32_t dropped = 0;         // Queue full
+  uint32_t depth = 0;           // Commands waiting now
+  uint32_t maxDepth = 0;
+  uint32_t postRetries = 0;     // Lost races between posting tasks
+  uint32_t configBusy = 0;      // postConfig() while an update was staged
+  uint32_t snapshotReads = 0;   // getControlSnapshot() calls
+  uint32_t snapshotRetries = 0; // ... that overlapped a publication
+  uint32_t configReads = 0;     // getConfigSnapshot() calls
+  uint32_t configRetries = 0;
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Queue a command for the control task (any task). False if the queue is full.
+bool postCommand(CommandType type, int32_t value = 0, float arg = 0.0);
+
+// Fields of a configuration update, one bit per key of /api/config (plus
+// the touch calibration). The control task changes some fields itself -
+// learned shot boosts and grind rates, autotune results - so an update
+// carries only the fields its sender edited and leaves the rest alone.
+typedef uint64_t ConfigFields;
+
+// Bit of the field named key, 0 if there is no such field
+ConfigFields configField(const char *key);
+
+// Stage the given fields of config and queue CMD_APPLY_CONFIG. False if an
+// earlier update has not been applied yet, or the queue is full.
+bool postConfig(const CoffeeConfig &config, ConfigFields fields);
+
+// Control task only: apply queued commands, returns how many
+int applyCommands();
+
+// Control task only: publish coffeeConfig for other tasks if it changed
+void publishConfig();
+
+// Latest published configuration (lock-free, safe from any task)
+CoffeeConfig getConfigSnapshot();
+
+SharedStateStats getSharedStateStats();
+
+#endif // SHARED_STATE_H
@@ -0,0 +1,285 @@
+#include "shot_engine.h"
+#include <time.h>
+#include "hal.h"
+#include "heater_output.h"
+#include "temperature.h"
+#include "shared_state.h"
+
+// ======= Shot State =======
+// Written from the timer callbacks and from start/stop requests (web, UI);
+// every access holds shotMux. Only short copies run under it: time, the
+// temperature and the heater duty are read before entering, and finished
+// records are copied out after leaving (see getShotRecord()).
+static portMUX_TYPE shotMux = portMUX_INITIALIZER_UNLOCKED;
+static ShotPhase phase = SHOT_IDLE;
+static int64_t startUs = 0;
+static uint32_t stopElapsedMs = 0;
+static uint32_t nextSampleMs = 0;
+static bool pumpOn = false;
+static float profileDuty = 0.0;
+
+// Ring of records; the active shot writes into records[activeSlot]
+static ShotRecord records[SHOT_HISTORY_SIZE];
+static uint32_t nextShotId = 1;
+static int activeSlot = -1;
+
+#ifdef ARDUINO
+static esp_timer_handle_t stopTimer = NULL;
+#endif
+
+static void writePump(bool on) {
+  if (on != pumpOn) {
+    halWritePump(on);
+    pumpOn = on;
+  }
+}
+
+static uint32_t elapsedMs() {
+  return (uint32_t)((halMicros() - startUs) / 1000);
+}
+
+// Pump duty for the current point of the profile (0-100%)
+static float pumpDuty(const CoffeeConfig &config, uint32_t elapsed) {
+  uint32_t preinfusionMs = config.shotPreinfusionMs;
+  uint32_t rampMs = config.shotRampMs;
+  float startDuty = config.shotPreinfusionDuty;
+
+  if (elapsed < preinfusionMs) {
+    phase = SHOT_PREINFUSION;
+    return startDuty;
+  }
+  if (elapsed < preinfusionMs + rampMs) {
+    phase = SHOT_RAMP;
+    return startDuty + (100.0 - startDuty) * (elapsed - preinfusionMs) / rampMs;
+  }
+  phase = SHOT_BREW;
+  return 100.0;
+}
+
+// ======= Recording =======
+static void recordSample(ShotRecord &record, const TemperatureReading &reading, float heaterDuty) {
+  if (record.sampleCount >= SHOT_MAX_SAMPLES) return;
+
+  float temp = reading.valid ? reading.celsius : 0.0;
+  if (reading.valid) {
+    if (record.sampleCount == 0 || temp < record.minTemp) record.minTemp = temp;
+    if (record.sampleCount == 0 || temp > record.maxTemp) record.maxTemp = temp;
+  }
+
+  ShotSample &sample = record.samples[record.sampleCount++];
+  sample.tempCenti = (int16_t)lroundf(temp * 100.0);
+  sample.duty = (uint8_t)lroundf(heaterDuty);
+  sample.pump = pumpOn ? 1 : 0;
+}
+
+// Stop the pump; the record stays active for the tail (caller holds shotMux)
+static void finishShotLocked(bool aborted) {
+  if (phase == SHOT_IDLE || phase == SHOT_STOP) return;
+
+  writePump(false);
+  profileDuty = 0.0;
+  stopElapsedMs = elapsedMs();
+  ShotRecord &record = records[activeSlot];
+  record.actualMs = stopElapsedMs;
+  record.aborted = aborted;
+  phase = SHOT_STOP;
+}
+
+// Close the record and make it visible in the history (caller holds shotMux)
+static void completeShotLocked() {
+  phase = SHOT_IDLE;
+  activeSlot = -1;
+}
+
+// ======= Timer Callbacks =======
+void stepShotEngine() {
+  // Taken outside shotMux: the reading has its own lock, and the profile
+  // comes from the configuration snapshot (this is the esp_timer task)
+  TemperatureReading reading = getTemperatureReading();
+  float heaterDuty = getAppliedHeaterDuty();
+  CoffeeConfig config = getConfigSnapshot();
+
+  portENTER_CRITICAL(&shotMux);
+  if (phase != SHOT_IDLE) {
+    uint32_t elapsed = elapsedMs();
+    ShotRecord &record = records[activeSlot];
+
+    if (phase != SHOT_STOP) {
+      // The one-shot timer normally ends the shot; this is the fallback
+      if (elapsed >= record.plannedMs) {
+        finishShotLocked(false);
+      } else {
+        float duty = pumpDuty(config, elapsed);
+        profileDuty = duty;
+        writePump((elapsed % SHOT_PUMP_WINDOW_MS) < duty * SHOT_PUMP_WINDOW_MS / 100.0);
+      }
+    }
+
+    if (elapsed >= nextSampleMs) {
+      recordSample(record, reading, heaterDuty);
+      nextSampleMs += SHOT_SAMPLE_MS;
+    }
+
+    if (phase == SHOT_STOP && elapsed >= stopElapsedMs + SHOT_TAIL_MS) {
+      completeShotLocked();
+    }
+  }
+  portEXIT_CRITICAL(&shotMux);
+}
+
+#ifdef ARDUINO
+#include "pin_mapping.h"
+
+static esp_timer_handle_t tickTimer = NULL;
+
+static void shotTick(void *arg) {
+  stepShotEngine();
+}
+
+static void shotStopTimerCallback(void *arg) {
+  portENTER_CRITICAL(&shotMux);
+  finishShotLocked(false);
+  portEXIT_CRITICAL(&shotMux);
+}
+
+void initShotEngine() {
+  pinMode(PUMP_PIN, OUTPUT);
+  digitalWrite(PUMP_PIN, LOW);
+
+  esp_timer_create_args_t tickArgs = {};
+  tickArgs.callback = shotTick;
+  tickArgs.dispatch_method = ESP_TIMER_TASK;
+  tickArgs.name = "shot_tick";
+
+  esp_timer_create_args_t stopArgs = {};
+  stopArgs.callback = shotStopTimerCallback;
+  stopArgs.dispatch_method = ESP_TIMER_TASK;
+  stopArgs.name = "shot_stop";
+
+  if (esp_timer_create(&tickArgs, &tickTimer) != ESP_OK ||
+      esp_timer_create(&stopArgs, &stopTimer) != ESP_OK ||
+      esp_timer_start_periodic(tickTimer, SHOT_TICK_MS * 1000ULL) != ESP_OK) {
+    Serial.println("Error: Failed to start shot timers!");
+    return;
+  }
+  Serial.println("Shot engine initialized (pump OFF)");
+}
+#endif // ARDUINO
+
+// ======= Public Interface =======
+bool startShot(int size) {
+  if (size < 0 || size > 3) return false;
+
+  uint32_t startMs = halMillis();
+  time_t now = time(NULL);
+  TemperatureReading reading = getTemperatureReading();
+  CoffeeConfig config = getConfigSnapshot();
+
+  portENTER_CRITICAL(&shotMux);
+  if (phase != SHOT_IDLE && phase != SHOT_STOP) {
+    portEXIT_CRITICAL(&shotMux);
+    return false;
+  }
+  if (phase == SHOT_STOP) {
+    completeShotLocked();  // Cut the previous tail short
+  }
+
+  activeSlot = (nextShotId - 1) % SHOT_HISTORY_SIZE;
+  ShotRecord &record = records[activeSlot];
+  record.id = nextShotId++;
+  record.startMs = startMs;
+  record.startEpoch = now > 1600000000 ? (uint32_t)now : 0;  // Only once NTP has synced
+  record.size = size;
+  record.plannedMs = (uint32_t)(config.shotSizes[size] * 1000.0);
+  record.actualMs = 0;
+  record.aborted = false;
+  record.sampleCount = 0;
+  record.startTemp = reading.valid ? reading.celsius : 0.0;
+
+  startUs = halMicros();
+  nextSampleMs = 0;
+  profileDuty = pumpDuty(config, 0);
+  writePump(profileDuty > 0.0);
+  uint32_t plannedMs = record.plannedMs;
+  uint32_t id = record.id;
+  portEXIT_CRITICAL(&shotMux);
+
+#ifdef ARDUINO
+  esp_timer_stop(stopTimer);
+  esp_timer_start_once(stopTimer, plannedMs * 1000ULL);
+#endif
+  postCommand(CMD_SELECT_SHOT_SIZE, size);
+  Serial.printf("Shot %lu started: %s, %.1f s\n", (unsigned long)id,
+                config.shotNames[size], plannedMs / 1000.0);
+  return true;
+}
+
+void stopShot() {
+#ifdef ARDUINO
+  esp_timer_stop(stopTimer);
+#endif
+  portENTER_CRITICAL(&shotMux);
+  finishShotLocked(true);
+  portEXIT_CRITICAL(&shotMux);
+}
+
+ShotStatus getShotStatus() {
+  ShotStatus status;
+  portENTER_CRITICAL(&shotMux);
+  status.phase = phase;
+  if (phase != SHOT_IDLE) {
+    const ShotRecord &record = records[activeSlot];
+    status.id = record.id;
+    status.size = record.size;
+    status.plannedMs = record.plannedMs;
+    status.elapsedMs = phase == SHOT_STOP ? record.actualMs : elapsedMs();
+    status.sinceStopMs = phase == SHOT_STOP ? elapsedMs() - stopElapsedMs : 0;
+    status.pumpDuty = profileDuty;
+  }
+  portEXIT_CRITICAL(&shotMux);
+  return status;
+}
+
+const char *shotPhaseName(ShotPhase p) {
+  switch (p) {
+    case SHOT_PREINFUSION: return "preinfusion";
+    case SHOT_RAMP:        return "ramp";
+    case SHOT_BREW:        return "brew";
+    case SHOT_STOP:        return "stop";
+    default:               return "idle";
+  }
+}
+
+uint32_t getShotIds(uint32_t *ids, uint32_t maxIds) {
+  uint32_t count = 0;
+  portENTER_CRITICAL(&shotMux);
+  for (uint32_t id = nextShotId - 1; id >= 1 && count < maxIds; id--) {
+    int slot = (id - 1) % SHOT_HISTORY_SIZE;
+    if (records[slot].id != id) break;      // Overwritten
+    if (slot == activeSlot) continue;       // Still running
+    ids[count++] = id;
+  }
+  portEXIT_CRITICAL(&shotMux);
+  return count;
+}
+
+// A finished record is not written again until startShot() reuses its slot,
+// and that changes the id before anything else. So the record is copied
+// without holding shotMux and the id is checked again afterwards: if it
+// still matches, the copy is complete and untorn.
+bool getShotRecord(uint32_t id, ShotRecord &record) {
+  if (id == 0) return false;
+  int slot = (id - 1) % SHOT_HISTORY_SIZE;
+
+  portENTER_CRITICAL(&shotMux);
+  bool found = records[slot].id == id && slot != activeSlot;
+  portEXIT_CRITICAL(&shotMux);
+  if (!found) return false;
+
+  record = records[slot];
+
+  portENTER_CRITICAL(&shotMux);
+  found = records[slot].id == id;
+  portEXIT_CRITICAL(&shotMux);
+  return found;
+}
@@ -0,0 +1,82 @@
+#ifndef SHOT_ENGINE_H
+#define SHOT_ENGINE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Shot Engine Settings =======
+// Phases and the pump PWM advance on a 10 ms esp_timer tick; the end of the
+// shot is a one-shot esp_timer armed at the exact planned time, so shot
+// length does not depend on loop() or the tick.
+#define SHOT_TICK_MS          10
+#define SHOT_PUMP_WINDOW_MS   100    // Pump PWM window during pre-infusion/ramp
+#define SHOT_SAMPLE_MS        100    // Record at the acquisition rate (10 Hz)
+#define SHOT_TAIL_MS          5000   // Keep recording after the pump stops
+#define SHOT_MAX_SAMPLES      ((60000 + SHOT_TAIL_MS) / SHOT_SAMPLE_MS)
+#define SHOT_HISTORY_SIZE     6      // Completed shots kept in RAM
+
+enum ShotPhase {
+  SHOT_IDLE = 0,
+  SHOT_PREINFUSION,   // Pump at shotPreinfusionDuty
+  SHOT_RAMP,          // Pump duty ramps up to 100%
+  SHOT_BREW,          // Pump fully on
+  SHOT_STOP           // Pump off, still recording the temperature
+};
+
+// One point of the shot curve (4 bytes)
+struct ShotSample {
+  int16_t tempCenti;   // Filtered boiler temperature x100
+  uint8_t duty;        // Heater duty incl. feed-forward (%)
+  uint8_t pump;        // Pump output (1 = on)
+};
+
+struct ShotRecord {
+  uint32_t id = 0;
+  uint32_t startMs = 0;       // halMillis() at pump start
+  uint32_t startEpoch = 0;    // Unix time at pump start (0 before NTP sync)
+  uint8_t size = 0;           // Index into shotSizes
+  uint32_t plannedMs = 0;
+  uint32_t actualMs = 0;      // Pump start to pump stop
+  bool aborted = false;
+  float startTemp = 0.0;
+  float minTemp = 0.0;
+  float maxTemp = 0.0;
+  uint16_t sampleCount = 0;
+  ShotSample samples[SHOT_MAX_SAMPLES];
+};
+
+struct ShotStatus {
+  ShotPhase phase = SHOT_IDLE;
+  uint32_t id = 0;
+  uint8_t size = 0;
+  uint32_t elapsedMs = 0;
+  uint32_t plannedMs = 0;
+  uint32_t sinceStopMs = 0;   // Time in SHOT_STOP
+  float pumpDuty = 0.0;       // Profile duty right now (0-100%)
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Initialize pump pin and start the shot timers
+void initShotEngine();
+
+// Start a shot of shotSizes[size]; false if one is already running
+bool startShot(int size);
+
+// Stop the running shot early (recorded as aborted)
+void stopShot();
+
+// Advance by one SHOT_TICK_MS tick (called by the timer on the device, by the
+// simulation clock on the host)
+void stepShotEngine();
+
+ShotStatus getShotStatus();
+const char *shotPhaseName(ShotPhase phase);
+
+// Completed shots, newest first. getShotRecord() copies one out by id.
+uint32_t getShotIds(uint32_t *ids, uint32_t maxIds);
+bool getShotRecord(uint32_t id, ShotRecord &record);
+
+#endif // SHOT_ENGINE_H
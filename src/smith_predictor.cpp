@@ -0,0 +1,139 @@
+#include "smith_predictor.h"
+#include "heater_output.h"
+#include "hal.h"
+
+// ======= Predictor State =======
+// Owned by the control task. The model advances once per control update;
+// the delay line holds its past outputs, one slot per update.
+static float modelC = 0.0;
+static float delayLine[SMITH_DELAY_SLOTS];
+static uint16_t delayHead = 0;
+static float smithIntegral = 0.0;
+static unsigned long smithLastUpdate = 0;
+static FopdtModel lastModel;
+static SmithTerms smithTerms;
+
+FopdtModel getConfiguredModel() {
+  FopdtModel model;
+  model.gain = coffeeConfig.modelGain;
+  model.tauS = coffeeConfig.modelTauS;
+  model.deadTimeS = coffeeConfig.modelDeadTimeS;
+  return model;
+}
+
+// ======= Identification =======
+// At the relay's oscillation frequency w = 2 pi / Pu the loop gain is 1 and
+// the phase -180°:
+//   K Ku / sqrt(1 + (w tau)^2) = 1   ->  tau = sqrt((K Ku)^2 - 1) / w
+//   w theta + atan(w tau) = pi       ->  theta = (pi - atan(w tau)) / w
+// K itself comes from the holding duty (losses are linear in T - ambient).
+bool identifyFopdt(float ku, float puS, float setpoint, float holdDutyPct, FopdtModel &model) {
+  if (ku <= 0.0 || puS <= 0.0 || holdDutyPct <= 0.0 || setpoint <= SMITH_AMBIENT_C) {
+    return false;
+  }
+  float gain = (setpoint - SMITH_AMBIENT_C) / holdDutyPct;
+  float loopGain = gain * ku / 2.55;     // Ku is per 0-255 output, K per %
+  if (loopGain <= 1.0) return false;
+
+  float w = 2.0 * M_PI / puS;
+  float tau = sqrtf(loopGain * loopGain - 1.0) / w;
+  float theta = (M_PI - atanf(w * tau)) / w;
+  if (theta <= 0.0) return false;
+
+  model.gain = gain;
+  model.tauS = tau;
+  model.deadTimeS = theta;
+  return true;
+}
+
+bool smithDeadTimeFits(float deadTimeS, int intervalMs) {
+  return intervalMs > 0 && lroundf(deadTimeS * 1000.0 / intervalMs) <= SMITH_DELAY_SLOTS - 1;
+}
+
+// ======= Smith Predictor Update =======
+static float holdingDuty(float temp, const FopdtModel &model) {
+  return constrain((temp - SMITH_AMBIENT_C) / model.gain, 0.0f, 100.0f);
+}
+
+static void resetModel(float currentTemp, float targetTemp, const FopdtModel &model) {
+  // Start in steady state at the measurement: no correction until the
+  // model and the boiler diverge. The integral starts so that holding duty
+  // plus integral is the duty that holds the current temperature; the PI
+  // then sees a plain step to the target.
+  modelC = currentTemp;
+  for (int i = 0; i < SMITH_DELAY_SLOTS; i++) delayLine[i] = currentTemp;
+  delayHead = 0;
+  smithIntegral = holdingDuty(currentTemp, model) - holdingDuty(targetTemp, model);
+}
+
+void updateSmithControl(float currentTemp, float targetTemp) {
+  unsigned long now = halMillis();
+  float dt = coffeeConfig.tempUpdateInterval / 1000.0;
+  FopdtModel model = getConfiguredModel();
+
+  if (model.gain <= 0.0 || model.tauS <= 0.0) {
+    // No usable model: hold the heater off rather than guess
+    setHeaterDuty(0.0);
+    smithTerms = SmithTerms();
+    return;
+  }
+
+  // Coming back from another mode, or the model was changed
+  if (smithLastUpdate == 0 ||
+      now - smithLastUpdate > (unsigned long)coffeeConfig.tempUpdateInterval * SMITH_REINIT_PERIODS ||
+      model.gain != lastModel.gain || model.tauS != lastModel.tauS ||
+      model.deadTimeS != lastModel.deadTimeS) {
+    resetModel(currentTemp, targetTemp, model);
+    lastModel = model;
+    // The configuration checks this; a model that still does not fit (the
+    // control period changed) runs with the longest delay the line holds
+    if (!smithDeadTimeFits(model.deadTimeS, coffeeConfig.tempUpdateInterval)) {
+      Serial.printf("Smith predictor: dead time %.1f s exceeds %d control periods, using %.1f s\n",
+                    model.deadTimeS, SMITH_DELAY_SLOTS - 1, (SMITH_DELAY_SLOTS - 1) * dt);
+    }
+  }
+  smithLastUpdate = now;
+
+  int delaySlots = constrain((int)lroundf(model.deadTimeS / dt), 0, SMITH_DELAY_SLOTS - 1);
+  smithTerms.deadTimeClamped = !smithDeadTimeFits(model.deadTimeS, coffeeConfig.tempUpdateInterval);
+  float delayedC = delayLine[(delayHead + SMITH_DELAY_SLOTS - 1 - delaySlots) % SMITH_DELAY_SLOTS];
+  float predictedC = currentTemp + modelC - delayedC;
+
+  // IMC-tuned PI on the predicted temperature, on top of the holding duty
+  // (a setpoint change moves the duty the model needs at once)
+  float lambda = coffeeConfig.smithLambdaS > 0.0 ? coffeeConfig.smithLambdaS : model.tauS;
+  float kp = model.tauS / (model.gain * lambda);
+  float ki = kp / fminf(model.tauS, SMITH_TI_LAMBDAS * (lambda + model.deadTimeS));
+  float hold = holdingDuty(targetTemp, model);
+  float error = targetTemp - predictedC;
+
+  float p = kp * error;
+  float unclamped = hold + p + smithIntegral;
+  // Anti-windup (conditional integration), as in the PID. Far from the
+  // target the model's transient is the proportional term's job; the
+  // integral only trims the model's steady-state error.
+  bool windingUp = (unclamped >= 100.0 && error > 0.0) || (unclamped <= 0.0 && error < 0.0);
+  if (!windingUp && fabsf(error) < SMITH_INTEGRAL_BAND_C) {
+    smithIntegral = constrain(smithIntegral + ki * error * dt, -100.0f, 100.0f);
+  }
+  float output = constrain(hold + p + smithIntegral, 0.0f, 100.0f);
+  setHeaterDuty(output);
+
+  // Advance the model with the duty just requested
+  float a = expf(-dt / model.tauS);
+  modelC = a * modelC + (1.0 - a) * (SMITH_AMBIENT_C + model.gain * output);
+  delayLine[delayHead] = modelC;
+  delayHead = (delayHead + 1) % SMITH_DELAY_SLOTS;
+
+  smithTerms.modelC = modelC;
+  smithTerms.delayedC = delayedC;
+  smithTerms.predictedC = predictedC;
+  smithTerms.hold = hold;
+  smithTerms.p = p;
+  smithTerms.i = smithIntegral;
+  smithTerms.output = output;
+}
+
+SmithTerms getSmithTerms() {
+  return smithTerms;
+}
@@ -0,0 +1,66 @@
+#ifndef SMITH_PREDICTOR_H
+#define SMITH_PREDICTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Smith Predictor Settings =======
+// The thermocouple sits on the outside of the boiler, so the water's
+// response to the element shows up only after a dead time. The predictor
+// runs a first-order-plus-dead-time (FOPDT) model of the boiler,
+//   T(s) - ambient = K e^(-theta s) / (tau s + 1) * duty(s),
+// and feeds the PI controller the measurement corrected by the model's
+// undelayed minus delayed output, so the PI acts on the temperature the
+// sensor will show one dead time from now. The PI is tuned from the model
+// (IMC/SIMC: Kp = tau / (K lambda), Ti = min(tau, 4 (lambda + theta))) on
+// top of the model's holding duty, so the setpoint response is close to a
+// first-order lag of lambda when the model is right.
+#define SMITH_DELAY_SLOTS   128     // Dead time up to 127 control periods
+#define SMITH_AMBIENT_C     25.0    // Model reference (same as PID_AMBIENT_C)
+#define SMITH_REINIT_PERIODS 3      // Re-initialize after this many missed updates
+#define SMITH_TI_LAMBDAS    4.0     // Ti = min(tau, this * (lambda + theta)) (SIMC)
+#define SMITH_INTEGRAL_BAND_C 2.0   // Integrate only this close to the target
+
+// FOPDT boiler model
+struct FopdtModel {
+  float gain = 0.0;        // K: steady-state °C above ambient per % duty
+  float tauS = 0.0;        // Time constant
+  float deadTimeS = 0.0;   // theta
+};
+
+// Contribution of each term to the last output (0-100% duty)
+struct SmithTerms {
+  float modelC = 0.0;        // Undelayed model temperature
+  float delayedC = 0.0;      // Model temperature one dead time ago
+  float predictedC = 0.0;    // Measurement + model - delayed model
+  float hold = 0.0;          // Model holding duty at the target
+  float p = 0.0;
+  float i = 0.0;
+  float output = 0.0;
+  bool deadTimeClamped = false;  // Model dead time longer than the delay line
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Model from the configuration (modelGain, modelTauS, modelDeadTimeS)
+FopdtModel getConfiguredModel();
+
+// Fit an FOPDT model to a relay test: ultimate gain ku (0-255 output per
+// °C) and period puS at a setpoint held with holdDutyPct on average.
+// False if the numbers do not describe a lagging first-order plant.
+bool identifyFopdt(float ku, float puS, float setpoint, float holdDutyPct, FopdtModel &model);
+
+// True if the delay line holds deadTimeS at a control period of intervalMs
+// (at most SMITH_DELAY_SLOTS - 1 periods)
+bool smithDeadTimeFits(float deadTimeS, int intervalMs);
+
+// Smith predictor update (called from the heating control in
+// CONTROL_MODE_SMITH); sets the heater duty
+void updateSmithControl(float currentTemp, float targetTemp);
+
+// Terms of the most recent update
+SmithTerms getSmithTerms();
+
+#endif // SMITH_PREDICTOR_H
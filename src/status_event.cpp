@@ -0,0 +1,63 @@
+#include "status_event.h"
+#include <stdarg.h>
+#include "control_task.h"
+
+// ======= Status Event =======
+void captureStatus(StreamedStatus &s) {
+  ControlSnapshot control = getControlSnapshot();
+  s.tempDeci = (int16_t)lroundf(control.currentTemp * 10.0);
+  s.targetDeci = (int16_t)lroundf(control.targetTemp * 10.0);
+  s.duty = (uint8_t)lroundf(control.heaterDuty);
+  s.heating = control.heatingElement;
+  s.pump = control.state.has(STATE_PUMP);
+  s.grinder = control.state.has(STATE_GRINDER);
+  s.steamMode = control.state.has(STATE_STEAM_MODE);
+  s.autotune = control.autotuning;
+  s.sensorFault = control.sensorFault;
+  s.operation = control.state.operation;
+}
+
+// Append one "key":value member, opening the object on the first one
+static void appendMember(char *out, size_t capacity, size_t &used, const char *fmt, ...) {
+  if (used + 1 >= capacity) return;
+  char separator = (used == 0) ? '{' : ',';
+  out[used++] = separator;
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(out + used, capacity - used, fmt, args);
+  va_end(args);
+  if (len > 0) used += len;
+}
+
+size_t formatStatusEvent(char *out, size_t capacity, const StreamedStatus &s,
+                         const StreamedStatus *prev) {
+  size_t used = 0;
+
+  if (!prev || s.tempDeci != prev->tempDeci)
+    appendMember(out, capacity, used, "\"currentTemp\":%.1f", s.tempDeci / 10.0);
+  if (!prev || s.targetDeci != prev->targetDeci)
+    appendMember(out, capacity, used, "\"targetTemp\":%.1f", s.targetDeci / 10.0);
+  if (!prev || s.duty != prev->duty)
+    appendMember(out, capacity, used, "\"heaterDuty\":%u", (unsigned)s.duty);
+  if (!prev || s.heating != prev->heating)
+    appendMember(out, capacity, used, "\"heatingElement\":%s", s.heating ? "true" : "false");
+  if (!prev || s.pump != prev->pump)
+    appendMember(out, capacity, used, "\"pump\":%s", s.pump ? "true" : "false");
+  if (!prev || s.grinder != prev->grinder)
+    appendMember(out, capacity, used, "\"grinder\":%s", s.grinder ? "true" : "false");
+  if (!prev || s.steamMode != prev->steamMode)
+    appendMember(out, capacity, used, "\"steamMode\":%s", s.steamMode ? "true" : "false");
+  if (!prev || s.autotune != prev->autotune)
+    appendMember(out, capacity, used, "\"autotune\":%s", s.autotune ? "true" : "false");
+  if (!prev || s.sensorFault != prev->sensorFault)
+    appendMember(out, capacity, used, "\"sensorFault\":%s", s.sensorFault ? "true" : "false");
+  if (!prev || s.operation != prev->operation)
+    appendMember(out, capacity, used, "\"currentOperation\":\"%s\"", operationName(s.operation));
+
+  if (used == 0 || used + 2 > capacity) {
+    return 0;
+  }
+  out[used++] = '}';
+  out[used] = '\0';
+  return used;
+}
@@ -0,0 +1,36 @@
+#ifndef STATUS_EVENT_H
+#define STATUS_EVENT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ======= Status Event Settings =======
+// The status pushed on /api/events, kept apart from the web server so the
+// host soak test renders it with the same code.
+#define EVENT_BUFFER_SIZE        256
+#define EVENT_KEYFRAME_MS        10000   // Full state at least this often
+
+// Values as shown to clients (rounded), so noise below display resolution
+// does not produce events
+struct StreamedStatus {
+  int16_t tempDeci;       // 0.1 °C
+  int16_t targetDeci;
+  uint8_t duty;           // %
+  bool heating;
+  bool pump;
+  bool grinder;
+  bool steamMode;
+  bool autotune;
+  bool sensorFault;
+  Operation operation;
+};
+
+// Take the streamed values from the latest control snapshot
+void captureStatus(StreamedStatus &s);
+
+// Serialize s as JSON; with prev set, only fields that differ from it.
+// Returns the length, or 0 if nothing changed (or it does not fit).
+size_t formatStatusEvent(char *out, size_t capacity, const StreamedStatus &s,
+                         const StreamedStatus *prev);
+
+#endif // STATUS_EVENT_H
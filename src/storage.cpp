@@ -1,69 +1,393 @@
 #include "storage.h"
 #include <Preferences.h>
+#include "hal.h"
 
 static Preferences preferences;
 
+// ======= Stored Record =======
+// The configuration is stored as a single NVS blob: a header followed by the
+// record below. Fields are only ever appended, so a record written by an
+// older firmware is copied over the defaults and new fields keep their
+// default values. A change to the meaning of an existing field must bump
+// STORAGE_SCHEMA_VERSION and convert the old record in loadConfiguration().
+#define STORAGE_NAMESPACE  "coffee-config"
+#define STORAGE_KEY        "config"
+#define STORAGE_MAGIC      0x43465343UL  // "CSFC"
+
+struct StoredHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;     // Size of the record that follows
+  uint32_t crc;      // CRC-32 of the record
+};
+
+struct StoredConfig {
+  float brewTemp;
+  float steamTemp;
+  float shotSizes[4];
+  float grindTimes[2];
+  float pidKp;
+  float pidKi;
+  float pidKd;
+  int32_t ssrWindowMs;
+  int32_t ssrMinSwitchMs;
+  int32_t tempUpdateInterval;
+  int32_t eventIntervalMs;
+  int32_t tempMedianSize;
+  int32_t tempFilterMode;
+  float tempFilterAlpha;
+  float tempKalmanQ;
+  uint8_t controlMode;       // Was usePID (0/1), same values
+  uint8_t enableInfluxDB;
+  uint8_t telemetrySpoolFlash;
+  uint8_t reserved;
+  int32_t shotPreinfusionMs;
+  int32_t shotPreinfusionDuty;
+  int32_t shotRampMs;
+  int32_t grindMode;
+  float grindDoses[2];
+  float grindRates[2];
+  float ffBoostPct[4];
+  int32_t ffTailMs;
+  uint8_t ffEnable;
+  uint8_t ffLearn;
+  uint8_t reserved2[2];
+  float steamKp;
+  float steamKi;
+  float steamKd;
+  float modelGain;
+  float modelTauS;
+  float modelDeadTimeS;
+  float smithLambdaS;
+  uint8_t healthRestart;
+  uint8_t reserved3[3];
+  float touchCal[6];
+  uint8_t touchCalibrated;
+  uint8_t reserved4[3];
+};
+
+// ======= Storage State =======
+#ifdef ARDUINO
+static TaskHandle_t storageTaskHandle = NULL;
+static SemaphoreHandle_t commitMutex = NULL;
+#endif
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+
+static StoredConfig pendingRecord;   // Latest requested state (pendingMux)
+static bool pendingValid = false;
+static uint32_t lastRequestMs = 0;   // halMillis() of the latest request (pendingMux)
+static StoredConfig storedRecord;    // What is in flash now (commitMutex)
+static StorageStats stats;
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static void toRecord(const CoffeeConfig& c, StoredConfig& r) {
+  memset(&r, 0, sizeof(r));  // Deterministic padding so records compare bytewise
+  r.brewTemp = c.brewTemp;
+  r.steamTemp = c.steamTemp;
+  memcpy(r.shotSizes, c.shotSizes, sizeof(r.shotSizes));
+  memcpy(r.grindTimes, c.grindTimes, sizeof(r.grindTimes));
+  r.pidKp = c.pidKp;
+  r.pidKi = c.pidKi;
+  r.pidKd = c.pidKd;
+  r.ssrWindowMs = c.ssrWindowMs;
+  r.ssrMinSwitchMs = c.ssrMinSwitchMs;
+  r.tempUpdateInterval = c.tempUpdateInterval;
+  r.eventIntervalMs = c.eventIntervalMs;
+  r.tempMedianSize = c.tempMedianSize;
+  r.tempFilterMode = c.tempFilterMode;
+  r.tempFilterAlpha = c.tempFilterAlpha;
+  r.tempKalmanQ = c.tempKalmanQ;
+  r.controlMode = c.controlMode;
+  r.enableInfluxDB = c.enableInfluxDB;
+  r.telemetrySpoolFlash = c.telemetrySpoolFlash;
+  r.shotPreinfusionMs = c.shotPreinfusionMs;
+  r.shotPreinfusionDuty = c.shotPreinfusionDuty;
+  r.shotRampMs = c.shotRampMs;
+  r.grindMode = c.grindMode;
+  memcpy(r.grindDoses, c.grindDoses, sizeof(r.grindDoses));
+  memcpy(r.grindRates, c.grindRates, sizeof(r.grindRates));
+  memcpy(r.ffBoostPct, c.ffBoostPct, sizeof(r.ffBoostPct));
+  r.ffTailMs = c.ffTailMs;
+  r.ffEnable = c.ffEnable;
+  r.ffLearn = c.ffLearn;
+  r.steamKp = c.steamKp;
+  r.steamKi = c.steamKi;
+  r.steamKd = c.steamKd;
+  r.modelGain = c.modelGain;
+  r.modelTauS = c.modelTauS;
+  r.modelDeadTimeS = c.modelDeadTimeS;
+  r.smithLambdaS = c.smithLambdaS;
+  r.healthRestart = c.healthRestart;
+  memcpy(r.touchCal, c.touchCal, sizeof(r.touchCal));
+  r.touchCalibrated = c.touchCalibrated;
+}
+
+static void fromRecord(const StoredConfig& r, CoffeeConfig& c) {
+  c.brewTemp = r.brewTemp;
+  c.steamTemp = r.steamTemp;
+  memcpy(c.shotSizes, r.shotSizes, sizeof(r.shotSizes));
+  memcpy(c.grindTimes, r.grindTimes, sizeof(r.grindTimes));
+  c.pidKp = r.pidKp;
+  c.pidKi = r.pidKi;
+  c.pidKd = r.pidKd;
+  c.ssrWindowMs = r.ssrWindowMs;
+  c.ssrMinSwitchMs = r.ssrMinSwitchMs;
+  c.tempUpdateInterval = r.tempUpdateInterval;
+  c.eventIntervalMs = r.eventIntervalMs;
+  c.tempMedianSize = r.tempMedianSize;
+  c.tempFilterMode = r.tempFilterMode;
+  c.tempFilterAlpha = r.tempFilterAlpha;
+  c.tempKalmanQ = r.tempKalmanQ;
+  c.controlMode = r.controlMode;
+  c.enableInfluxDB = r.enableInfluxDB;
+  c.telemetrySpoolFlash = r.telemetrySpoolFlash;
+  c.shotPreinfusionMs = r.shotPreinfusionMs;
+  c.shotPreinfusionDuty = r.shotPreinfusionDuty;
+  c.shotRampMs = r.shotRampMs;
+  c.grindMode = r.grindMode;
+  memcpy(c.grindDoses, r.grindDoses, sizeof(r.grindDoses));
+  memcpy(c.grindRates, r.grindRates, sizeof(r.grindRates));
+  memcpy(c.ffBoostPct, r.ffBoostPct, sizeof(r.ffBoostPct));
+  c.ffTailMs = r.ffTailMs;
+  c.ffEnable = r.ffEnable;
+  c.ffLearn = r.ffLearn;
+  c.steamKp = r.steamKp;
+  c.steamKi = r.steamKi;
+  c.steamKd = r.steamKd;
+  c.modelGain = r.modelGain;
+  c.modelTauS = r.modelTauS;
+  c.modelDeadTimeS = r.modelDeadTimeS;
+  c.smithLambdaS = r.smithLambdaS;
+  c.healthRestart = r.healthRestart;
+  memcpy(c.touchCal, r.touchCal, sizeof(r.touchCal));
+  c.touchCalibrated = r.touchCalibrated;
+}
+
+// ======= Commit =======
+// Write the pending record if it differs from what is already in flash.
+// One commit is one blob write, however many fields changed.
+static void commitPending() {
+#ifdef ARDUINO
+  xSemaphoreTake(commitMutex, portMAX_DELAY);
+#endif
+
+  StoredConfig record;
+  bool have = false;
+  portENTER_CRITICAL(&pendingMux);
+  if (pendingValid) {
+    record = pendingRecord;
+    pendingValid = false;
+    have = true;
+  }
+  stats.pending = false;
+  portEXIT_CRITICAL(&pendingMux);
+
+  if (have) {
+    stats.commits++;
+    if (memcmp(&record, &storedRecord, sizeof(record)) == 0) {
+      stats.unchangedSkips++;
+    } else {
+      uint8_t blob[sizeof(StoredHeader) + sizeof(StoredConfig)];
+      StoredHeader header;
+      header.magic = STORAGE_MAGIC;
+      header.version = STORAGE_SCHEMA_VERSION;
+      header.size = sizeof(StoredConfig);
+      header.crc = crc32((const uint8_t *)&record, sizeof(record));
+      memcpy(blob, &header, sizeof(header));
+      memcpy(blob + sizeof(header), &record, sizeof(record));
+
+      preferences.begin(STORAGE_NAMESPACE, false);
+      size_t written = preferences.putBytes(STORAGE_KEY, blob, sizeof(blob));
+      preferences.end();
+
+      if (written == sizeof(blob)) {
+        storedRecord = record;
+        stats.flashWrites++;
+        Serial.println("Configuration saved to flash memory");
+      } else {
+        stats.writeErrors++;
+        Serial.println("Error: Failed to save configuration!");
+      }
+    }
+  }
+
+#ifdef ARDUINO
+  xSemaphoreGive(commitMutex);
+#endif
+}
+
+// Time left until the pending request has been quiet for the debounce
+// period; 0 when it is due, UINT32_MAX when nothing is pending
+static uint32_t debounceRemainingMs() {
+  uint32_t now = halMillis();
+  portENTER_CRITICAL(&pendingMux);
+  bool pending = pendingValid;
+  uint32_t quietMs = now - lastRequestMs;
+  portEXIT_CRITICAL(&pendingMux);
+  if (!pending) return UINT32_MAX;
+  return quietMs >= STORAGE_DEBOUNCE_MS ? 0 : STORAGE_DEBOUNCE_MS - quietMs;
+}
+
+void stepStorage() {
+  if (debounceRemainingMs() == 0) {
+    commitPending();
+  }
+}
+
+#ifdef ARDUINO
+// Sleeps until a request arrives, then until requests have stopped
+// arriving for STORAGE_DEBOUNCE_MS
+static void storageTask(void *param) {
+  for (;;) {
+    uint32_t waitMs = debounceRemainingMs();
+    ulTaskNotifyTake(pdTRUE, waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+    stepStorage();
+  }
+}
+
 // ======= Storage Initialization =======
 void initStorage() {
+  commitMutex = xSemaphoreCreateMutex();
+  BaseType_t created = xTaskCreatePinnedToCore(storageTask, "storage",
+                                               STORAGE_TASK_STACK_SIZE, NULL,
+                                               STORAGE_TASK_PRIORITY,
+                                               &storageTaskHandle,
+                                               STORAGE_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Error: Failed to create storage task!");
+  }
   Serial.println("Storage system initialized");
 }
+#endif // ARDUINO
 
 // ======= Configuration Management =======
 void saveConfiguration() {
-  preferences.begin("coffee-config", false);
-  
-  preferences.putFloat("brewTemp", coffeeConfig.brewTemp);
-  preferences.putFloat("steamTemp", coffeeConfig.steamTemp);
-  
-  // Save shot sizes
+  StoredConfig record;
+  toRecord(coffeeConfig, record);
+
+  uint32_t now = halMillis();
+  portENTER_CRITICAL(&pendingMux);
+  pendingRecord = record;
+  pendingValid = true;
+  lastRequestMs = now;
+  stats.pending = true;
+  stats.saveRequests++;
+  portEXIT_CRITICAL(&pendingMux);
+
+#ifdef ARDUINO
+  // Before initStorage() the request waits for the task to start
+  if (storageTaskHandle != NULL) {
+    xTaskNotifyGive(storageTaskHandle);
+  }
+#endif
+}
+
+void flushConfiguration() {
+  commitPending();
+}
+
+// Import the per-key layout used before the blob was introduced
+static void loadLegacyConfiguration() {
+  const char *shotKeys[4] = {"shot0", "shot1", "shot2", "shot3"};
+  const char *grindKeys[2] = {"grind0", "grind1"};
+
+  coffeeConfig.brewTemp = preferences.getFloat("brewTemp", coffeeConfig.brewTemp);
+  coffeeConfig.steamTemp = preferences.getFloat("steamTemp", coffeeConfig.steamTemp);
   for (int i = 0; i < 4; i++) {
-    String key = "shot" + String(i);
-    preferences.putFloat(key.c_str(), coffeeConfig.shotSizes[i]);
+    coffeeConfig.shotSizes[i] = preferences.getFloat(shotKeys[i], coffeeConfig.shotSizes[i]);
   }
-  
-  // Save grind times
   for (int i = 0; i < 2; i++) {
-    String key = "grind" + String(i);
-    preferences.putFloat(key.c_str(), coffeeConfig.grindTimes[i]);
+    coffeeConfig.grindTimes[i] = preferences.getFloat(grindKeys[i], coffeeConfig.grindTimes[i]);
   }
-  
-  preferences.putFloat("pidKp", coffeeConfig.pidKp);
-  preferences.putFloat("pidKi", coffeeConfig.pidKi);
-  preferences.putFloat("pidKd", coffeeConfig.pidKd);
-  preferences.putBool("usePID", coffeeConfig.usePID);
-  preferences.putBool("influxEnable", coffeeConfig.enableInfluxDB);
-  preferences.putInt("tempInterval", coffeeConfig.tempUpdateInterval);
-  
-  preferences.end();
-  Serial.println("Configuration saved to flash memory");
+  coffeeConfig.pidKp = preferences.getFloat("pidKp", coffeeConfig.pidKp);
+  coffeeConfig.pidKi = preferences.getFloat("pidKi", coffeeConfig.pidKi);
+  coffeeConfig.pidKd = preferences.getFloat("pidKd", coffeeConfig.pidKd);
+  // The old boolean maps onto control modes 0 (on/off) and 1 (PID)
+  coffeeConfig.controlMode = preferences.getBool("usePID", coffeeConfig.controlMode == 1) ? 1 : 0;
+  coffeeConfig.ssrWindowMs = preferences.getInt("ssrWindow", coffeeConfig.ssrWindowMs);
+  coffeeConfig.ssrMinSwitchMs = preferences.getInt("ssrMinSwitch", coffeeConfig.ssrMinSwitchMs);
+  coffeeConfig.enableInfluxDB = preferences.getBool("influxEnable", coffeeConfig.enableInfluxDB);
+  coffeeConfig.telemetrySpoolFlash = preferences.getBool("spoolFlash", coffeeConfig.telemetrySpoolFlash);
+  coffeeConfig.tempUpdateInterval = preferences.getInt("tempInterval", coffeeConfig.tempUpdateInterval);
+  coffeeConfig.eventIntervalMs = preferences.getInt("eventInterval", coffeeConfig.eventIntervalMs);
+  coffeeConfig.tempMedianSize = preferences.getInt("tfMedian", coffeeConfig.tempMedianSize);
+  coffeeConfig.tempFilterMode = preferences.getInt("tfMode", coffeeConfig.tempFilterMode);
+  coffeeConfig.tempFilterAlpha = preferences.getFloat("tfAlpha", coffeeConfig.tempFilterAlpha);
+  coffeeConfig.tempKalmanQ = preferences.getFloat("tfKalmanQ", coffeeConfig.tempKalmanQ);
 }
 
 void loadConfiguration() {
-  preferences.begin("coffee-config", true); // read-only
-  
-  coffeeConfig.brewTemp = preferences.getFloat("brewTemp", 93.0);
-  coffeeConfig.steamTemp = preferences.getFloat("steamTemp", 150.0);
-  
-  // Load shot sizes
-  for (int i = 0; i < 4; i++) {
-    String key = "shot" + String(i);
-    coffeeConfig.shotSizes[i] = preferences.getFloat(key.c_str(), coffeeConfig.shotSizes[i]);
+  StoredConfig record;
+  toRecord(CoffeeConfig(), record);  // Defaults for anything not stored
+  bool rewrite = false;
+
+  preferences.begin(STORAGE_NAMESPACE, false);
+
+  uint8_t blob[sizeof(StoredHeader) + sizeof(StoredConfig)];
+  size_t length = preferences.getBytesLength(STORAGE_KEY);
+  StoredHeader header;
+  bool valid = false;
+  if (length >= sizeof(header) && length <= sizeof(blob) &&
+      preferences.getBytes(STORAGE_KEY, blob, length) == length) {
+    memcpy(&header, blob, sizeof(header));
+    valid = header.magic == STORAGE_MAGIC &&
+            header.version <= STORAGE_SCHEMA_VERSION &&
+            header.size == length - sizeof(header) &&
+            header.crc == crc32(blob + sizeof(header), header.size);
   }
-  
-  // Load grind times
-  for (int i = 0; i < 2; i++) {
-    String key = "grind" + String(i);
-    coffeeConfig.grindTimes[i] = preferences.getFloat(key.c_str(), coffeeConfig.grindTimes[i]);
+
+  if (valid) {
+    memcpy(&record, blob + sizeof(header), header.size);
+    fromRecord(record, coffeeConfig);
+    stats.loadedVersion = header.version;
+    // Older schema or a shorter record: store it again with the new fields
+    rewrite = header.version != STORAGE_SCHEMA_VERSION || header.size != sizeof(StoredConfig);
+    Serial.printf("Configuration loaded from flash memory (schema v%d)\n", header.version);
+  } else if (preferences.isKey("brewTemp")) {
+    loadLegacyConfiguration();
+    toRecord(coffeeConfig, record);
+    preferences.clear();  // Drop the per-key layout; the blob replaces it
+    stats.loadedVersion = 0;
+    rewrite = true;
+    Serial.println("Configuration migrated from per-key storage");
+  } else {
+    fromRecord(record, coffeeConfig);
+    if (length > 0) {
+      stats.loadErrors++;
+      Serial.println("Stored configuration invalid - using defaults");
+    } else {
+      Serial.println("No stored configuration - using defaults");
+    }
   }
-  
-  coffeeConfig.pidKp = preferences.getFloat("pidKp", 2.0);
-  coffeeConfig.pidKi = preferences.getFloat("pidKi", 5.0);
-  coffeeConfig.pidKd = preferences.getFloat("pidKd", 1.0);
-  coffeeConfig.usePID = preferences.getBool("usePID", false);
-  coffeeConfig.enableInfluxDB = preferences.getBool("influxEnable", true);
-  coffeeConfig.tempUpdateInterval = preferences.getInt("tempInterval", 2000);
-  
+
   preferences.end();
-  Serial.println("Configuration loaded from flash memory");
+
+  // What flash holds in the current schema; anything else forces a write
+  if (valid && !rewrite) {
+    storedRecord = record;
+  } else {
+    memset(&storedRecord, 0xFF, sizeof(storedRecord));
+  }
+  if (rewrite) {
+    // Write the migrated record right away rather than after the debounce
+    saveConfiguration();
+    flushConfiguration();
+  }
 }
 
+StorageStats getStorageStats() {
+  portENTER_CRITICAL(&pendingMux);
+  StorageStats copy = stats;
+  portEXIT_CRITICAL(&pendingMux);
+  return copy;
+}
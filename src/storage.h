@@ -3,17 +3,47 @@
 
 #include "config.h"
 
+// ======= Storage Settings =======
+#define STORAGE_SCHEMA_VERSION   1      // Bump when a stored field changes meaning
+#define STORAGE_DEBOUNCE_MS      2000   // Quiet time before a pending save is written
+#define STORAGE_TASK_CORE        1
+#define STORAGE_TASK_PRIORITY    1
+#define STORAGE_TASK_STACK_SIZE  3072
+
+// Flash write accounting
+struct StorageStats {
+  uint32_t saveRequests = 0;    // saveConfiguration() calls
+  uint32_t commits = 0;         // Debounced commits attempted
+  uint32_t flashWrites = 0;     // Commits that actually wrote NVS
+  uint32_t unchangedSkips = 0;  // Commits skipped because nothing changed
+  uint32_t writeErrors = 0;
+  uint32_t loadErrors = 0;      // Stored record failed its header/CRC check
+  bool pending = false;         // A save is waiting for the debounce to expire
+  uint16_t loadedVersion = 0;   // Schema found at boot (0 = legacy per-key layout)
+};
+
 // External dependencies
 extern CoffeeConfig coffeeConfig;
 
-// Initialize preferences/storage
+// Initialize preferences/storage and start the background writer
 void initStorage();
 
-// Save configuration to flash memory
+// Request that the current configuration is persisted. Returns immediately;
+// bursts of requests are coalesced and written once by the storage task, and
+// only if the stored record would actually change.
 void saveConfiguration();
 
+// Write any pending configuration now (e.g. before a reboot)
+void flushConfiguration();
+
+// Commit the pending request once it has been quiet for STORAGE_DEBOUNCE_MS
+// (called by the storage task, or by the simulation clock on the host)
+void stepStorage();
+
 // Load configuration from flash memory
 void loadConfiguration();
 
-#endif // STORAGE_H
+// Flash write counters
+StorageStats getStorageStats();
 
+#endif // STORAGE_H
@@ -0,0 +1,338 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+// ======= Line Protocol =======
+// coffee,host=<host> temp=..,target=..,duty=..,heap=..i,... <timestamp>
+// coffee,host=<host>,boot=<id> ... <ns since boot>    (clock not synchronized)
+size_t formatTelemetryLine(char *out, size_t capacity, const char *host,
+                           const TelemetrySample &s) {
+  int len;
+  if (s.timestampNs != 0) {
+    len = snprintf(out, capacity, TELEMETRY_MEASUREMENT ",host=%s ", host);
+  } else {
+    len = snprintf(out, capacity, TELEMETRY_MEASUREMENT ",host=%s,boot=%08lx ", host,
+                   (unsigned long)s.bootId);
+  }
+  if (len < 0 || (size_t)len >= capacity) return 0;
+  size_t used = len;
+
+  // Temperature fields are left out entirely while the sensor is faulted
+  if (s.flags & TELEMETRY_FLAG_TEMP_VALID) {
+    len = snprintf(out + used, capacity - used, "temp=%.2f,raw=%.2f,rate=%.3f,",
+                   s.temp, s.rawTemp, s.rate);
+    if (len < 0 || (size_t)len >= capacity - used) return 0;
+    used += len;
+  }
+
+  len = snprintf(out + used, capacity - used,
+                 "target=%.1f,duty=%.1f,pid_p=%.2f,pid_i=%.2f,pid_d=%.2f,"
+                 "steam=%s,heating=%s,pump=%s,grinder=%s,faults=%ui,heap=%lui,rssi=%di,"
+                 "loop_max_us=%lui,ctrl_period_us=%lui,ctrl_exec_us=%lui,"
+                 "heap_largest=%lui,heap_min=%lui,stack_min=%lui,lv_used=%ui,lv_frag=%ui,health=%ui",
+                 s.target, s.duty, s.pidP, s.pidI, s.pidD,
+                 (s.flags & TELEMETRY_FLAG_STEAM_MODE) ? "t" : "f",
+                 (s.flags & TELEMETRY_FLAG_HEATING) ? "t" : "f",
+                 (s.flags & TELEMETRY_FLAG_PUMP) ? "t" : "f",
+                 (s.flags & TELEMETRY_FLAG_GRINDER) ? "t" : "f",
+                 (unsigned)s.sensorFaults, (unsigned long)s.freeHeap, (int)s.rssi,
+                 (unsigned long)s.loopMaxUs, (unsigned long)s.controlPeriodUs,
+                 (unsigned long)s.controlExecUs, (unsigned long)s.heapLargest,
+                 (unsigned long)s.heapMin, (unsigned long)s.stackMin, (unsigned)s.lvglUsedPct,
+                 (unsigned)s.lvglFragPct, (unsigned)s.healthAlerts);
+  if (len < 0 || (size_t)len >= capacity - used) return 0;
+  used += len;
+
+  uint64_t timestampNs = s.timestampNs != 0 ? s.timestampNs : (uint64_t)s.capturedMs * 1000000ULL;
+  len = snprintf(out + used, capacity - used, " %llu", (unsigned long long)timestampNs);
+  if (len < 0 || (size_t)len >= capacity - used) return 0;
+  used += len;
+
+  if (used + 1 >= capacity) return 0;
+  out[used++] = '\n';
+  out[used] = '\0';
+  return used;
+}
+
+uint64_t telemetryNowNs() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  // Before NTP sync the clock starts at 1970; those points use the boot clock
+  if (tv.tv_sec < 1600000000) {
+    return 0;
+  }
+  return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000ULL;
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <lwip/sockets.h>
+#include "telemetry_spool.h"
+#include "profiler.h"
+
+// ======= Telemetry State =======
+static WiFiUDP udp;
+static IPAddress influxHost;
+static uint16_t influxPort = 0;
+static uint16_t influxProbePort = 0;
+static char hostTag[TELEMETRY_HOST_MAX] = "coffee";
+static TelemetryStats stats;
+
+// Preallocated packet buffer; lines are appended until the next one won't
+// fit. The samples are kept alongside so a failed send can be spooled.
+static char packet[TELEMETRY_PACKET_SIZE];
+static size_t packetLength = 0;
+static TelemetrySample pending[TELEMETRY_MAX_LINES];
+static size_t pendingCount = 0;
+static unsigned long packetStartedMs = 0;
+
+static uint32_t bootId = 0;
+
+// Reachability. Packets are only sent within TELEMETRY_PROBE_FRESH_MS of a
+// successful probe; otherwise a probe is started and the samples wait for
+// it (or go to the spool if it fails).
+static bool hostReachable = true;
+static unsigned long lastProbeMs = 0;
+static unsigned long lastProbeOkMs = 0;
+static bool probeOk = false;              // lastProbeOkMs is valid
+static int probeSocket = -1;              // Connect in progress
+static unsigned long lastReplayMs = 0;
+
+// ======= Link State =======
+static bool linkUp() {
+  if (WiFi.status() != WL_CONNECTED || !hostReachable) {
+    return false;
+  }
+  return influxProbePort == 0 || (probeOk && millis() - lastProbeOkMs < TELEMETRY_PROBE_FRESH_MS);
+}
+
+static void spoolPending() {
+  for (size_t i = 0; i < pendingCount; i++) {
+    spoolPush(pending[i]);
+  }
+  packetLength = 0;
+  pendingCount = 0;
+}
+
+static void finishProbe(bool reachable) {
+  if (probeSocket >= 0) {
+    close(probeSocket);
+    probeSocket = -1;
+  }
+  if (reachable) {
+    lastProbeOkMs = millis();
+    probeOk = true;
+  } else {
+    stats.probeFailures++;
+    // Samples held for this probe are not sent into a dead link
+    spoolPending();
+  }
+  if (reachable != hostReachable) {
+    Serial.printf("Telemetry: InfluxDB host %s\n", reachable ? "reachable again" : "unreachable - spooling");
+  }
+  hostReachable = reachable;
+}
+
+// UDP gives no delivery feedback, so a TCP connect to the InfluxDB HTTP
+// port serves as the reachability check. The connect is non-blocking and
+// polled from telemetryLoop(), so loop() and LVGL never wait on it.
+static void startProbe() {
+  if (probeSocket >= 0 || influxProbePort == 0 || WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  lastProbeMs = millis();
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    finishProbe(false);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(influxProbePort);
+  addr.sin_addr.s_addr = (uint32_t)influxHost;
+  probeSocket = fd;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+    finishProbe(true);
+  } else if (errno != EINPROGRESS) {
+    finishProbe(false);
+  }
+}
+
+static void pollProbe() {
+  if (probeSocket < 0) {
+    return;
+  }
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(probeSocket, &writable);
+  struct timeval noWait = {0, 0};
+  int ready = select(probeSocket + 1, NULL, &writable, NULL, &noWait);
+  if (ready > 0) {
+    // Writable once the connect has finished, either way
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(probeSocket, SOL_SOCKET, SO_ERROR, &error, &length);
+    finishProbe(error == 0);
+  } else if (ready < 0 || millis() - lastProbeMs >= TELEMETRY_PROBE_TIMEOUT_MS) {
+    finishProbe(false);
+  }
+}
+
+// Fill in wall-clock time for samples captured before NTP synchronized.
+// Samples spooled to flash before a reboot keep their boot clock.
+static void backfillTimestamp(TelemetrySample &sample) {
+  if (sample.timestampNs != 0 || sample.bootId != bootId) {
+    return;
+  }
+  uint64_t nowNs = telemetryNowNs();
+  if (nowNs != 0) {
+    sample.timestampNs = nowNs - (uint64_t)(millis() - sample.capturedMs) * 1000000ULL;
+  }
+}
+
+// ======= Packet Handling =======
+static bool sendPacket() {
+  PROFILE_SCOPE("telemetry sendPacket");
+  if (!linkUp()) {
+    return false;
+  }
+  bool ok = udp.beginPacket(influxHost, influxPort) &&
+            udp.write((const uint8_t *)packet, packetLength) == packetLength &&
+            udp.endPacket();
+  if (ok) {
+    stats.packetsSent++;
+  } else {
+    stats.sendFailures++;
+  }
+  return ok;
+}
+
+static void flushPacket() {
+  if (pendingCount == 0) {
+    return;
+  }
+  if (sendPacket()) {
+    stats.samplesSent += pendingCount;
+    packetLength = 0;
+    pendingCount = 0;
+  } else {
+    spoolPending();
+  }
+}
+
+static bool appendLine(const TelemetrySample &sample) {
+  if (pendingCount >= TELEMETRY_MAX_LINES) {
+    return false;
+  }
+  size_t len = formatTelemetryLine(packet + packetLength, sizeof(packet) - packetLength,
+                                   hostTag, sample);
+  if (len == 0) {
+    return false;
+  }
+  if (pendingCount == 0) {
+    packetStartedMs = millis();
+  }
+  packetLength += len;
+  pending[pendingCount++] = sample;
+  return true;
+}
+
+// Send one packet worth of spooled samples
+static void replaySpool() {
+  TelemetrySample batch[TELEMETRY_MAX_LINES];
+  size_t n = spoolPopBatch(batch, TELEMETRY_MAX_LINES);
+  size_t taken = 0;
+  while (taken < n) {
+    backfillTimestamp(batch[taken]);
+    if (!appendLine(batch[taken])) break;
+    taken++;
+  }
+  // Whatever did not fit goes back for the next round, oldest first
+  for (size_t i = n; i > taken; i--) {
+    spoolPushFront(batch[i - 1]);
+  }
+  flushPacket();
+}
+
+// ======= Public Interface =======
+uint32_t telemetryBootId() {
+  if (bootId == 0) {
+    bootId = esp_random() | 1;
+  }
+  return bootId;
+}
+
+void initTelemetry(const char *host, const uint8_t ip[4], uint16_t port, uint16_t probePort) {
+  telemetryBootId();
+  strncpy(hostTag, host, sizeof(hostTag) - 1);
+  hostTag[sizeof(hostTag) - 1] = '\0';
+  influxHost = IPAddress(ip[0], ip[1], ip[2], ip[3]);
+  influxPort = port;
+  influxProbePort = probePort;
+  packetLength = 0;
+  pendingCount = 0;
+}
+
+void telemetryAddSample(const TelemetrySample &captured) {
+  TelemetrySample sample = captured;
+  sample.bootId = telemetryBootId();
+  if (WiFi.status() != WL_CONNECTED || !hostReachable) {
+    spoolPush(sample);
+    return;
+  }
+  if (appendLine(sample)) {
+    return;
+  }
+  // Packet full: send it if the link was just confirmed, otherwise this
+  // sample waits in the spool while the held packet waits for the probe
+  if (linkUp()) {
+    flushPacket();
+    appendLine(sample);
+  } else {
+    spoolPush(sample);
+  }
+}
+
+void telemetryLoop() {
+  unsigned long now = millis();
+  pollProbe();
+
+  bool full = pendingCount >= TELEMETRY_MAX_LINES;
+  if (pendingCount > 0 && (full || now - packetStartedMs >= TELEMETRY_FLUSH_MS)) {
+    if (linkUp() || WiFi.status() != WL_CONNECTED || !hostReachable) {
+      flushPacket();     // Sent, or spooled when the link is down
+    } else {
+      startProbe();      // Confirm the host first; the packet is held
+    }
+  }
+
+  // While down, probe periodically until the host answers
+  if (!hostReachable && now - lastProbeMs >= TELEMETRY_PROBE_INTERVAL_MS) {
+    startProbe();
+  }
+
+  // Rate-limited replay, only while no live packet is being filled
+  if (pendingCount == 0 && spoolCount() > 0 && now - lastReplayMs >= TELEMETRY_REPLAY_INTERVAL_MS) {
+    if (linkUp()) {
+      lastReplayMs = now;
+      replaySpool();
+    } else if (hostReachable) {
+      startProbe();
+    }
+  }
+}
+
+TelemetryStats getTelemetryStats() {
+  TelemetryStats s = stats;
+  s.linkUp = linkUp();
+  return s;
+}
+#endif // ARDUINO
@@ -0,0 +1,97 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ======= Telemetry Settings =======
+#define TELEMETRY_PACKET_SIZE     1400   // Stays below a single-frame UDP payload
+#define TELEMETRY_FLUSH_MS        5000   // Send a partial packet after this long
+#define TELEMETRY_HOST_MAX        32
+#define TELEMETRY_MEASUREMENT     "coffee"
+#define TELEMETRY_MAX_LINES       16     // Samples held until their packet is sent
+
+// Offline handling: a packet is only sent shortly after a successful
+// non-blocking TCP probe of the InfluxDB host. Samples go to the spool
+// while the host is down (probed every interval) and are replayed one
+// packet per interval once it answers again.
+#define TELEMETRY_REPLAY_INTERVAL_MS  250
+#define TELEMETRY_PROBE_INTERVAL_MS   10000  // While the host is unreachable
+#define TELEMETRY_PROBE_TIMEOUT_MS    1000
+#define TELEMETRY_PROBE_FRESH_MS      2000   // A probe vouches for sends this long
+#ifndef TELEMETRY_PROBE_PORT
+#define TELEMETRY_PROBE_PORT          8086   // InfluxDB HTTP port (0 = no probe)
+#endif
+
+// Sample flags
+#define TELEMETRY_FLAG_TEMP_VALID  0x01
+#define TELEMETRY_FLAG_STEAM_MODE  0x02
+#define TELEMETRY_FLAG_HEATING     0x04
+#define TELEMETRY_FLAG_PUMP        0x08
+#define TELEMETRY_FLAG_GRINDER     0x10
+
+// One point of machine state, written as one InfluxDB line. Every line
+// carries a timestamp: before NTP has synchronized (or on a LAN without it)
+// the time since boot, tagged boot=<bootId> so it forms its own series.
+// Untimestamped lines of one datagram would all get the same arrival time
+// and InfluxDB would keep only the last.
+struct TelemetrySample {
+  uint64_t timestampNs = 0;     // Wall clock; 0 = not synchronized at capture
+  uint32_t capturedMs = 0;      // millis() at capture, to backfill timestampNs
+  uint32_t bootId = 0;          // Boot the capture belongs to (capturedMs is only
+                                // meaningful within it)
+  float temp = 0.0;             // Filtered °C
+  float rawTemp = 0.0;
+  float target = 0.0;
+  float rate = 0.0;             // °C/s
+  float duty = 0.0;             // SSR duty cycle (0-100%)
+  float pidP = 0.0;
+  float pidI = 0.0;
+  float pidD = 0.0;
+  uint32_t freeHeap = 0;
+  uint32_t heapLargest = 0;     // Largest free block (health monitor)
+  uint32_t heapMin = 0;         // Lowest free heap since boot
+  uint32_t stackMin = 0;        // Least unused stack of the watched tasks
+  uint32_t loopMaxUs = 0;       // Longest loop() iteration since last sample
+  uint32_t controlPeriodUs = 0;
+  uint32_t controlExecUs = 0;
+  int16_t rssi = 0;
+  uint8_t sensorFaults = 0;
+  uint8_t flags = 0;            // TELEMETRY_FLAG_*
+  uint8_t lvglUsedPct = 0;
+  uint8_t lvglFragPct = 0;
+  uint8_t healthAlerts = 0;     // HEALTH_ALERT_*
+};
+
+// Format one line-protocol line into out (no heap use).
+// Returns the number of bytes written, or 0 if it does not fit.
+size_t formatTelemetryLine(char *out, size_t capacity, const char *host,
+                           const TelemetrySample &sample);
+
+// Wall-clock time in nanoseconds, or 0 if not yet synchronized (NTP)
+uint64_t telemetryNowNs();
+
+// Random per boot, set on samples as they are added
+uint32_t telemetryBootId();
+
+struct TelemetryStats {
+  bool linkUp = false;
+  uint32_t packetsSent = 0;
+  uint32_t samplesSent = 0;
+  uint32_t sendFailures = 0;
+  uint32_t probeFailures = 0;
+};
+
+// Set destination and host tag (call once after WiFi is up)
+void initTelemetry(const char *host, const uint8_t ip[4], uint16_t port,
+                   uint16_t probePort = TELEMETRY_PROBE_PORT);
+
+// Append a sample to the pending packet; flushes first if it would not fit
+void telemetryAddSample(const TelemetrySample &sample);
+
+// Time-based flush, link probing and spool replay (call from loop)
+void telemetryLoop();
+
+TelemetryStats getTelemetryStats();
+
+#endif // TELEMETRY_H
@@ -0,0 +1,176 @@
+#include "telemetry_spool.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <LittleFS.h>
+#endif
+
+// ======= RAM Ring =======
+static TelemetrySample ring[TELEMETRY_SPOOL_SAMPLES];
+static size_t ringHead = 0;     // Oldest sample
+static size_t ringCount = 0;
+static SpoolStats stats;
+
+static TelemetrySample &ringAt(size_t i) {
+  return ring[(ringHead + i) % TELEMETRY_SPOOL_SAMPLES];
+}
+
+static void ringDropOldest(size_t n) {
+  ringHead = (ringHead + n) % TELEMETRY_SPOOL_SAMPLES;
+  ringCount -= n;
+}
+
+// ======= Flash Log =======
+// File layout: [magic][record size] followed by raw TelemetrySample records.
+// Records before flashReadIndex have already been replayed.
+static bool flashEnabled = false;
+static uint32_t flashRecords = 0;
+static uint32_t flashReadIndex = 0;
+
+struct SpoolFileHeader {
+  uint32_t magic;
+  uint32_t recordSize;
+};
+
+#ifdef ARDUINO
+static void flashReset() {
+  LittleFS.remove(TELEMETRY_SPOOL_FILE);
+  flashRecords = 0;
+  flashReadIndex = 0;
+}
+
+static bool flashSpill(size_t n) {
+  size_t needed = sizeof(SpoolFileHeader) + (flashRecords + n) * sizeof(TelemetrySample);
+  if (needed > TELEMETRY_SPOOL_FILE_MAX) {
+    return false;
+  }
+
+  File file = LittleFS.open(TELEMETRY_SPOOL_FILE, "a");
+  if (!file) {
+    return false;
+  }
+  if (file.size() == 0) {
+    SpoolFileHeader header = { TELEMETRY_SPOOL_MAGIC, sizeof(TelemetrySample) };
+    file.write((const uint8_t *)&header, sizeof(header));
+  }
+  // Oldest RAM samples, in at most two contiguous pieces of the ring
+  size_t first = TELEMETRY_SPOOL_SAMPLES - ringHead;
+  if (first > n) first = n;
+  file.write((const uint8_t *)&ring[ringHead], first * sizeof(TelemetrySample));
+  if (n > first) {
+    file.write((const uint8_t *)&ring[0], (n - first) * sizeof(TelemetrySample));
+  }
+  file.close();
+
+  flashRecords += n;
+  ringDropOldest(n);
+  return true;
+}
+
+static size_t flashRead(TelemetrySample *out, size_t maxSamples) {
+  File file = LittleFS.open(TELEMETRY_SPOOL_FILE, "r");
+  if (!file) {
+    flashReset();
+    return 0;
+  }
+  size_t n = flashRecords - flashReadIndex;
+  if (n > maxSamples) n = maxSamples;
+  file.seek(sizeof(SpoolFileHeader) + flashReadIndex * sizeof(TelemetrySample));
+  size_t bytes = file.read((uint8_t *)out, n * sizeof(TelemetrySample));
+  file.close();
+
+  n = bytes / sizeof(TelemetrySample);
+  flashReadIndex += n;
+  if (n == 0 || flashReadIndex >= flashRecords) {
+    flashReset();  // Fully replayed (or unreadable) - start a fresh file
+  }
+  return n;
+}
+
+void initTelemetrySpool(bool useFlash) {
+  flashEnabled = useFlash;
+  if (!flashEnabled) {
+    return;
+  }
+  if (!LittleFS.begin(true)) {
+    Serial.println("Telemetry spool: LittleFS mount failed, RAM only");
+    flashEnabled = false;
+    return;
+  }
+
+  // Samples spooled before a reboot are replayed; InfluxDB overwrites any
+  // point that had already arrived (same timestamp, tags and fields).
+  File file = LittleFS.open(TELEMETRY_SPOOL_FILE, "r");
+  if (file) {
+    SpoolFileHeader header = {};
+    bool valid = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                 header.magic == TELEMETRY_SPOOL_MAGIC &&
+                 header.recordSize == sizeof(TelemetrySample);
+    size_t size = file.size();
+    file.close();
+    if (valid) {
+      flashRecords = (size - sizeof(header)) / sizeof(TelemetrySample);
+      flashReadIndex = 0;
+      Serial.printf("Telemetry spool: %u samples pending from flash\n", (unsigned)flashRecords);
+    } else {
+      flashReset();
+    }
+  }
+}
+#else
+static bool flashSpill(size_t n) { return false; }
+static size_t flashRead(TelemetrySample *out, size_t maxSamples) { return 0; }
+void initTelemetrySpool(bool useFlash) { flashEnabled = false; }
+#endif // ARDUINO
+
+// ======= Public Interface =======
+void spoolPush(const TelemetrySample &sample) {
+  if (ringCount == TELEMETRY_SPOOL_SAMPLES) {
+    if (!(flashEnabled && flashSpill(TELEMETRY_SPOOL_SPILL))) {
+      ringDropOldest(1);
+      stats.dropped++;
+    }
+  }
+  ringAt(ringCount) = sample;
+  ringCount++;
+  stats.spooled++;
+}
+
+void spoolPushFront(const TelemetrySample &sample) {
+  if (ringCount == TELEMETRY_SPOOL_SAMPLES) {
+    stats.dropped++;
+    return;
+  }
+  ringHead = (ringHead + TELEMETRY_SPOOL_SAMPLES - 1) % TELEMETRY_SPOOL_SAMPLES;
+  ring[ringHead] = sample;
+  ringCount++;
+  stats.replayed--;
+}
+
+size_t spoolPopBatch(TelemetrySample *out, size_t maxSamples) {
+  size_t n = 0;
+  // Flash holds the oldest samples
+  if (flashRecords > flashReadIndex) {
+    n = flashRead(out, maxSamples);
+  } else {
+    n = ringCount < maxSamples ? ringCount : maxSamples;
+    for (size_t i = 0; i < n; i++) {
+      out[i] = ringAt(i);
+    }
+    ringDropOldest(n);
+  }
+  stats.replayed += n;
+  return n;
+}
+
+uint32_t spoolCount() {
+  return ringCount + (flashRecords - flashReadIndex);
+}
+
+SpoolStats getSpoolStats() {
+  SpoolStats s = stats;
+  s.ramSamples = ringCount;
+  s.flashSamples = flashRecords - flashReadIndex;
+  return s;
+}
@@ -0,0 +1,40 @@
+#ifndef TELEMETRY_SPOOL_H
+#define TELEMETRY_SPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+// ======= Spool Settings =======
+#define TELEMETRY_SPOOL_SAMPLES     256      // RAM ring (~8.5 min at 2 s)
+#define TELEMETRY_SPOOL_SPILL       64       // Samples moved to flash per write
+#define TELEMETRY_SPOOL_FILE        "/telemetry.spool"
+#define TELEMETRY_SPOOL_FILE_MAX    (256UL * 1024UL)
+#define TELEMETRY_SPOOL_MAGIC       0x31505354  // "TSP1"
+
+struct SpoolStats {
+  uint32_t ramSamples = 0;
+  uint32_t flashSamples = 0;     // Not yet replayed
+  uint32_t spooled = 0;          // Total samples ever spooled
+  uint32_t replayed = 0;
+  uint32_t dropped = 0;          // Lost because RAM and flash were full
+};
+
+// Mount the flash log if enabled and pick up samples left from before a reboot
+void initTelemetrySpool(bool useFlash);
+
+// Append a sample (oldest samples spill to flash or are dropped when full)
+void spoolPush(const TelemetrySample &sample);
+
+// Put back samples whose replay failed, ahead of everything else
+void spoolPushFront(const TelemetrySample &sample);
+
+// Remove up to maxSamples of the oldest samples; returns the number taken
+size_t spoolPopBatch(TelemetrySample *out, size_t maxSamples);
+
+// Number of samples waiting (RAM + flash)
+uint32_t spoolCount();
+
+SpoolStats getSpoolStats();
+
+#endif // TELEMETRY_SPOOL_H
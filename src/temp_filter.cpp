@@ -0,0 +1,108 @@
+#include "temp_filter.h"
+
+// ======= Configuration =======
+void TemperatureFilter::configure(int newMedianSize, int newMode, float newEmaAlpha, float newKalmanQ) {
+  // Median window must be odd and fit the ring buffer
+  if (newMedianSize < 1) newMedianSize = 1;
+  if (newMedianSize > TEMP_FILTER_MAX_MEDIAN) newMedianSize = TEMP_FILTER_MAX_MEDIAN;
+  if ((newMedianSize & 1) == 0) newMedianSize--;
+
+  if (newEmaAlpha <= 0.0 || newEmaAlpha > 1.0) newEmaAlpha = 1.0;
+  if (newKalmanQ <= 0.0) newKalmanQ = 0.0001;
+
+  if (newMedianSize != medianSize || newMode != mode) {
+    medianSize = newMedianSize;
+    mode = newMode;
+    reset();
+  }
+  emaAlpha = newEmaAlpha;
+  kalmanQ = newKalmanQ;
+}
+
+void TemperatureFilter::reset() {
+  rawHead = 0;
+  rawCount = 0;
+  filteredCount = 0;
+  kalmanP = 1.0;
+  historyHead = 0;
+  historyCount = 0;
+  slope = 0.0;
+}
+
+// ======= Sample Processing =======
+void TemperatureFilter::addSample(float celsius, float dtSeconds) {
+  raw[rawHead] = celsius;
+  rawHead = (rawHead + 1) % medianSize;
+  if (rawCount < medianSize) rawCount++;
+
+  float m = median();
+
+  if (filteredCount == 0) {
+    filtered = m;
+    kalmanP = TEMP_KALMAN_R;
+  } else if (mode == TEMP_FILTER_KALMAN) {
+    kalmanP += kalmanQ;
+    float gain = kalmanP / (kalmanP + TEMP_KALMAN_R);
+    filtered += gain * (m - filtered);
+    kalmanP *= (1.0 - gain);
+  } else {
+    filtered += emaAlpha * (m - filtered);
+  }
+  filteredCount++;
+
+  history[historyHead] = filtered;
+  historyDt[historyHead] = dtSeconds;
+  historyHead = (historyHead + 1) % TEMP_FILTER_SLOPE_POINTS;
+  if (historyCount < TEMP_FILTER_SLOPE_POINTS) historyCount++;
+  updateSlope();
+}
+
+float TemperatureFilter::median() const {
+  float sorted[TEMP_FILTER_MAX_MEDIAN];
+  for (int i = 0; i < rawCount; i++) {
+    // Insertion sort - at most 9 elements
+    float v = raw[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > v) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = v;
+  }
+  return sorted[rawCount / 2];
+}
+
+// Least-squares slope over the stored points. Times are rebuilt backwards
+// from the newest point so they never grow without bound.
+void TemperatureFilter::updateSlope() {
+  if (historyCount < 2) {
+    slope = 0.0;
+    return;
+  }
+
+  float t[TEMP_FILTER_SLOPE_POINTS];
+  float y[TEMP_FILTER_SLOPE_POINTS];
+  float time = 0.0;
+  int idx = (historyHead - 1 + TEMP_FILTER_SLOPE_POINTS) % TEMP_FILTER_SLOPE_POINTS;
+  for (int i = 0; i < historyCount; i++) {
+    t[i] = -time;
+    y[i] = history[idx];
+    time += historyDt[idx];
+    idx = (idx - 1 + TEMP_FILTER_SLOPE_POINTS) % TEMP_FILTER_SLOPE_POINTS;
+  }
+
+  float meanT = 0.0, meanY = 0.0;
+  for (int i = 0; i < historyCount; i++) {
+    meanT += t[i];
+    meanY += y[i];
+  }
+  meanT /= historyCount;
+  meanY /= historyCount;
+
+  float num = 0.0, den = 0.0;
+  for (int i = 0; i < historyCount; i++) {
+    num += (t[i] - meanT) * (y[i] - meanY);
+    den += (t[i] - meanT) * (t[i] - meanT);
+  }
+  slope = den > 0.0 ? num / den : 0.0;
+}
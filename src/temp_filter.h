@@ -0,0 +1,54 @@
+#ifndef TEMP_FILTER_H
+#define TEMP_FILTER_H
+
+#include <stdint.h>
+
+// ======= Filter Settings =======
+#define TEMP_FILTER_MAX_MEDIAN   9    // Largest median window (odd)
+#define TEMP_FILTER_SLOPE_POINTS 10   // Filtered points used for the derivative
+#define TEMP_KALMAN_R            0.05 // Measurement noise variance (°C²)
+
+enum TempFilterMode {
+  TEMP_FILTER_EMA = 0,     // Exponential moving average
+  TEMP_FILTER_KALMAN = 1   // 1st-order (random walk) Kalman filter
+};
+
+// Median-of-N spike rejection followed by EMA or Kalman smoothing.
+// The derivative is the least-squares slope over the last filtered points.
+class TemperatureFilter {
+public:
+  void configure(int medianSize, int mode, float emaAlpha, float kalmanQ);
+  void reset();
+
+  // Add one raw sample taken dtSeconds after the previous one
+  void addSample(float celsius, float dtSeconds);
+
+  bool ready() const { return filteredCount > 0; }
+  float value() const { return filtered; }
+  float derivative() const { return slope; }   // °C per second
+
+private:
+  int medianSize = 5;
+  int mode = TEMP_FILTER_EMA;
+  float emaAlpha = 0.3;
+  float kalmanQ = 0.01;
+
+  float raw[TEMP_FILTER_MAX_MEDIAN];
+  int rawHead = 0;
+  int rawCount = 0;
+
+  float filtered = 0.0;
+  float kalmanP = 1.0;
+  uint32_t filteredCount = 0;
+
+  float history[TEMP_FILTER_SLOPE_POINTS];
+  float historyDt[TEMP_FILTER_SLOPE_POINTS];
+  int historyHead = 0;
+  int historyCount = 0;
+  float slope = 0.0;
+
+  float median() const;
+  void updateSlope();
+};
+
+#endif // TEMP_FILTER_H
@@ -1,91 +1,188 @@
 #include "temperature.h"
-#include "Adafruit_MAX31855.h"
 #include "pid_control.h"
+#include "smith_predictor.h"
+#include "heater_output.h"
+#include "temp_filter.h"
+#include "max31855.h"
+#include "hal.h"
+#include "profiler.h"
+#include "trace_recorder.h"
+#include "shared_state.h"
 
-// ======= MAX31855 K-Type Thermocouple Settings =======
-#define MAX31855_CS   5   // Chip Select pin
-#define MAX31855_CLK  18  // Clock pin  
-#define MAX31855_DO   19  // Data Out pin
+// ======= Acquisition State =======
+static TemperatureFilter filter;           // Owned by the acquisition context
+static TemperatureReading pendingReading;  // Built up sample by sample
+static uint32_t consecutiveFaults = 0;
+static TemperatureReading latestReading;   // Guarded by readingMux
+static portMUX_TYPE readingMux = portMUX_INITIALIZER_UNLOCKED;
 
-// ======= Heating Element Control =======
-#define HEATING_ELEMENT_PIN  2  // GPIO2 for SSR control (Fotek SSR-40 DC)
+// ======= Sample Processing =======
+// Take one MAX31855 sample through fault handling and the filter, and
+// publish the result for the control task.
+void acquireTemperatureSample(float dtSeconds) {
+  PROFILE_SCOPE("acquireTemperatureSample");
+  TemperatureReading& next = pendingReading;
+  
+  // Acquisition task: the filter settings come from the snapshot
+  CoffeeConfig config = getConfigSnapshot();
+  filter.configure(config.tempMedianSize, config.tempFilterMode,
+                   config.tempFilterAlpha, config.tempKalmanQ);
+  
+  Max31855Frame frame;
+  bool ok = halReadThermocouple(frame);
+  next.faults = frame.faults;
+  
+  if (!ok) {
+    // Single glitches are ignored; a persistent fault invalidates the reading
+    if (++consecutiveFaults >= TEMP_FAULT_LIMIT) {
+      filter.reset();
+      next.valid = false;
+      next.derivative = 0.0;
+    }
+  } else {
+    consecutiveFaults = 0;
+    filter.addSample(frame.thermocoupleC, dtSeconds);
+    next.raw = frame.thermocoupleC;
+    next.coldJunction = frame.coldJunctionC;
+    next.celsius = filter.value();
+    next.derivative = filter.derivative();
+    next.valid = filter.ready();
+  }
+  next.sampleCount++;
+  
+  portENTER_CRITICAL(&readingMux);
+  latestReading = next;
+  portEXIT_CRITICAL(&readingMux);
+  
+  recordTraceSample(next);
+}
 
-// Initialize the MAX31855 sensor
-Adafruit_MAX31855 thermocouple(MAX31855_CLK, MAX31855_CS, MAX31855_DO);
+#ifdef ARDUINO
+// ======= Acquisition Task =======
+// Samples the MAX31855 at its conversion rate.
+static TaskHandle_t acquisitionTaskHandle = NULL;
+
+static void acquisitionTask(void *param) {
+  TickType_t lastWake = xTaskGetTickCount();
+  int64_t lastSampleUs = halMicros();
+  
+  for (;;) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(TEMP_SAMPLE_PERIOD_MS));
+    
+    int64_t nowUs = halMicros();
+    acquireTemperatureSample((nowUs - lastSampleUs) / 1000000.0);
+    lastSampleUs = nowUs;
+  }
+}
 
 // ======= Temperature Sensor Initialization =======
 void initTemperatureSensor() {
-  // Initialize heating element control pin
-  pinMode(HEATING_ELEMENT_PIN, OUTPUT);
-  digitalWrite(HEATING_ELEMENT_PIN, LOW);  // Start with heating OFF
-  Serial.println("Heating element pin initialized (OFF)");
+  // Initialize heating element output stage (SSR, time-proportioning)
+  initHeaterOutput();
   
   Serial.println("Initializing MAX31855 K-type thermocouple sensor...");
+  initMax31855();
+  
   // Test initial reading
-  float initialTemp = readTemperature();
-  if (initialTemp != -999.0) {
-    Serial.print("Initial temperature reading: ");
-    Serial.print(initialTemp);
-    Serial.println("°C");
+  Max31855Frame frame;
+  if (readMax31855(frame)) {
+    Serial.printf("Initial temperature reading: %.2f°C (cold junction %.2f°C)\n",
+                  frame.thermocoupleC, frame.coldJunctionC);
   } else {
     Serial.println("Warning: Temperature sensor not detected or faulty");
+    if (frame.faults & MAX31855_FAULT_OPEN) {
+      Serial.println("FAULT: Thermocouple is open - no connections.");
+    }
+    if (frame.faults & MAX31855_FAULT_SHORT_GND) {
+      Serial.println("FAULT: Thermocouple is short-circuited to GND.");
+    }
+    if (frame.faults & MAX31855_FAULT_SHORT_VCC) {
+      Serial.println("FAULT: Thermocouple is short-circuited to VCC.");
+    }
+    if (frame.faults & MAX31855_FAULT_NO_DEVICE) {
+      Serial.println("FAULT: No response from MAX31855 - check wiring.");
+    }
+  }
+  
+  // Start background sampling
+  BaseType_t created = xTaskCreatePinnedToCore(acquisitionTask, "temp_acq",
+                                               TEMP_ACQ_TASK_STACK_SIZE, NULL,
+                                               TEMP_ACQ_TASK_PRIORITY,
+                                               &acquisitionTaskHandle,
+                                               TEMP_ACQ_TASK_CORE);
+  if (created == pdPASS) {
+    Serial.printf("Temperature acquisition at %d ms (median %d, %s)\n",
+                  TEMP_SAMPLE_PERIOD_MS, coffeeConfig.tempMedianSize,
+                  coffeeConfig.tempFilterMode == TEMP_FILTER_KALMAN ? "Kalman" : "EMA");
+  } else {
+    Serial.println("Error: Failed to create temperature acquisition task!");
   }
 }
 
-// ======= Temperature Reading Function =======
+#endif // ARDUINO
+
+// ======= Temperature Reading Functions =======
+TemperatureReading getTemperatureReading() {
+  portENTER_CRITICAL(&readingMux);
+  TemperatureReading reading = latestReading;
+  portEXIT_CRITICAL(&readingMux);
+  return reading;
+}
+
 float readTemperature() {
-  double tempC = thermocouple.readCelsius();
+  TemperatureReading reading = getTemperatureReading();
   
   // Check for sensor errors
-  if (isnan(tempC)) {
-    // TEMP: Disabled error messages for touch calibration
-    // Serial.println("Error: Thermocouple fault detected!");
-    // uint8_t error = thermocouple.readError();
-    // if (error & MAX31855_FAULT_OPEN) {
-    //   Serial.println("FAULT: Thermocouple is open - no connections.");
-    // }
-    // if (error & MAX31855_FAULT_SHORT_GND) {
-    //   Serial.println("FAULT: Thermocouple is short-circuited to GND.");
-    // }
-    // if (error & MAX31855_FAULT_SHORT_VCC) {
-    //   Serial.println("FAULT: Thermocouple is short-circuited to VCC.");
-    // }
+  if (!reading.valid) {
     return -999.0; // Return error value
   }
   
-  return tempC;
+  return reading.celsius;
 }
 
 // ======= Heating Element Control Functions =======
+// Full on/off request; PID mode drives setHeaterDuty() directly
 void setHeatingElement(bool state) {
-  digitalWrite(HEATING_ELEMENT_PIN, state ? HIGH : LOW);
-  systemState.heatingElement = state;
+  setHeaterDuty(state ? 100.0 : 0.0);
   
   Serial.print("Heating element: ");
   Serial.println(state ? "ON" : "OFF");
 }
 
 bool getHeatingElement() {
-  return systemState.heatingElement;
+  return systemState.has(STATE_HEATING);
 }
 
 // ======= Temperature Control Function =======
+const char *controlModeName(int mode) {
+  switch (mode) {
+    case CONTROL_MODE_PID:    return "pid";
+    case CONTROL_MODE_SMITH:  return "smith";
+    default:                  return "onoff";
+  }
+}
+
 void updateHeatingControl() {
+  PROFILE_SCOPE("updateHeatingControl");
   float currentTemp = systemState.currentTemp;
   float targetTemp = systemState.targetTemp;
   
-  if (coffeeConfig.usePID) {
+  if (coffeeConfig.controlMode == CONTROL_MODE_PID) {
     // PID Control Mode - delegate to PID module
-    updatePIDControl(currentTemp, targetTemp);
+    updatePIDControl(currentTemp, systemState.tempDerivative, targetTemp);
+    
+  } else if (coffeeConfig.controlMode == CONTROL_MODE_SMITH) {
+    // Dead-time compensated PI - delegate to the Smith predictor
+    updateSmithControl(currentTemp, targetTemp);
     
   } else {
     // Simple on/off control with 1°C hysteresis
     if (currentTemp < targetTemp - 1.0) {
-      if (!systemState.heatingElement) {
+      if (!systemState.has(STATE_HEATING)) {
         setHeatingElement(true);
       }
     } else if (currentTemp > targetTemp) {
-      if (systemState.heatingElement) {
+      if (systemState.has(STATE_HEATING)) {
         setHeatingElement(false);
       }
     }
@@ -4,21 +4,55 @@
 #include <Arduino.h>
 #include "config.h"
 
+// ======= Acquisition Settings =======
+#define TEMP_SAMPLE_PERIOD_MS     100   // MAX31855 conversion time is ~100 ms
+#define TEMP_FAULT_LIMIT          3     // Consecutive bad samples before a fault
+#define TEMP_ACQ_TASK_CORE        0
+#define TEMP_ACQ_TASK_PRIORITY    (configMAX_PRIORITIES - 4)
+#define TEMP_ACQ_TASK_STACK_SIZE  3072
+
+// Filtered thermocouple reading from the acquisition task
+struct TemperatureReading {
+  float celsius = 0.0;      // Filtered temperature
+  float raw = 0.0;          // Latest raw sample
+  float coldJunction = 0.0; // MAX31855 internal (cold-junction) temperature
+  uint8_t faults = 0;       // MAX31855_FAULT_* bits of the latest sample
+  float derivative = 0.0;   // Filtered rate of change (°C/s)
+  bool valid = false;
+  uint32_t sampleCount = 0;
+};
+
 // External dependencies
 extern CoffeeConfig coffeeConfig;
 extern SystemState systemState;
 
-// Initialize temperature sensor
+// Initialize temperature sensor and start background sampling
 void initTemperatureSensor();
 
-// Read temperature from K-type sensor
+// Read, filter and publish one sample (called every TEMP_SAMPLE_PERIOD_MS
+// by the acquisition task, or by the simulation clock on the host)
+void acquireTemperatureSample(float dtSeconds);
+
+// Latest filtered temperature (-999.0 on sensor fault)
 float readTemperature();
 
+// Latest filtered reading including raw value and derivative
+TemperatureReading getTemperatureReading();
+
 // Heating element control
 void setHeatingElement(bool state);
 bool getHeatingElement();
 
-// Temperature control (on/off or PID)
+// ======= Control Modes =======
+enum ControlMode {
+  CONTROL_MODE_ONOFF = 0,     // Hysteresis around the target
+  CONTROL_MODE_PID = 1,       // PID with gain schedule
+  CONTROL_MODE_SMITH = 2      // PI on a Smith predictor (FOPDT model)
+};
+
+const char *controlModeName(int mode);
+
+// Temperature control in the configured mode
 void updateHeatingControl();
 
 #endif // TEMPERATURE_H
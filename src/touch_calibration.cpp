@@ -0,0 +1,79 @@
+#include "touch_calibration.h"
+#include <math.h>
+
+// ======= Fit =======
+// Both screen axes share the normal equations of the raw points, so one
+// 3x3 system is solved (Cramer's rule) for two right-hand sides.
+static double det3(const double m[3][3]) {
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+static void solve3(const double m[3][3], double det, const double rhs[3], float out[3]) {
+  for (int col = 0; col < 3; col++) {
+    double replaced[3][3];
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) replaced[r][c] = c == col ? rhs[r] : m[r][c];
+    }
+    out[col] = (float)(det3(replaced) / det);
+  }
+}
+
+bool solveTouchCalibration(const TouchPoint raw[TOUCH_CAL_POINTS],
+                           const TouchPoint screen[TOUCH_CAL_POINTS],
+                           float matrix[6], float &maxError) {
+  double m[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  double rhsX[3] = {0, 0, 0};
+  double rhsY[3] = {0, 0, 0};
+  for (int i = 0; i < TOUCH_CAL_POINTS; i++) {
+    double v[3] = {(double)raw[i].x, (double)raw[i].y, 1.0};
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) m[r][c] += v[r] * v[c];
+      rhsX[r] += v[r] * screen[i].x;
+      rhsY[r] += v[r] * screen[i].y;
+    }
+  }
+
+  // Raw spans are ~3500 counts, so a real fit has a determinant around
+  // 1e13; collinear points leave only rounding noise
+  double det = det3(m);
+  if (fabs(det) < 1.0) return false;
+
+  float fit[6];
+  solve3(m, det, rhsX, fit);
+  solve3(m, det, rhsY, fit + 3);
+
+  maxError = 0.0;
+  for (int i = 0; i < TOUCH_CAL_POINTS; i++) {
+    float dx = fit[0] * raw[i].x + fit[1] * raw[i].y + fit[2] - screen[i].x;
+    float dy = fit[3] * raw[i].x + fit[4] * raw[i].y + fit[5] - screen[i].y;
+    float error = sqrtf(dx * dx + dy * dy);
+    if (error > maxError) maxError = error;
+  }
+  if (maxError > TOUCH_CAL_MAX_ERROR_PX) return false;
+
+  for (int i = 0; i < 6; i++) matrix[i] = fit[i];
+  return true;
+}
+
+TouchPoint applyTouchCalibration(const float matrix[6], int16_t rx, int16_t ry) {
+  TouchPoint p;
+  p.x = (int16_t)lroundf(matrix[0] * rx + matrix[1] * ry + matrix[2]);
+  p.y = (int16_t)lroundf(matrix[3] * rx + matrix[4] * ry + matrix[5]);
+  return p;
+}
+
+// ======= Median =======
+int16_t touchMedian(int16_t *values, int n) {
+  for (int i = 1; i < n; i++) {
+    int16_t v = values[i];
+    int j = i - 1;
+    while (j >= 0 && values[j] > v) {
+      values[j + 1] = values[j];
+      j--;
+    }
+    values[j + 1] = v;
+  }
+  return values[n / 2];
+}
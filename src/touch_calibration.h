@@ -0,0 +1,33 @@
+#ifndef TOUCH_CALIBRATION_H
+#define TOUCH_CALIBRATION_H
+
+#include <stdint.h>
+
+// ======= Touch Calibration =======
+// Screen position from a raw XPT2046 reading through an affine map
+//   x = m[0] * rx + m[1] * ry + m[2]
+//   y = m[3] * rx + m[4] * ry + m[5]
+// which covers scale, offset, mirrored or swapped axes and a slightly
+// rotated panel. It is fitted to the four corner targets of the
+// calibration screen.
+#define TOUCH_CAL_POINTS        4
+#define TOUCH_CAL_MAX_ERROR_PX  12.0   // Reject a fit that misses a target by more
+
+struct TouchPoint {
+  int16_t x;
+  int16_t y;
+};
+
+// Least-squares fit through the calibration points. False if the points
+// are degenerate (all touched in one spot or on one line) or a target is
+// missed by more than TOUCH_CAL_MAX_ERROR_PX; maxError gets the worst miss.
+bool solveTouchCalibration(const TouchPoint raw[TOUCH_CAL_POINTS],
+                           const TouchPoint screen[TOUCH_CAL_POINTS],
+                           float matrix[6], float &maxError);
+
+TouchPoint applyTouchCalibration(const float matrix[6], int16_t rx, int16_t ry);
+
+// Median of n values (sorts them in place)
+int16_t touchMedian(int16_t *values, int n);
+
+#endif // TOUCH_CALIBRATION_H
@@ -0,0 +1,351 @@
+#include "trace_recorder.h"
+#include <atomic>
+#include "temperature.h"
+#include "heater_output.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "hal.h"
+#include "shared_state.h"
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+// ======= Ring =======
+// Record indices only grow; the record with index n lives in slot
+// n % capacity. The acquisition task is the only writer: it fills the slot, then
+// publishes it by advancing `written`. A reader copies a record and keeps
+// it only if `written` shows the slot was not reused meanwhile.
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord layout is part of the dump format");
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader layout is part of the dump format");
+
+static TraceRecord *ring = NULL;
+static uint32_t capacity = 0;
+static bool ringInPsram = false;
+static std::atomic<uint32_t> written(0);
+static std::atomic<uint32_t> startIndex(0);   // First record of this recording
+
+// ======= Capture State =======
+// Written by the acquisition task, read by anyone
+static std::atomic<int> state(TRACE_STOPPED);
+static std::atomic<int> trigger(TRACE_TRIGGER_NONE);
+static std::atomic<uint32_t> postMs(TRACE_POST_MS);
+static std::atomic<uint32_t> triggerMs(0);
+static uint32_t lastShotId = 0;                // Acquisition task only
+
+// Latest control cycle, handed over by the control task
+static portMUX_TYPE controlMux = portMUX_INITIALIZER_UNLOCKED;
+static TraceRecord pendingControl;             // Guarded by controlMux
+static bool controlPending = false;
+static int16_t targetCenti = 0;
+static uint8_t controlFlags = 0;               // TRACE_FLAG_HEATING/STEAM/AUTOTUNE
+
+// Requests from other tasks
+static std::atomic<int> startRequest(-1);
+static std::atomic<uint32_t> startPostMs(TRACE_POST_MS);
+static std::atomic<bool> stopRequest(false);
+static std::atomic<bool> triggerRequest(false);
+
+void initTraceRecorder() {
+  if (ring != NULL) return;
+
+#ifdef ARDUINO
+  ring = (TraceRecord *)heap_caps_malloc(TRACE_PSRAM_RECORDS * sizeof(TraceRecord), MALLOC_CAP_SPIRAM);
+  if (ring != NULL) {
+    capacity = TRACE_PSRAM_RECORDS;
+    ringInPsram = true;
+  } else {
+    ring = (TraceRecord *)heap_caps_malloc(TRACE_RAM_RECORDS * sizeof(TraceRecord),
+                                           MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    capacity = TRACE_RAM_RECORDS;
+  }
+#else
+  ring = (TraceRecord *)malloc(TRACE_RAM_RECORDS * sizeof(TraceRecord));
+  capacity = TRACE_RAM_RECORDS;
+#endif
+  if (ring == NULL) {
+    capacity = 0;
+    Serial.println("Trace: no memory for the ring, recorder disabled");
+    return;
+  }
+
+  state = TRACE_RUNNING;
+  Serial.printf("Trace: %lu records (%lu bytes) in %s\n", (unsigned long)capacity,
+                (unsigned long)(capacity * sizeof(TraceRecord)), ringInPsram ? "PSRAM" : "RAM");
+}
+
+void startTrace(TraceTrigger mode, uint32_t post) {
+  startPostMs = post;
+  startRequest = mode;
+}
+
+void stopTrace() {
+  stopRequest = true;
+}
+
+void triggerTrace() {
+  triggerRequest = true;
+}
+
+// ======= Recording =======
+static int16_t scaled(float value, float scale) {
+  float v = value * scale;
+  if (v > 32767.0) return 32767;
+  if (v < -32768.0) return -32768;
+  return (int16_t)lroundf(v);
+}
+
+static void applyRequests() {
+  int mode = startRequest.exchange(-1);
+  if (mode >= 0) {
+    startIndex = written.load(std::memory_order_relaxed);
+    trigger = mode;
+    postMs = startPostMs.load();
+    triggerMs = 0;
+    triggerRequest = false;
+    lastShotId = getShotStatus().id;
+    state = mode == TRACE_TRIGGER_NONE ? TRACE_RUNNING : TRACE_ARMED;
+  }
+  if (stopRequest.exchange(false)) {
+    state = TRACE_STOPPED;
+  }
+}
+
+static bool triggered(const ShotStatus &shot) {
+  bool manual = triggerRequest.exchange(false);
+  if (state != TRACE_ARMED) return false;
+  if (manual) return true;
+  if (trigger != TRACE_TRIGGER_SHOT) return false;
+
+  bool started = shot.phase != SHOT_IDLE && shot.id != lastShotId;
+  if (shot.phase != SHOT_IDLE) lastShotId = shot.id;
+  return started;
+}
+
+static void append(const TraceRecord &r) {
+  uint32_t n = written.load(std::memory_order_relaxed);
+  ring[n % capacity] = r;
+  written.store(n + 1, std::memory_order_release);
+}
+
+// Control task: keep the cycle's terms until the next sample writes them
+void noteTraceControl(const ControlSnapshot &control) {
+  if (ring == NULL) return;
+
+  TraceRecord r;
+  r.timeMs = control.timestampMs;
+  TraceControl &c = r.control;
+  c.kind = TRACE_KIND_CONTROL;
+  c.controlMode = (uint8_t)coffeeConfig.controlMode;
+  if (control.autotuning || coffeeConfig.controlMode == CONTROL_MODE_PID) {
+    c.pDeci = scaled(control.pid.p, 10.0);
+    c.iDeci = scaled(control.pid.i, 10.0);
+    c.dDeci = scaled(control.pid.d, 10.0);
+    c.outputDeci = scaled(control.pid.output, 10.0);
+  } else if (coffeeConfig.controlMode == CONTROL_MODE_SMITH) {
+    // No derivative: d carries the model's holding duty
+    c.pDeci = scaled(control.smith.p, 10.0);
+    c.iDeci = scaled(control.smith.i, 10.0);
+    c.dDeci = scaled(control.smith.hold, 10.0);
+    c.outputDeci = scaled(control.smith.output, 10.0);
+  } else {
+    c.pDeci = c.iDeci = c.dDeci = c.outputDeci = 0;
+  }
+  c.execUs = control.timing.execLastUs > 0xFFFF ? 0xFFFF : control.timing.execLastUs;
+
+  uint8_t flags = 0;
+  if (control.heatingElement) flags |= TRACE_FLAG_HEATING;
+  if (control.state.has(STATE_STEAM_MODE)) flags |= TRACE_FLAG_STEAM;
+  if (control.autotuning) flags |= TRACE_FLAG_AUTOTUNE;
+
+  portENTER_CRITICAL(&controlMux);
+  pendingControl = r;
+  controlPending = true;
+  targetCenti = scaled(control.targetTemp, 100.0);
+  controlFlags = flags;
+  portEXIT_CRITICAL(&controlMux);
+}
+
+void recordTraceSample(const TemperatureReading &reading) {
+  if (ring == NULL) return;
+  applyRequests();
+  ShotStatus shot = getShotStatus();
+  bool trig = triggered(shot);
+
+  portENTER_CRITICAL(&controlMux);
+  TraceRecord control = pendingControl;
+  bool haveControl = controlPending;
+  controlPending = false;
+  int16_t target = targetCenti;
+  uint8_t flags = controlFlags;
+  portEXIT_CRITICAL(&controlMux);
+
+  if (state == TRACE_STOPPED) return;
+  if (haveControl) append(control);
+
+  TraceRecord r;
+  r.timeMs = halMillis();
+  TraceSample &s = r.sample;
+  s.kind = TRACE_KIND_SAMPLE;
+  s.rawCenti = scaled(reading.raw, 100.0);
+  s.tempCenti = scaled(reading.celsius, 100.0);
+  s.slopeMilli = scaled(reading.derivative, 1000.0);
+  s.dutyCenti = (uint16_t)lroundf(constrain(getAppliedHeaterDuty(), 0.0f, 100.0f) * 100.0);
+  s.targetCenti = target;
+
+  if (getHeaterOutputState()) flags |= TRACE_FLAG_SSR;
+  if (shot.pumpDuty > 0.0) flags |= TRACE_FLAG_PUMP;
+  if (getGrindStatus().running) flags |= TRACE_FLAG_GRINDER;
+  if (!reading.valid) flags |= TRACE_FLAG_FAULT;
+  if (trig) {
+    flags |= TRACE_FLAG_TRIGGER;
+    triggerMs = r.timeMs;
+    state = TRACE_TRIGGERED;
+  }
+  s.flags = flags;
+  append(r);
+
+  if (state == TRACE_TRIGGERED && r.timeMs - triggerMs >= postMs) {
+    state = TRACE_STOPPED;
+    Serial.printf("Trace: capture complete (%lu records)\n",
+                  (unsigned long)getTraceStatus().records);
+  }
+}
+
+// ======= Status =======
+// The slot after the newest record is the next one the writer fills, so
+// the ring holds capacity - 1 readable records
+static uint32_t firstHeld(uint32_t end) {
+  uint32_t first = startIndex.load();
+  if (end - first >= capacity) first = end - capacity + 1;
+  return first;
+}
+
+TraceStatus getTraceStatus() {
+  TraceStatus status;
+  uint32_t end = written.load(std::memory_order_acquire);
+  status.state = (TraceState)state.load();
+  status.trigger = (TraceTrigger)trigger.load();
+  status.capacity = capacity;
+  status.written = end - startIndex.load();
+  status.records = capacity > 0 ? end - firstHeld(end) : 0;
+  status.postMs = postMs;
+  status.triggerMs = triggerMs;
+  status.psram = ringInPsram;
+  return status;
+}
+
+const char *traceStateName(TraceState s) {
+  switch (s) {
+    case TRACE_RUNNING:    return "running";
+    case TRACE_ARMED:      return "armed";
+    case TRACE_TRIGGERED:  return "triggered";
+    default:               return "stopped";
+  }
+}
+
+// ======= Dump =======
+TraceCursor openTrace(bool csv) {
+  TraceCursor cursor;
+  cursor.csv = csv;
+  if (capacity == 0) return cursor;
+  cursor.end = written.load(std::memory_order_acquire);
+  cursor.next = firstHeld(cursor.end);
+  return cursor;
+}
+
+// Copy record `index` out of the ring; false if the writer reused its slot
+// before or during the copy
+static bool copyRecord(uint32_t index, void *out) {
+  if (written.load(std::memory_order_acquire) - index >= capacity) return false;
+  memcpy(out, &ring[index % capacity], sizeof(TraceRecord));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return written.load(std::memory_order_relaxed) - index < capacity;
+}
+
+static void formatHeader(TraceCursor &cursor) {
+  if (cursor.csv) {
+    cursor.lineLength = snprintf(cursor.line, sizeof(cursor.line),
+                                 "time_ms,kind,raw_c,temp_c,target_c,slope_c_s,duty_pct,flags,"
+                                 "p,i,d,output,exec_us,mode\n");
+  } else {
+    TraceHeader header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.sampleMs = TEMP_SAMPLE_PERIOD_MS;
+    header.controlMs = getConfigSnapshot().tempUpdateInterval;  // Reader task
+    header.records = cursor.end - cursor.next;
+    memcpy(cursor.line, &header, sizeof(header));
+    cursor.lineLength = sizeof(header);
+  }
+  cursor.linePos = 0;
+}
+
+// Sample rows leave the controller columns empty and control rows the
+// sample columns
+static void formatCsv(TraceCursor &cursor, const TraceRecord &r) {
+  if (r.control.kind == TRACE_KIND_CONTROL) {
+    const TraceControl &c = r.control;
+    cursor.lineLength = snprintf(cursor.line, sizeof(cursor.line),
+                                 "%lu,control,,,,,,,%.1f,%.1f,%.1f,%.1f,%u,%u\n",
+                                 (unsigned long)r.timeMs, c.pDeci / 10.0, c.iDeci / 10.0,
+                                 c.dDeci / 10.0, c.outputDeci / 10.0, (unsigned)c.execUs,
+                                 (unsigned)c.controlMode);
+  } else {
+    const TraceSample &s = r.sample;
+    cursor.lineLength = snprintf(cursor.line, sizeof(cursor.line),
+                                 "%lu,sample,%.2f,%.2f,%.2f,%.3f,%.2f,%u,,,,,,\n",
+                                 (unsigned long)r.timeMs, s.rawCenti / 100.0, s.tempCenti / 100.0,
+                                 s.targetCenti / 100.0, s.slopeMilli / 1000.0, s.dutyCenti / 100.0,
+                                 (unsigned)s.flags);
+  }
+  cursor.linePos = 0;
+}
+
+size_t readTrace(TraceCursor &cursor, uint8_t *buffer, size_t maxLen) {
+  size_t length = 0;
+  while (length < maxLen) {
+    // Finish a header or line that did not fit last time
+    if (cursor.linePos < cursor.lineLength) {
+      size_t n = cursor.lineLength - cursor.linePos;
+      if (n > maxLen - length) n = maxLen - length;
+      memcpy(buffer + length, cursor.line + cursor.linePos, n);
+      cursor.linePos += n;
+      length += n;
+      continue;
+    }
+    if (!cursor.started) {
+      cursor.started = true;
+      formatHeader(cursor);
+      continue;
+    }
+    if (cursor.next >= cursor.end) break;
+
+    // Records overwritten since the dump was opened are skipped
+    uint32_t oldest = written.load(std::memory_order_acquire) - capacity + 1;
+    if ((int32_t)(cursor.next - oldest) < 0) cursor.next = oldest;
+    if (cursor.next >= cursor.end) break;
+
+    if (!cursor.csv && maxLen - length >= sizeof(TraceRecord)) {
+      // Straight from the ring into the response buffer
+      if (copyRecord(cursor.next, buffer + length)) {
+        length += sizeof(TraceRecord);
+      }
+      cursor.next++;
+      continue;
+    }
+
+    TraceRecord record;
+    bool valid = copyRecord(cursor.next, &record);
+    cursor.next++;
+    if (!valid) continue;
+    if (cursor.csv) {
+      formatCsv(cursor, record);
+    } else {
+      memcpy(cursor.line, &record, sizeof(record));
+      cursor.lineLength = sizeof(record);
+      cursor.linePos = 0;
+    }
+  }
+  return length;
+}
@@ -0,0 +1,149 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "control_task.h"
+#include "temperature.h"
+
+// ======= Trace Recorder Settings =======
+// Fixed-size ring of compact records written by the acquisition task: one
+// sample record per thermocouple sample (TEMP_SAMPLE_PERIOD_MS), and after
+// each control cycle one control record with the controller terms, written
+// ahead of the next sample. Recording runs continuously from boot; a
+// capture can be armed to freeze the ring TRACE_POST_MS after a trigger
+// (shot start or manual), so the ring holds the minutes before the event
+// and the seconds after it.
+#define TRACE_PSRAM_RECORDS   65536    // 1 MB, ~100 min at 10 Hz, if the board has PSRAM
+#define TRACE_RAM_RECORDS     2048     // 32 KB internal RAM, ~3 min at 10 Hz
+#define TRACE_POST_MS         15000    // Default recording after a trigger
+#define TRACE_POST_MAX_MS     600000
+#define TRACE_MAGIC           0x31435254  // "TRC1"
+#define TRACE_VERSION         2
+#define TRACE_CSV_LINE_MAX    128
+
+// Record kinds (last byte of every record)
+#define TRACE_KIND_SAMPLE     0
+#define TRACE_KIND_CONTROL    1
+
+// Sample flags
+#define TRACE_FLAG_SSR        0x01     // SSR pin on at the sample
+#define TRACE_FLAG_HEATING    0x02     // Heating requested
+#define TRACE_FLAG_PUMP       0x04
+#define TRACE_FLAG_GRINDER    0x08
+#define TRACE_FLAG_STEAM      0x10
+#define TRACE_FLAG_FAULT      0x20     // Sensor fault
+#define TRACE_FLAG_AUTOTUNE   0x40
+#define TRACE_FLAG_TRIGGER    0x80     // The capture was triggered here
+
+// One acquisition sample. Setpoint and heating/steam/autotune flags are
+// those of the latest control cycle.
+struct TraceSample {
+  int16_t rawCenti;         // Unfiltered thermocouple x100
+  int16_t tempCenti;        // Filtered temperature x100
+  int16_t slopeMilli;       // Filtered derivative in m°C/s
+  uint16_t dutyCenti;       // Applied heater duty incl. feed-forward x100
+  int16_t targetCenti;      // Setpoint x100
+  uint8_t flags;            // TRACE_FLAG_*
+  uint8_t kind;             // TRACE_KIND_SAMPLE
+};
+
+// One control cycle. Terms are in the active mode's output units: 0-255
+// for PID, % for the Smith predictor, zero for on/off. The period is the
+// difference of successive control record times.
+struct TraceControl {
+  int16_t pDeci;            // Controller terms x10
+  int16_t iDeci;
+  int16_t dDeci;
+  int16_t outputDeci;       // Controller output x10
+  uint16_t execUs;          // Control cycle execution time (saturates)
+  uint8_t controlMode;      // CONTROL_MODE_*
+  uint8_t kind;             // TRACE_KIND_CONTROL
+};
+
+// 16 bytes, little-endian, no padding. The kind byte is the last byte of
+// both layouts.
+struct TraceRecord {
+  uint32_t timeMs;          // halMillis() of the sample / end of the cycle
+  union {
+    TraceSample sample;
+    TraceControl control;
+  };
+};
+
+// Start of a binary dump; records follow until the end of the stream
+struct TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint16_t sampleMs;        // Acquisition period
+  uint16_t controlMs;       // Control period at the time of the dump
+  uint32_t records;         // Records in the dump (fewer if overwritten while sent)
+};
+
+enum TraceState {
+  TRACE_STOPPED = 0,        // Frozen (stopped, or a triggered capture finished)
+  TRACE_RUNNING,            // Continuous ring
+  TRACE_ARMED,              // Running, waiting for the trigger
+  TRACE_TRIGGERED           // Running for the post-trigger time
+};
+
+enum TraceTrigger {
+  TRACE_TRIGGER_NONE = 0,   // Continuous
+  TRACE_TRIGGER_SHOT,       // Next shot start
+  TRACE_TRIGGER_MANUAL      // triggerTrace()
+};
+
+struct TraceStatus {
+  TraceState state = TRACE_STOPPED;
+  TraceTrigger trigger = TRACE_TRIGGER_NONE;
+  uint32_t capacity = 0;
+  uint32_t records = 0;     // Held in the ring
+  uint32_t written = 0;     // Since the last start
+  uint32_t postMs = 0;
+  uint32_t triggerMs = 0;   // halMillis() of the trigger (0 = none)
+  bool psram = false;
+};
+
+// Read position of one dump. Copy it into the response filler; several
+// dumps can run at once.
+struct TraceCursor {
+  uint32_t next = 0;        // Record index
+  uint32_t end = 0;
+  bool csv = false;
+  bool started = false;     // Header produced
+  char line[TRACE_CSV_LINE_MAX];   // Header or CSV line not yet sent
+  uint16_t lineLength = 0;
+  uint16_t linePos = 0;
+};
+
+// External dependencies
+extern CoffeeConfig coffeeConfig;
+extern SystemState systemState;
+
+// Allocate the ring (PSRAM if available) and start recording
+void initTraceRecorder();
+
+// Acquisition task only: append the sample just published (and the
+// terms of a control cycle that ran since the previous one)
+void recordTraceSample(const TemperatureReading &reading);
+
+// Control task: hand the cycle just published to the recorder
+void noteTraceControl(const ControlSnapshot &control);
+
+// Requests from any task, applied at the next sample. Start clears
+// the ring; with a trigger it freezes postMs after it.
+void startTrace(TraceTrigger trigger, uint32_t postMs);
+void stopTrace();
+void triggerTrace();
+
+TraceStatus getTraceStatus();
+const char *traceStateName(TraceState state);
+
+// Dump the records held right now, as binary (TraceHeader + records) or CSV.
+// readTrace() fills up to maxLen bytes and returns 0 at the end; records are
+// copied from the ring straight into the buffer.
+TraceCursor openTrace(bool csv);
+size_t readTrace(TraceCursor &cursor, uint8_t *buffer, size_t maxLen);
+
+#endif // TRACE_RECORDER_H
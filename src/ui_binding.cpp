@@ -0,0 +1,90 @@
+#include "ui_binding.h"
+#include <Arduino.h>
+
+// ============================================================================
+// BINDING STATISTICS
+// ============================================================================
+static UiBindingStats stats;
+static uint32_t windowStartMs = 0;
+static uint32_t windowSavedPixels = 0;
+
+static void recordSkip(lv_obj_t *label) {
+    // What lv_label_set_text() would have invalidated
+    uint32_t pixels = (uint32_t)lv_obj_get_width(label) * (uint32_t)lv_obj_get_height(label);
+    stats.skips++;
+    stats.savedPixels += pixels;
+    windowSavedPixels += pixels;
+}
+
+void uiBindingTick() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - windowStartMs;
+    if (elapsed >= 1000) {
+        stats.savedPixelsPerSec = (uint32_t)((uint64_t)windowSavedPixels * 1000 / elapsed);
+        windowSavedPixels = 0;
+        windowStartMs = now;
+    }
+}
+
+UiBindingStats getUiBindingStats() {
+    return stats;
+}
+
+// ============================================================================
+// BINDINGS
+// ============================================================================
+void uiBindNumber(UiNumberBinding &binding, lv_obj_t *label, const char *format,
+                  float resolution, uint32_t minIntervalMs) {
+    binding.label = label;
+    binding.format = format;
+    binding.resolution = resolution > 0.0 ? resolution : 1.0;
+    binding.minIntervalMs = minIntervalMs;
+    binding.rendered = false;
+}
+
+void uiBindText(UiTextBinding &binding, lv_obj_t *label, uint32_t minIntervalMs) {
+    binding.label = label;
+    binding.minIntervalMs = minIntervalMs;
+    binding.rendered = false;
+}
+
+bool uiSetNumber(UiNumberBinding &binding, float value) {
+    if (!binding.label) return false;
+
+    uint32_t now = millis();
+    int32_t step = (int32_t)lroundf(value / binding.resolution);
+    if (binding.rendered &&
+        (step == binding.lastStep || now - binding.lastUpdateMs < binding.minIntervalMs)) {
+        recordSkip(binding.label);
+        return false;
+    }
+
+    char text[UI_TEXT_MAX];
+    snprintf(text, sizeof(text), binding.format, step * binding.resolution);
+    lv_label_set_text(binding.label, text);
+    binding.lastStep = step;
+    binding.lastUpdateMs = now;
+    binding.rendered = true;
+    stats.updates++;
+    return true;
+}
+
+bool uiSetText(UiTextBinding &binding, const char *text) {
+    if (!binding.label) return false;
+
+    uint32_t now = millis();
+    if (binding.rendered &&
+        (strncmp(text, binding.last, sizeof(binding.last) - 1) == 0 ||
+         now - binding.lastUpdateMs < binding.minIntervalMs)) {
+        recordSkip(binding.label);
+        return false;
+    }
+
+    strncpy(binding.last, text, sizeof(binding.last) - 1);
+    binding.last[sizeof(binding.last) - 1] = '\0';
+    lv_label_set_text(binding.label, binding.last);
+    binding.lastUpdateMs = now;
+    binding.rendered = true;
+    stats.updates++;
+    return true;
+}
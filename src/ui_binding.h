@@ -0,0 +1,53 @@
+#ifndef UI_BINDING_H
+#define UI_BINDING_H
+
+#include <lvgl.h>
+
+// ============================================================================
+// UI BINDINGS
+// ============================================================================
+// A binding remembers what its label last showed. The label is only
+// re-rendered (and so invalidated and redrawn) when the value really changed:
+// numbers by at least one `resolution` step, text by content. Updates are
+// also rate limited to one per `minIntervalMs`; a change arriving inside the
+// interval is applied on the first call after it.
+#define UI_TEXT_MAX  48
+
+struct UiNumberBinding {
+    lv_obj_t *label = NULL;
+    const char *format = "%.1f";  // printf format taking one float
+    float resolution = 0.1;
+    uint32_t minIntervalMs = 0;
+    int32_t lastStep = 0;         // Last rendered value in resolution steps
+    uint32_t lastUpdateMs = 0;
+    bool rendered = false;
+};
+
+struct UiTextBinding {
+    lv_obj_t *label = NULL;
+    uint32_t minIntervalMs = 0;
+    char last[UI_TEXT_MAX] = "";
+    uint32_t lastUpdateMs = 0;
+    bool rendered = false;
+};
+
+struct UiBindingStats {
+    uint32_t updates = 0;            // Label renders
+    uint32_t skips = 0;              // Calls that left the label untouched
+    uint64_t savedPixels = 0;        // Label area not invalidated by skips
+    uint32_t savedPixelsPerSec = 0;  // Over the last full second
+};
+
+void uiBindNumber(UiNumberBinding &binding, lv_obj_t *label, const char *format,
+                  float resolution, uint32_t minIntervalMs);
+void uiBindText(UiTextBinding &binding, lv_obj_t *label, uint32_t minIntervalMs);
+
+// Returns true if the label was re-rendered
+bool uiSetNumber(UiNumberBinding &binding, float value);
+bool uiSetText(UiTextBinding &binding, const char *text);
+
+// Roll the per-second counters (call once per display update)
+void uiBindingTick();
+UiBindingStats getUiBindingStats();
+
+#endif // UI_BINDING_H
@@ -57,6 +57,26 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 <div><label>Medium:</label><br><input type="number" id="shot1" step="0.5" min="5" max="60"></div>
                 <div><label>Large:</label><br><input type="number" id="shot2" step="0.5" min="5" max="60"></div>
                 <div><label>Extra Large:</label><br><input type="number" id="shot3" step="0.5" min="5" max="60"></div>
+                <div><label>Pre-infusion (ms):</label><br><input type="number" id="shotPreinfusionMs" step="500" min="0" max="15000"></div>
+                <div><label>Pre-infusion Pump (%):</label><br><input type="number" id="shotPreinfusionDuty" step="5" min="0" max="100"></div>
+                <div><label>Ramp to Full (ms):</label><br><input type="number" id="shotRampMs" step="500" min="0" max="10000"></div>
+            </div>
+            <div style="margin-top: 15px;">
+                <label><b>Heater Boost During Shots:</b></label><br>
+                <input type="checkbox" id="ffEnable"> Boost heater while the pump runs
+                <input type="checkbox" id="ffLearn" style="margin-left: 15px;"> Learn boost from each shot's droop
+            </div>
+            <div class="grid">
+                <div><label>Small Boost (%):</label><br><input type="number" id="ffBoost0" step="1" min="0" max="100"></div>
+                <div><label>Medium Boost (%):</label><br><input type="number" id="ffBoost1" step="1" min="0" max="100"></div>
+                <div><label>Large Boost (%):</label><br><input type="number" id="ffBoost2" step="1" min="0" max="100"></div>
+                <div><label>XL Boost (%):</label><br><input type="number" id="ffBoost3" step="1" min="0" max="100"></div>
+                <div><label>Boost Fade-out (ms):</label><br><input type="number" id="ffTailMs" step="500" min="0" max="20000"></div>
+            </div>
+            <div style="margin-top: 15px;">
+                <button onclick="startShot()">Start Shot</button>
+                <button onclick="stopShot()" style="background-color:#c00;">Stop Shot</button>
+                <span id="shotStatus" style="margin-left: 10px; font-weight: bold;"></span>
             </div>
         </div>
         
@@ -72,29 +92,97 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     <input type="number" id="grind1" step="0.5" min="5" max="30">
                 </div>
             </div>
+            <div style="margin-top: 15px;">
+                <label><b>Grind Mode:</b></label><br>
+                <select id="grindMode">
+                    <option value="0">Timed (seconds above)</option>
+                    <option value="1">Dose (grams, from learned rate)</option>
+                </select>
+            </div>
+            <div class="grid">
+                <div><label>Single Dose (g):</label><br><input type="number" id="grindDose0" step="0.1" min="1" max="40"></div>
+                <div><label>Double Dose (g):</label><br><input type="number" id="grindDose1" step="0.1" min="1" max="40"></div>
+                <div><label>Single Rate (g/s):</label><br><span id="grindRate0">-</span></div>
+                <div><label>Double Rate (g/s):</label><br><span id="grindRate1">-</span></div>
+            </div>
+            <div style="margin-top: 15px;">
+                <button onclick="startGrind(0)">Grind Single</button>
+                <button onclick="startGrind(1)">Grind Double</button>
+                <button onclick="stopGrind()" style="background-color:#c00;">Stop</button>
+            </div>
+            <div style="margin-top: 15px;">
+                <label>Weighed dose of last grind (g):</label>
+                <input type="number" id="weighedDose" step="0.1" min="0.1" max="100" style="width: 80px;">
+                <button onclick="recordDose()">Learn Rate</button>
+                <span id="grindStatus" style="margin-left: 10px; font-weight: bold;"></span>
+            </div>
         </div>
         
         <div class="section config">
             <h2>PID Control Parameters</h2>
             <div style="margin-bottom: 15px;">
                 <label><b>Control Mode:</b></label><br>
-                <input type="checkbox" id="usePID"> Use PID Control (unchecked = simple on/off control)
+                <select id="controlMode">
+                    <option value="0">On/off (hysteresis)</option>
+                    <option value="1">PID</option>
+                    <option value="2">Smith predictor (boiler model)</option>
+                </select>
             </div>
             <div class="grid">
                 <div>
                     <label>Proportional (Kp):</label><br>
-                    <input type="number" id="pidKp" step="0.1" min="0" max="20">
+                    <input type="number" id="pidKp" step="0.1" min="0" max="100">
                 </div>
                 <div>
                     <label>Integral (Ki):</label><br>
-                    <input type="number" id="pidKi" step="0.1" min="0" max="20">
+                    <input type="number" id="pidKi" step="0.01" min="0" max="100">
                 </div>
                 <div>
                     <label>Derivative (Kd):</label><br>
-                    <input type="number" id="pidKd" step="0.1" min="0" max="10">
+                    <input type="number" id="pidKd" step="1" min="0" max="500">
+                </div>
+                <div>
+                    <label>Steam Kp:</label><br>
+                    <input type="number" id="steamKp" step="0.1" min="0" max="100">
+                </div>
+                <div>
+                    <label>Steam Ki:</label><br>
+                    <input type="number" id="steamKi" step="0.01" min="0" max="100">
+                </div>
+                <div>
+                    <label>Steam Kd:</label><br>
+                    <input type="number" id="steamKd" step="1" min="0" max="500">
+                </div>
+                <div>
+                    <label>SSR Window (ms):</label><br>
+                    <input type="number" id="ssrWindow" step="100" min="500" max="5000">
+                </div>
+                <div>
+                    <label>SSR Min On/Off (ms):</label><br>
+                    <input type="number" id="ssrMinSwitch" step="10" min="0" max="200">
+                </div>
+                <div>
+                    <label>Model Gain (°C per %):</label><br>
+                    <input type="number" id="modelGain" step="0.1" min="0.5" max="100">
+                </div>
+                <div>
+                    <label>Model Time Constant (s):</label><br>
+                    <input type="number" id="modelTauS" step="10" min="10" max="20000">
+                </div>
+                <div>
+                    <label>Model Dead Time (s):</label><br>
+                    <input type="number" id="modelDeadTimeS" step="0.5" min="0" max="250">
+                </div>
+                <div>
+                    <label>Smith Lambda (s, 0 = tau):</label><br>
+                    <input type="number" id="smithLambdaS" step="5" min="0" max="3600">
                 </div>
             </div>
             <div style="margin-top: 15px;">
+                <select id="autotuneMethod">
+                    <option value="relay">Relay (around setpoint)</option>
+                    <option value="step">Step response</option>
+                </select>
                 <button onclick="startAutotune()" id="autotuneBtn">Start PID AutoTune</button>
                 <button onclick="stopAutotune()" id="stopAutotuneBtn" style="display:none; background-color:#c00;">Stop AutoTune</button>
                 <span id="autotuneStatus" style="margin-left: 10px; font-weight: bold;"></span>
@@ -104,8 +192,31 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
         <div class="section config">
             <h2>System Settings</h2>
             <label><input type="checkbox" id="enableInflux"> Enable InfluxDB Logging</label><br>
+            <label><input type="checkbox" id="spoolFlash"> Keep offline telemetry in flash (applies after reboot)</label><br>
+            <label><input type="checkbox" id="healthRestart"> Restart when memory runs low (only while idle)</label><br>
             <label>Temperature Update Interval (ms):</label>
-            <input type="number" id="tempInterval" step="100" min="500" max="5000">
+            <input type="number" id="tempInterval" step="100" min="200" max="5000"><br>
+            <label>Live Update Interval (ms):</label>
+            <input type="number" id="eventInterval" step="50" min="100" max="5000"><br>
+            <label>Temperature Filter:</label>
+            <select id="tempFilterMode">
+                <option value="0">Median + EMA</option>
+                <option value="1">Median + Kalman</option>
+            </select>
+            <label>Median of:</label>
+            <input type="number" id="tempMedianSize" step="2" min="1" max="9"><br>
+            <label>EMA Alpha:</label>
+            <input type="number" id="tempFilterAlpha" step="0.05" min="0.01" max="1">
+            <label>Kalman Q:</label>
+            <input type="number" id="tempKalmanQ" step="0.005" min="0.0001" max="10">
+            <div style="margin-top: 15px;">
+                <label><b>Control Trace:</b></label><br>
+                <button onclick="startTrace('none')">Record</button>
+                <button onclick="startTrace('shot')">Capture Next Shot</button>
+                <button onclick="traceCommand('stop')">Stop</button>
+                <a href="/api/trace">Download</a> | <a href="/api/trace?format=csv">CSV</a>
+                <span id="traceStatus" style="margin-left: 10px; font-weight: bold;"></span>
+            </div>
         </div>
         
         <div style="text-align: center; margin-top: 20px;">
@@ -115,20 +226,47 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
     </div>
     
     <script>
+        // Latest status; /api/events pushes only the fields that changed
+        const state = {};
+        
+        function renderStatus() {
+            document.getElementById('status').innerHTML = `
+                Temperature: ${Number(state.currentTemp).toFixed(1)}&deg;C (Target: ${Number(state.targetTemp).toFixed(1)}&deg;C)<br>
+                Operation: ${state.currentOperation}<br>
+                Heating: ${state.heatingElement ? 'ON' : 'OFF'} (${Number(state.heaterDuty).toFixed(0)}%) | 
+                Pump: ${state.pump ? 'ON' : 'OFF'} | 
+                Grinder: ${state.grinder ? 'ON' : 'OFF'}
+            `;
+        }
+        
         function updateStatus() {
             fetch('/api/status')
                 .then(response => response.json())
                 .then(data => {
-                    document.getElementById('status').innerHTML = `
-                        Temperature: ${data.currentTemp}&deg;C (Target: ${data.targetTemp}&deg;C)<br>
-                        Operation: ${data.currentOperation}<br>
-                        Heating: ${data.heatingElement ? 'ON' : 'OFF'} | 
-                        Pump: ${data.pump ? 'ON' : 'OFF'} | 
-                        Grinder: ${data.grinder ? 'ON' : 'OFF'}
-                    `;
+                    Object.assign(state, data);
+                    renderStatus();
                 });
         }
         
+        function connectEvents() {
+            if (!window.EventSource) {
+                // Very old browsers: fall back to polling
+                setInterval(updateStatus, 2000);
+                setInterval(updateAutotuneStatus, 2000);
+                return;
+            }
+            const source = new EventSource('/api/events');
+            source.addEventListener('status', e => {
+                const delta = JSON.parse(e.data);
+                const autotuneChanged = ('autotune' in delta) && delta.autotune !== state.autotune;
+                Object.assign(state, delta);
+                renderStatus();
+                if (autotuneChanged) {
+                    updateAutotuneStatus();
+                }
+            });
+        }
+        
         function loadConfig() {
             fetch('/api/config')
                 .then(response => response.json())
@@ -144,9 +282,41 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                     document.getElementById('pidKp').value = config.pidKp;
                     document.getElementById('pidKi').value = config.pidKi;
                     document.getElementById('pidKd').value = config.pidKd;
-                    document.getElementById('usePID').checked = config.usePID;
+                    document.getElementById('steamKp').value = config.steamKp;
+                    document.getElementById('steamKi').value = config.steamKi;
+                    document.getElementById('steamKd').value = config.steamKd;
+                    document.getElementById('controlMode').value = config.controlMode;
+                    document.getElementById('modelGain').value = Number(config.modelGain).toFixed(2);
+                    document.getElementById('modelTauS').value = Math.round(config.modelTauS);
+                    document.getElementById('modelDeadTimeS').value = Number(config.modelDeadTimeS).toFixed(1);
+                    document.getElementById('smithLambdaS').value = config.smithLambdaS;
+                    document.getElementById('ssrWindow').value = config.ssrWindowMs;
+                    document.getElementById('ssrMinSwitch').value = config.ssrMinSwitchMs;
                     document.getElementById('enableInflux').checked = config.enableInfluxDB;
+                    document.getElementById('spoolFlash').checked = config.telemetrySpoolFlash;
+                    document.getElementById('healthRestart').checked = config.healthRestart;
                     document.getElementById('tempInterval').value = config.tempUpdateInterval;
+                    document.getElementById('eventInterval').value = config.eventIntervalMs;
+                    document.getElementById('tempFilterMode').value = config.tempFilterMode;
+                    document.getElementById('tempMedianSize').value = config.tempMedianSize;
+                    document.getElementById('tempFilterAlpha').value = config.tempFilterAlpha;
+                    document.getElementById('tempKalmanQ').value = config.tempKalmanQ;
+                    document.getElementById('shotPreinfusionMs').value = config.shotPreinfusionMs;
+                    document.getElementById('shotPreinfusionDuty').value = config.shotPreinfusionDuty;
+                    document.getElementById('shotRampMs').value = config.shotRampMs;
+                    document.getElementById('ffEnable').checked = config.ffEnable;
+                    document.getElementById('ffLearn').checked = config.ffLearn;
+                    for(let i = 0; i < 4; i++) {
+                        document.getElementById('ffBoost' + i).value = Number(config.ffBoostPct[i]).toFixed(1);
+                    }
+                    document.getElementById('ffTailMs').value = config.ffTailMs;
+                    document.getElementById('grindMode').value = config.grindMode;
+                    for(let i = 0; i < 2; i++) {
+                        document.getElementById('grindDose' + i).value = config.grindDoses[i];
+                        document.getElementById('grindRate' + i).innerHTML = config.grindRates[i] > 0
+                            ? `${config.grindRates[i].toFixed(2)} (${(config.grindPlannedMs[i] / 1000).toFixed(2)} s)`
+                            : 'not learned';
+                    }
                 });
         }
         
@@ -159,16 +329,43 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 pidKp: parseFloat(document.getElementById('pidKp').value),
                 pidKi: parseFloat(document.getElementById('pidKi').value),
                 pidKd: parseFloat(document.getElementById('pidKd').value),
-                usePID: document.getElementById('usePID').checked,
+                steamKp: parseFloat(document.getElementById('steamKp').value),
+                steamKi: parseFloat(document.getElementById('steamKi').value),
+                steamKd: parseFloat(document.getElementById('steamKd').value),
+                controlMode: parseInt(document.getElementById('controlMode').value),
+                modelGain: parseFloat(document.getElementById('modelGain').value),
+                modelTauS: parseFloat(document.getElementById('modelTauS').value),
+                modelDeadTimeS: parseFloat(document.getElementById('modelDeadTimeS').value),
+                smithLambdaS: parseFloat(document.getElementById('smithLambdaS').value),
+                ssrWindowMs: parseInt(document.getElementById('ssrWindow').value),
+                ssrMinSwitchMs: parseInt(document.getElementById('ssrMinSwitch').value),
                 enableInfluxDB: document.getElementById('enableInflux').checked,
-                tempUpdateInterval: parseInt(document.getElementById('tempInterval').value)
+                telemetrySpoolFlash: document.getElementById('spoolFlash').checked,
+                healthRestart: document.getElementById('healthRestart').checked,
+                tempUpdateInterval: parseInt(document.getElementById('tempInterval').value),
+                eventIntervalMs: parseInt(document.getElementById('eventInterval').value),
+                tempFilterMode: parseInt(document.getElementById('tempFilterMode').value),
+                tempMedianSize: parseInt(document.getElementById('tempMedianSize').value),
+                tempFilterAlpha: parseFloat(document.getElementById('tempFilterAlpha').value),
+                tempKalmanQ: parseFloat(document.getElementById('tempKalmanQ').value),
+                shotPreinfusionMs: parseInt(document.getElementById('shotPreinfusionMs').value),
+                shotPreinfusionDuty: parseInt(document.getElementById('shotPreinfusionDuty').value),
+                shotRampMs: parseInt(document.getElementById('shotRampMs').value),
+                grindMode: parseInt(document.getElementById('grindMode').value),
+                grindDoses: [],
+                ffEnable: document.getElementById('ffEnable').checked,
+                ffLearn: document.getElementById('ffLearn').checked,
+                ffBoostPct: [],
+                ffTailMs: parseInt(document.getElementById('ffTailMs').value)
             };
             
             for(let i = 0; i < 4; i++) {
                 config.shotSizes[i] = parseFloat(document.getElementById('shot' + i).value);
+                config.ffBoostPct[i] = parseFloat(document.getElementById('ffBoost' + i).value);
             }
             for(let i = 0; i < 2; i++) {
                 config.grindTimes[i] = parseFloat(document.getElementById('grind' + i).value);
+                config.grindDoses[i] = parseFloat(document.getElementById('grindDose' + i).value);
             }
             
             fetch('/api/config', {
@@ -176,8 +373,16 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 headers: {'Content-Type': 'application/json'},
                 body: JSON.stringify(config)
             })
-            .then(response => response.text())
-            .then(data => alert(data));
+            .then(response => response.json())
+            .then(result => {
+                if (result.ok) {
+                    alert(result.changed.length ? 'Configuration saved: ' + result.changed.join(', ')
+                                                : 'No changes');
+                } else {
+                    alert('Configuration rejected:\n' +
+                          result.errors.map(e => `${e.field}: ${e.error}`).join('\n'));
+                }
+            });
         }
         
         function toggleHeating() {
@@ -207,9 +412,56 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             });
         }
         
+        function startShot() {
+            fetch('/api/shot/start', {method: 'POST'})
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('shotStatus').innerHTML = data;
+                updateStatus();
+            });
+        }
+        
+        function stopShot() {
+            fetch('/api/shot/stop', {method: 'POST'})
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('shotStatus').innerHTML = data;
+                updateStatus();
+            });
+        }
+        
+        function startGrind(preset) {
+            fetch('/api/grind/start', {method: 'POST', body: new URLSearchParams({preset: preset})})
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('grindStatus').innerHTML = data;
+                updateStatus();
+            });
+        }
+        
+        function stopGrind() {
+            fetch('/api/grind/stop', {method: 'POST'})
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('grindStatus').innerHTML = data;
+                updateStatus();
+            });
+        }
+        
+        function recordDose() {
+            const grams = document.getElementById('weighedDose').value;
+            fetch('/api/grind/dose', {method: 'POST', body: new URLSearchParams({grams: grams})})
+            .then(response => response.text())
+            .then(data => {
+                document.getElementById('grindStatus').innerHTML = data;
+                loadConfig();
+            });
+        }
+        
         function startAutotune() {
             if (confirm('AutoTune will take several minutes and will cycle the heating element. Continue?')) {
-                fetch('/api/autotune/start', {method: 'POST'})
+                const method = document.getElementById('autotuneMethod').value;
+                fetch('/api/autotune/start', {method: 'POST', body: new URLSearchParams({method: method})})
                 .then(response => response.text())
                 .then(data => {
                     alert(data);
@@ -227,7 +479,13 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             });
         }
         
+        // Progress is not part of the status events: poll it while a run is
+        // active (the 'autotune' event flag starts and ends the polling)
+        let autotuneTimer = null;
+        
         function updateAutotuneStatus() {
+            clearTimeout(autotuneTimer);
+            autotuneTimer = null;
             fetch('/api/autotune/status')
             .then(response => response.json())
             .then(data => {
@@ -236,12 +494,18 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
                 const stopBtn = document.getElementById('stopAutotuneBtn');
                 
                 if (data.running) {
-                    statusSpan.innerHTML = `Running... (${data.elapsed}s / ${data.timeout}s)`;
+                    let text = `${data.phase}`;
+                    if (data.phase === 'relay') text += ` cycle ${data.cycles}/${data.cyclesNeeded}`;
+                    text += `, ${Math.round(data.elapsedMs / 1000)}s`;
+                    if (data.remainingMs >= 0) text += ` (~${Math.ceil(data.remainingMs / 60000)} min left)`;
+                    statusSpan.innerHTML = text;
                     statusSpan.style.color = '#ff6600';
                     startBtn.style.display = 'none';
                     stopBtn.style.display = 'inline-block';
+                    autotuneTimer = setTimeout(updateAutotuneStatus, 2000);
                 } else {
-                    statusSpan.innerHTML = '';
+                    statusSpan.innerHTML = data.result === 'none' ? '' : `Last run ${data.result}: ${data.message}`;
+                    statusSpan.style.color = data.result === 'saved' ? '#080' : '#c00';
                     startBtn.style.display = 'inline-block';
                     stopBtn.style.display = 'none';
                     
@@ -251,13 +515,34 @@ const char HTML_PAGE[] PROGMEM = R"rawliteral(
             });
         }
         
-        // Update status every 2 seconds
-        setInterval(updateStatus, 2000);
-        setInterval(updateAutotuneStatus, 2000);
+        function startTrace(trigger) {
+            fetch('/api/trace/start', {method: 'POST', body: new URLSearchParams({trigger: trigger})})
+            .then(() => updateTraceStatus());
+        }
+        
+        function traceCommand(command) {
+            fetch('/api/trace/' + command, {method: 'POST'})
+            .then(() => updateTraceStatus());
+        }
+        
+        function updateTraceStatus() {
+            fetch('/api/trace/status')
+            .then(response => response.json())
+            .then(data => {
+                document.getElementById('traceStatus').innerHTML =
+                    `${data.state}, ${data.records}/${data.capacity} records (${Math.round(data.records * data.sampleMs / 1000)} s)`;
+            });
+        }
+        
+        // Status is pushed by the device (Server-Sent Events)
+        connectEvents();
         
         // Load initial config
         loadConfig();
         updateStatus();
+        updateAutotuneStatus();
+        updateTraceStatus();
+        setInterval(updateTraceStatus, 10000);
     </script>
 </body>
 </html>
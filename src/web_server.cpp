@@ -1,23 +1,617 @@
 #include "web_server.h"
 #include "web_pages.h"
+#include "control_task.h"
+#include "heater_output.h"
+#include "telemetry.h"
+#include "telemetry_spool.h"
+#include "display.h"
+#include "shot_engine.h"
+#include "grinder.h"
+#include "feed_forward.h"
+#include "trace_recorder.h"
+#include "shared_state.h"
+#include "health_monitor.h"
+#include "profiler.h"
+#include "status_event.h"
+
+// ======= Server-Sent Events =======
+// Status is pushed on /api/events: a full object on connect and every
+// EVENT_KEYFRAME_MS, otherwise only the fields that changed, at most once
+// per eventIntervalMs. Each event is serialized once and fanned out to all
+// clients by AsyncEventSource.
+static AsyncEventSource events("/api/events");
+
+static StreamedStatus lastSent;
+static bool lastSentValid = false;
+static unsigned long lastEventMs = 0;
+static unsigned long lastKeyframeMs = 0;
+static char eventBuffer[EVENT_BUFFER_SIZE];
+
+void updateEventStream() {
+  unsigned long now = millis();
+  if (now - lastEventMs < (unsigned long)getConfigSnapshot().eventIntervalMs) {
+    return;
+  }
+  if (events.count() == 0) {
+    lastSentValid = false;
+    return;
+  }
+
+  StreamedStatus current;
+  captureStatus(current);
+
+  bool keyframe = !lastSentValid || now - lastKeyframeMs >= EVENT_KEYFRAME_MS;
+  size_t len = formatStatusEvent(eventBuffer, sizeof(eventBuffer), current,
+                                 keyframe ? NULL : &lastSent);
+  if (len == 0) {
+    return;
+  }
+
+  events.send(eventBuffer, "status", now);
+  lastSent = current;
+  lastSentValid = true;
+  lastEventMs = now;
+  if (keyframe) {
+    lastKeyframeMs = now;
+  }
+}
+
+// ======= Configuration Updates =======
+// POST /api/config bodies are collected into one preallocated buffer (the
+// body callback fires once per TCP segment) and parsed only when complete.
+// Every field is range-checked into a copy of the configuration, and the
+// copy replaces the live one only if nothing was rejected.
+static char configBody[CONFIG_BODY_MAX];
+static size_t configBodyLength = 0;
+static bool configBodyOverflow = false;
+static AsyncWebServerRequest *configBodyOwner = NULL;
+
+static const char *const CONFIG_KEYS[] = {
+  "brewTemp", "steamTemp", "shotSizes", "grindTimes",
+  "pidKp", "pidKi", "pidKd", "controlMode", "ssrWindowMs", "ssrMinSwitchMs",
+  "enableInfluxDB", "telemetrySpoolFlash", "healthRestart", "tempUpdateInterval", "eventIntervalMs",
+  "tempMedianSize", "tempFilterMode", "tempFilterAlpha", "tempKalmanQ",
+  "shotPreinfusionMs", "shotPreinfusionDuty", "shotRampMs",
+  "grindMode", "grindDoses", "grindRates",
+  "ffEnable", "ffLearn", "ffBoostPct", "ffTailMs", "steamKp", "steamKi", "steamKd",
+  "modelGain", "modelTauS", "modelDeadTimeS", "smithLambdaS",
+  "usePID"   // Alias of controlMode 0/1 for clients from before the Smith predictor
+};
+
+struct ConfigUpdate {
+  CoffeeConfig candidate;
+  JsonArray changed;
+  JsonArray errors;
+};
+
+static void rejectField(ConfigUpdate &update, const char *key, const char *reason) {
+  JsonObject error = update.errors.add<JsonObject>();
+  error["field"] = key;
+  error["error"] = reason;
+}
+
+static void updateFloat(ConfigUpdate &update, JsonVariantConst value, const char *key,
+                        float minValue, float maxValue, float &field) {
+  if (value.isNull()) return;
+  if (!value.is<float>()) {
+    rejectField(update, key, "not a number");
+    return;
+  }
+  float v = value.as<float>();
+  if (isnan(v) || v < minValue || v > maxValue) {
+    rejectField(update, key, "out of range");
+    return;
+  }
+  if (v != field) {
+    field = v;
+    update.changed.add(key);
+  }
+}
+
+static void updateInt(ConfigUpdate &update, JsonVariantConst value, const char *key,
+                      int minValue, int maxValue, int &field) {
+  if (value.isNull()) return;
+  if (!value.is<int>()) {
+    rejectField(update, key, "not an integer");
+    return;
+  }
+  int v = value.as<int>();
+  if (v < minValue || v > maxValue) {
+    rejectField(update, key, "out of range");
+    return;
+  }
+  if (v != field) {
+    field = v;
+    update.changed.add(key);
+  }
+}
+
+static void updateBool(ConfigUpdate &update, JsonVariantConst value, const char *key, bool &field) {
+  if (value.isNull()) return;
+  if (!value.is<bool>()) {
+    rejectField(update, key, "not a boolean");
+    return;
+  }
+  bool v = value.as<bool>();
+  if (v != field) {
+    field = v;
+    update.changed.add(key);
+  }
+}
+
+static void updateFloatArray(ConfigUpdate &update, JsonVariantConst value, const char *key,
+                             float minValue, float maxValue, float *field, size_t count) {
+  if (value.isNull()) return;
+  JsonArrayConst array = value.as<JsonArrayConst>();
+  if (array.isNull() || array.size() != count) {
+    rejectField(update, key, "wrong number of values");
+    return;
+  }
+  float values[4];
+  for (size_t i = 0; i < count; i++) {
+    if (!array[i].is<float>()) {
+      rejectField(update, key, "not a number");
+      return;
+    }
+    values[i] = array[i].as<float>();
+    if (isnan(values[i]) || values[i] < minValue || values[i] > maxValue) {
+      rejectField(update, key, "out of range");
+      return;
+    }
+  }
+  if (memcmp(values, field, count * sizeof(float)) != 0) {
+    memcpy(field, values, count * sizeof(float));
+    update.changed.add(key);
+  }
+}
+
+static void sendConfigError(AsyncWebServerRequest *request, int code, const char *reason) {
+  JsonDocument result;
+  result["ok"] = false;
+  JsonObject error = result["errors"].to<JsonArray>().add<JsonObject>();
+  error["field"] = "";
+  error["error"] = reason;
+  
+  String response;
+  serializeJson(result, static_cast<String&>(response));
+  request->send(code, "application/json", response);
+}
+
+static void collectConfigBody(AsyncWebServerRequest *request, uint8_t *data, size_t len,
+                              size_t index, size_t total) {
+  if (index == 0) {
+    if (configBodyOwner != NULL && configBodyOwner != request) {
+      return;  // Another update is being received; answered with 503
+    }
+    configBodyOwner = request;
+    configBodyLength = 0;
+    configBodyOverflow = total >= CONFIG_BODY_MAX;
+    request->onDisconnect([request](){
+      if (configBodyOwner == request) configBodyOwner = NULL;
+    });
+  }
+  if (configBodyOwner != request || configBodyOverflow) {
+    return;
+  }
+  if (index != configBodyLength || index + len >= CONFIG_BODY_MAX) {
+    configBodyOverflow = true;
+    return;
+  }
+  memcpy(configBody + index, data, len);
+  configBodyLength = index + len;
+}
+
+static void handleConfigUpdate(AsyncWebServerRequest *request) {
+  PROFILE_SCOPE("POST /api/config");
+  if (configBodyOwner != request) {
+    if (configBodyOwner == NULL) {
+      sendConfigError(request, 400, "empty body");
+    } else {
+      sendConfigError(request, 503, "another configuration update is in progress");
+    }
+    return;
+  }
+  configBodyOwner = NULL;
+  if (configBodyOverflow) {
+    sendConfigError(request, 413, "body too large");
+    return;
+  }
+  
+  JsonDocument body;
+  DeserializationError parseError = deserializeJson(body, configBody, configBodyLength);
+  if (parseError || !body.is<JsonObject>()) {
+    sendConfigError(request, 400, parseError ? parseError.c_str() : "expected a JSON object");
+    return;
+  }
+  
+  JsonDocument result;
+  ConfigUpdate update;
+  update.candidate = getConfigSnapshot();
+  update.changed = result["changed"].to<JsonArray>();
+  update.errors = result["errors"].to<JsonArray>();
+  CoffeeConfig &c = update.candidate;
+  
+  updateFloat(update, body["brewTemp"], "brewTemp", 80.0, 100.0, c.brewTemp);
+  updateFloat(update, body["steamTemp"], "steamTemp", 100.0, 170.0, c.steamTemp);
+  updateFloatArray(update, body["shotSizes"], "shotSizes", 5.0, 60.0, c.shotSizes, 4);
+  updateFloatArray(update, body["grindTimes"], "grindTimes", 1.0, 30.0, c.grindTimes, 2);
+  updateFloat(update, body["pidKp"], "pidKp", 0.0, 100.0, c.pidKp);
+  updateFloat(update, body["pidKi"], "pidKi", 0.0, 100.0, c.pidKi);
+  updateFloat(update, body["pidKd"], "pidKd", 0.0, 500.0, c.pidKd);
+  updateFloat(update, body["steamKp"], "steamKp", 0.0, 100.0, c.steamKp);
+  updateFloat(update, body["steamKi"], "steamKi", 0.0, 100.0, c.steamKi);
+  updateFloat(update, body["steamKd"], "steamKd", 0.0, 500.0, c.steamKd);
+  updateInt(update, body["controlMode"], "controlMode", 0, 2, c.controlMode);
+  // Older clients send usePID (true = PID, false = on/off); controlMode wins
+  // if both are given
+  JsonVariantConst usePID = body["usePID"];
+  if (!usePID.isNull() && body["controlMode"].isNull()) {
+    if (!usePID.is<bool>()) {
+      rejectField(update, "usePID", "not a boolean");
+    } else {
+      int mode = usePID.as<bool>() ? CONTROL_MODE_PID : CONTROL_MODE_ONOFF;
+      if (mode != c.controlMode) {
+        c.controlMode = mode;
+        update.changed.add("controlMode");
+      }
+    }
+  }
+  updateFloat(update, body["modelGain"], "modelGain", 0.5, 100.0, c.modelGain);
+  updateFloat(update, body["modelTauS"], "modelTauS", 10.0, 20000.0, c.modelTauS);
+  updateFloat(update, body["modelDeadTimeS"], "modelDeadTimeS", 0.0, 250.0, c.modelDeadTimeS);
+  updateFloat(update, body["smithLambdaS"], "smithLambdaS", 0.0, 3600.0, c.smithLambdaS);
+  updateInt(update, body["ssrWindowMs"], "ssrWindowMs", 500, 5000, c.ssrWindowMs);
+  updateInt(update, body["ssrMinSwitchMs"], "ssrMinSwitchMs", 0, 200, c.ssrMinSwitchMs);
+  updateBool(update, body["enableInfluxDB"], "enableInfluxDB", c.enableInfluxDB);
+  updateBool(update, body["telemetrySpoolFlash"], "telemetrySpoolFlash", c.telemetrySpoolFlash);
+  updateBool(update, body["healthRestart"], "healthRestart", c.healthRestart);
+  updateInt(update, body["tempUpdateInterval"], "tempUpdateInterval", 200, 5000, c.tempUpdateInterval);
+  updateInt(update, body["eventIntervalMs"], "eventIntervalMs", 100, 5000, c.eventIntervalMs);
+  updateInt(update, body["tempMedianSize"], "tempMedianSize", 1, 9, c.tempMedianSize);
+  updateInt(update, body["tempFilterMode"], "tempFilterMode", 0, 1, c.tempFilterMode);
+  updateFloat(update, body["tempFilterAlpha"], "tempFilterAlpha", 0.01, 1.0, c.tempFilterAlpha);
+  updateFloat(update, body["tempKalmanQ"], "tempKalmanQ", 0.0001, 10.0, c.tempKalmanQ);
+  updateInt(update, body["shotPreinfusionMs"], "shotPreinfusionMs", 0, 15000, c.shotPreinfusionMs);
+  updateInt(update, body["shotPreinfusionDuty"], "shotPreinfusionDuty", 0, 100, c.shotPreinfusionDuty);
+  updateInt(update, body["shotRampMs"], "shotRampMs", 0, 10000, c.shotRampMs);
+  updateInt(update, body["grindMode"], "grindMode", 0, 1, c.grindMode);
+  updateFloatArray(update, body["grindDoses"], "grindDoses", 1.0, 40.0, c.grindDoses, 2);
+  updateFloatArray(update, body["grindRates"], "grindRates", 0.0, 10.0, c.grindRates, 2);
+  updateBool(update, body["ffEnable"], "ffEnable", c.ffEnable);
+  updateBool(update, body["ffLearn"], "ffLearn", c.ffLearn);
+  updateFloatArray(update, body["ffBoostPct"], "ffBoostPct", 0.0, 100.0, c.ffBoostPct, 4);
+  updateInt(update, body["ffTailMs"], "ffTailMs", 0, 20000, c.ffTailMs);
+  
+  // Cross-field checks on the resulting configuration
+  if (c.steamTemp <= c.brewTemp) {
+    rejectField(update, "steamTemp", "must be above brewTemp");
+  }
+  if (c.ssrMinSwitchMs * 2 > c.ssrWindowMs) {
+    rejectField(update, "ssrMinSwitchMs", "must be at most half of ssrWindowMs");
+  }
+  if (c.controlMode == CONTROL_MODE_SMITH && !smithDeadTimeFits(c.modelDeadTimeS, c.tempUpdateInterval)) {
+    rejectField(update, "modelDeadTimeS", "longer than the Smith predictor's delay line at this tempUpdateInterval");
+  }
+  
+  // Unknown keys are reported but do not fail the update
+  JsonArray ignored = result["ignored"].to<JsonArray>();
+  for (JsonPairConst field : body.as<JsonObjectConst>()) {
+    bool known = false;
+    for (const char *key : CONFIG_KEYS) {
+      if (strcmp(field.key().c_str(), key) == 0) {
+        known = true;
+        break;
+      }
+    }
+    if (!known) ignored.add(field.key().c_str());
+  }
+  
+  bool ok = update.errors.size() == 0;
+  result["ok"] = ok;
+  
+  // All or nothing: the control task applies and persists only a fully
+  // valid update, and only the fields it changed
+  ConfigFields fields = 0;
+  for (JsonVariantConst key : update.changed) {
+    fields |= configField(key.as<const char *>());
+  }
+  if (ok && fields != 0 && !postConfig(c, fields)) {
+    sendConfigError(request, 503, "previous configuration update not applied yet");
+    return;
+  }
+  
+  String response;
+  serializeJson(result, static_cast<String&>(response));
+  request->send(ok ? 200 : 400, "application/json", response);
+}
+
+// ======= Shot History =======
+// Records are copied out of the shot engine into here: too large for the
+// stack of the async_tcp task, which runs every handler one at a time.
+static ShotRecord shotBuffer;
 
 // ======= Web Server Endpoints =======
 void setupWebServer() {
   // Serve main configuration page
   webServer.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /");
     request->send(200, "text/html", HTML_PAGE);
   });
   
   // API endpoint: Get current status
   webServer.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/status");
+    ControlSnapshot control = getControlSnapshot();
+    JsonDocument doc;
+    doc["currentTemp"] = control.currentTemp;
+    doc["rawTemp"] = control.rawTemp;
+    doc["tempDerivative"] = control.tempDerivative;
+    doc["coldJunctionTemp"] = control.coldJunctionTemp;
+    doc["sensorFaults"] = control.sensorFaults;
+    doc["targetTemp"] = control.targetTemp;
+    doc["heatingElement"] = control.heatingElement;
+    doc["heaterDuty"] = control.heaterDuty;
+    doc["heaterOutput"] = getHeaterOutputState();
+    doc["pump"] = control.state.has(STATE_PUMP);
+    doc["grinder"] = control.state.has(STATE_GRINDER);
+    doc["steamMode"] = control.state.has(STATE_STEAM_MODE);
+    doc["controlMode"] = controlModeName(getConfigSnapshot().controlMode);
+    doc["currentOperation"] = operationName(control.state.operation);
+    
+    ShotStatus shot = getShotStatus();
+    doc["shotPhase"] = shotPhaseName(shot.phase);
+    doc["shotElapsedMs"] = shot.elapsedMs;
+    doc["shotPlannedMs"] = shot.plannedMs;
+    
+    // Scheduled gains and terms of the last PID update
+    JsonObject pid = doc["pid"].to<JsonObject>();
+    pid["kp"] = control.pid.gains.kp;
+    pid["ki"] = control.pid.gains.ki;
+    pid["kd"] = control.pid.gains.kd;
+    pid["p"] = control.pid.p;
+    pid["i"] = control.pid.i;
+    pid["d"] = control.pid.d;
+    pid["output"] = control.pid.output;
+    
+    // Model and PI terms of the last Smith predictor update
+    JsonObject smith = doc["smith"].to<JsonObject>();
+    smith["modelC"] = control.smith.modelC;
+    smith["delayedC"] = control.smith.delayedC;
+    smith["predictedC"] = control.smith.predictedC;
+    smith["hold"] = control.smith.hold;
+    smith["p"] = control.smith.p;
+    smith["i"] = control.smith.i;
+    smith["deadTimeClamped"] = control.smith.deadTimeClamped;
+    smith["output"] = control.smith.output;
+    
+    FeedForwardStats ff = getFeedForwardStats();
+    JsonObject feedForward = doc["feedForward"].to<JsonObject>();
+    feedForward["duty"] = ff.dutyPct;
+    feedForward["learnedShots"] = ff.learnedShots;
+    feedForward["lastShotId"] = ff.lastShotId;
+    feedForward["lastDroopC"] = ff.lastDroopC;
+    feedForward["lastRiseC"] = ff.lastRiseC;
+    
+    GrindStatus grind = getGrindStatus();
+    doc["grindElapsedMs"] = grind.elapsedMs;
+    doc["grindPlannedMs"] = grind.plannedMs;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Control loop timing (period jitter in microseconds)
+  webServer.on("/api/control/timing", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/control/timing");
+    ControlSnapshot control = getControlSnapshot();
+    JsonDocument doc;
+    doc["cycles"] = control.cycleCount;
+    doc["nominalPeriodUs"] = control.timing.nominalPeriodUs;
+    doc["samples"] = control.timing.samples;
+    doc["periodMinUs"] = control.timing.periodMinUs;
+    doc["periodMaxUs"] = control.timing.periodMaxUs;
+    doc["jitterP99Us"] = control.timing.jitterP99Us;
+    doc["jitterMaxUs"] = control.timing.jitterMaxUs;
+    doc["execLastUs"] = control.timing.execLastUs;
+    doc["execMaxUs"] = control.timing.execMaxUs;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Command queue and shared state contention
+  webServer.on("/api/control/commands", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/control/commands");
+    SharedStateStats stats = getSharedStateStats();
+    JsonDocument doc;
+    doc["posted"] = stats.posted;
+    doc["applied"] = stats.applied;
+    doc["dropped"] = stats.dropped;
+    doc["depth"] = stats.depth;
+    doc["maxDepth"] = stats.maxDepth;
+    doc["queueSize"] = COMMAND_QUEUE_SIZE;
+    doc["postRetries"] = stats.postRetries;
+    doc["configBusy"] = stats.configBusy;
+    doc["snapshotReads"] = stats.snapshotReads;
+    doc["snapshotRetries"] = stats.snapshotRetries;
+    doc["configReads"] = stats.configReads;
+    doc["configRetries"] = stats.configRetries;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Reset control loop timing statistics
+  webServer.on("/api/control/timing/reset", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/control/timing/reset");
+    resetControlTiming();
+    request->send(200, "text/plain", "Control timing statistics reset");
+  });
+  
+  // API endpoint: Telemetry link and offline spool statistics
+  webServer.on("/api/telemetry", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/telemetry");
+    TelemetryStats telemetry = getTelemetryStats();
+    SpoolStats spool = getSpoolStats();
+    JsonDocument doc;
+    doc["linkUp"] = telemetry.linkUp;
+    doc["packetsSent"] = telemetry.packetsSent;
+    doc["samplesSent"] = telemetry.samplesSent;
+    doc["sendFailures"] = telemetry.sendFailures;
+    doc["probeFailures"] = telemetry.probeFailures;
+    doc["spoolRam"] = spool.ramSamples;
+    doc["spoolFlash"] = spool.flashSamples;
+    doc["spooled"] = spool.spooled;
+    doc["replayed"] = spool.replayed;
+    doc["dropped"] = spool.dropped;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Display rendering counters
+  webServer.on("/api/display", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/display");
+    DisplayStats display = getDisplayStats();
+    JsonDocument doc;
+    doc["flushedPixelsPerSec"] = display.flushedPixelsPerSec;
+    doc["savedPixelsPerSec"] = display.savedPixelsPerSec;
+    doc["labelUpdates"] = display.labelUpdates;
+    doc["labelSkips"] = display.labelSkips;
+    doc["bufferLines"] = display.bufferLines;
+    doc["dma"] = display.dma;
+    
+    JsonObject bench = doc["benchmark"].to<JsonObject>();
+    bench["blockingFrameUs"] = display.benchBlockingFrameUs;
+    bench["blockingKBps"] = display.benchBlockingKBps;
+    bench["dmaFrameUs"] = display.benchDmaFrameUs;
+    bench["dmaKBps"] = display.benchDmaKBps;
+    
+    JsonObject touch = doc["touch"].to<JsonObject>();
+    touch["irqs"] = display.touchIrqs;
+    touch["reads"] = display.touchReads;
+    touch["presses"] = display.touchPresses;
+    touch["calibrated"] = display.touchCalibrated;
+    touch["calibrating"] = display.touchCalibrating;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Time a full-screen redraw with each flush path
+  webServer.on("/api/display/benchmark", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/display/benchmark");
+    requestDisplayBenchmark();
+    request->send(200, "text/plain", "Display benchmark scheduled - see /api/display");
+  });
+  
+  // API endpoint: Show the touch calibration screen
+  webServer.on("/api/display/calibrate", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/display/calibrate");
+    requestTouchCalibration();
+    request->send(200, "text/plain", "Touch calibration started - touch the crosses on the screen");
+  });
+  
+  // API endpoint: Configuration store flash write counters
+  webServer.on("/api/storage", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/storage");
+    StorageStats storage = getStorageStats();
     JsonDocument doc;
-    doc["currentTemp"] = systemState.currentTemp;
-    doc["targetTemp"] = systemState.targetTemp;
-    doc["heatingElement"] = systemState.heatingElement;
-    doc["pump"] = systemState.pump;
-    doc["grinder"] = systemState.grinder;
-    doc["steamMode"] = systemState.steamMode;
-    doc["currentOperation"] = systemState.currentOperation;
+    doc["schemaVersion"] = STORAGE_SCHEMA_VERSION;
+    doc["loadedVersion"] = storage.loadedVersion;
+    doc["saveRequests"] = storage.saveRequests;
+    doc["commits"] = storage.commits;
+    doc["flashWrites"] = storage.flashWrites;
+    doc["unchangedSkips"] = storage.unchangedSkips;
+    doc["writeErrors"] = storage.writeErrors;
+    doc["loadErrors"] = storage.loadErrors;
+    doc["pending"] = storage.pending;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Heap, task stack and LVGL pool health
+  webServer.on("/api/health", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/health");
+    HealthStatus health = getHealthStatus();
+    JsonDocument doc;
+    doc["samples"] = health.samples;
+    doc["ageMs"] = millis() - health.sampledMs;
+    
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = health.freeHeap;
+    heap["minFree"] = health.minFreeHeap;
+    heap["largestBlock"] = health.largestBlock;
+    heap["fragPct"] = health.heapFragPct;
+    
+    JsonObject stacks = doc["stackFree"].to<JsonObject>();
+    for (int i = 0; i < HEALTH_TASK_COUNT; i++) {
+      if (health.tasks[i].found) stacks[health.tasks[i].name] = health.tasks[i].stackFree;
+    }
+    
+    JsonObject lvgl = doc["lvgl"].to<JsonObject>();
+    lvgl["total"] = health.lvglTotal;
+    lvgl["free"] = health.lvglFree;
+    lvgl["largestBlock"] = health.lvglLargest;
+    lvgl["maxUsed"] = health.lvglMaxUsed;
+    lvgl["usedPct"] = health.lvglUsedPct;
+    lvgl["fragPct"] = health.lvglFragPct;
+    
+    doc["alerts"] = health.alerts;
+    doc["alertsSeen"] = health.alertsSeen;
+    doc["alertEvents"] = health.alertEvents;
+    doc["restartEnabled"] = getConfigSnapshot().healthRestart;
+    doc["restartPending"] = health.restartPending;
+    doc["resetReason"] = health.resetReason;
+    doc["healthRestarts"] = health.healthRestarts;
+    doc["restartAlerts"] = health.restartAlerts;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Reset the hot-path timers (before /api/profile, which
+  // would match it as a prefix)
+  webServer.on("/api/profile/reset", HTTP_POST, [](AsyncWebServerRequest *request){
+    resetProfile();
+    request->send(200, "text/plain", "Profile reset");
+  });
+  
+  // API endpoint: Hot-path timers (count, total, min, max, log2 histogram)
+  webServer.on("/api/profile", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/profile");
+    JsonDocument doc;
+    doc["enabled"] = PROFILER_ENABLED == 1;
+    uint32_t cyclesPerUs = profileCyclesPerUs();
+    doc["cyclesPerUs"] = cyclesPerUs;
+    
+    // Histogram bucket n counts times in [2^(n-1), 2^n) µs, bucket 0 under 1 µs
+    JsonArray sites = doc["sites"].to<JsonArray>();
+    int count = getProfileSiteCount();
+    for (int i = 0; i < count; i++) {
+      ProfileSite site;
+      if (!getProfileSite(i, site)) break;
+      JsonObject entry = sites.add<JsonObject>();
+      entry["name"] = site.name;
+      entry["count"] = site.count;
+      entry["totalMs"] = site.totalCycles / (cyclesPerUs * 1000.0);
+      entry["meanUs"] = site.count > 0 ? site.totalCycles / (double)cyclesPerUs / site.count : 0.0;
+      entry["minUs"] = site.minCycles / (float)cyclesPerUs;
+      entry["maxUs"] = site.maxCycles / (float)cyclesPerUs;
+      entry["migrated"] = site.migrated;
+      int last = PROFILE_BUCKETS - 1;
+      while (last > 0 && site.buckets[last] == 0) last--;
+      JsonArray histogram = entry["histogram"].to<JsonArray>();
+      for (int b = 0; b <= last; b++) histogram.add(site.buckets[b]);
+    }
     
     String response;
     serializeJson(doc, static_cast<String&>(response));
@@ -26,27 +620,67 @@ void setupWebServer() {
   
   // API endpoint: Get configuration
   webServer.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/config");
+    CoffeeConfig config = getConfigSnapshot();
     JsonDocument doc;
-    doc["brewTemp"] = coffeeConfig.brewTemp;
-    doc["steamTemp"] = coffeeConfig.steamTemp;
+    doc["brewTemp"] = config.brewTemp;
+    doc["steamTemp"] = config.steamTemp;
     
     JsonArray shotSizes = doc.createNestedArray("shotSizes");
     for(int i = 0; i < 4; i++) {
-      shotSizes.add(coffeeConfig.shotSizes[i]);
+      shotSizes.add(config.shotSizes[i]);
     }
     
     JsonArray grindTimes = doc.createNestedArray("grindTimes");
     for(int i = 0; i < 2; i++) {
-      grindTimes.add(coffeeConfig.grindTimes[i]);
+      grindTimes.add(config.grindTimes[i]);
     }
     
-    doc["pidKp"] = coffeeConfig.pidKp;
-    doc["pidKi"] = coffeeConfig.pidKi;
-    doc["pidKd"] = coffeeConfig.pidKd;
-    doc["usePID"] = coffeeConfig.usePID;
+    doc["pidKp"] = config.pidKp;
+    doc["pidKi"] = config.pidKi;
+    doc["pidKd"] = config.pidKd;
+    doc["steamKp"] = config.steamKp;
+    doc["steamKi"] = config.steamKi;
+    doc["steamKd"] = config.steamKd;
+    doc["controlMode"] = config.controlMode;
+    doc["usePID"] = config.controlMode == CONTROL_MODE_PID;  // Deprecated, see controlMode
+    doc["modelGain"] = config.modelGain;
+    doc["modelTauS"] = config.modelTauS;
+    doc["modelDeadTimeS"] = config.modelDeadTimeS;
+    doc["smithLambdaS"] = config.smithLambdaS;
+    doc["ssrWindowMs"] = config.ssrWindowMs;
+    doc["ssrMinSwitchMs"] = config.ssrMinSwitchMs;
     
-    doc["enableInfluxDB"] = coffeeConfig.enableInfluxDB;
-    doc["tempUpdateInterval"] = coffeeConfig.tempUpdateInterval;
+    doc["enableInfluxDB"] = config.enableInfluxDB;
+    doc["telemetrySpoolFlash"] = config.telemetrySpoolFlash;
+    doc["healthRestart"] = config.healthRestart;
+    doc["tempUpdateInterval"] = config.tempUpdateInterval;
+    doc["eventIntervalMs"] = config.eventIntervalMs;
+    doc["tempMedianSize"] = config.tempMedianSize;
+    doc["tempFilterMode"] = config.tempFilterMode;
+    doc["tempFilterAlpha"] = config.tempFilterAlpha;
+    doc["tempKalmanQ"] = config.tempKalmanQ;
+    doc["shotPreinfusionMs"] = config.shotPreinfusionMs;
+    doc["shotPreinfusionDuty"] = config.shotPreinfusionDuty;
+    doc["shotRampMs"] = config.shotRampMs;
+    
+    doc["grindMode"] = config.grindMode;
+    JsonArray grindDoses = doc["grindDoses"].to<JsonArray>();
+    JsonArray grindRates = doc["grindRates"].to<JsonArray>();
+    JsonArray plannedMs = doc["grindPlannedMs"].to<JsonArray>();
+    for (int i = 0; i < 2; i++) {
+      grindDoses.add(config.grindDoses[i]);
+      grindRates.add(config.grindRates[i]);
+      plannedMs.add(grindPlannedMs(i));
+    }
+    
+    doc["ffEnable"] = config.ffEnable;
+    doc["ffLearn"] = config.ffLearn;
+    JsonArray ffBoostPct = doc["ffBoostPct"].to<JsonArray>();
+    for (int i = 0; i < 4; i++) {
+      ffBoostPct.add(config.ffBoostPct[i]);
+    }
+    doc["ffTailMs"] = config.ffTailMs;
     
     String response;
     serializeJson(doc, static_cast<String&>(response));
@@ -54,98 +688,366 @@ void setupWebServer() {
   });
   
   // API endpoint: Update configuration
-  webServer.on("/api/config", HTTP_POST, [](AsyncWebServerRequest *request){}, NULL,
-    [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
-      JsonDocument doc;
-      deserializeJson(doc, (char*)data);
-      
-      if(doc.containsKey("brewTemp")) coffeeConfig.brewTemp = doc["brewTemp"];
-      if(doc.containsKey("steamTemp")) coffeeConfig.steamTemp = doc["steamTemp"];
-      
-      if(doc.containsKey("shotSizes")) {
-        for(int i = 0; i < 4; i++) {
-          coffeeConfig.shotSizes[i] = doc["shotSizes"][i];
-        }
-      }
-      
-      if(doc.containsKey("grindTimes")) {
-        for(int i = 0; i < 2; i++) {
-          coffeeConfig.grindTimes[i] = doc["grindTimes"][i];
-        }
-      }
-      
-      if(doc.containsKey("pidKp")) coffeeConfig.pidKp = doc["pidKp"];
-      if(doc.containsKey("pidKi")) coffeeConfig.pidKi = doc["pidKi"];
-      if(doc.containsKey("pidKd")) coffeeConfig.pidKd = doc["pidKd"];
-      if(doc.containsKey("usePID")) coffeeConfig.usePID = doc["usePID"];
-      
-      // Update PID controller with new parameters
-      updatePIDTunings(coffeeConfig.pidKp, coffeeConfig.pidKi, coffeeConfig.pidKd);
-      
-      if(doc.containsKey("enableInfluxDB")) coffeeConfig.enableInfluxDB = doc["enableInfluxDB"];
-      if(doc.containsKey("tempUpdateInterval")) coffeeConfig.tempUpdateInterval = doc["tempUpdateInterval"];
-      
-      saveConfiguration();
-      request->send(200, "text/plain", "Configuration saved successfully!");
-    }
-  );
+  webServer.on("/api/config", HTTP_POST, handleConfigUpdate, NULL, collectConfigBody);
   
   // API endpoint: Toggle heating element
+  // (state changes are commands applied by the control task)
   webServer.on("/api/heating/toggle", HTTP_POST, [](AsyncWebServerRequest *request){
-    bool currentState = getHeatingElement();
-    setHeatingElement(!currentState);
+    PROFILE_SCOPE("POST /api/heating/toggle");
+    bool currentState = getControlSnapshot().heatingElement;
+    if (!postCommand(CMD_TOGGLE_HEATING)) {
+      request->send(503, "text/plain", "Busy, try again");
+      return;
+    }
     request->send(200, "text/plain", currentState ? "Heating OFF" : "Heating ON");
   });
   
   // API endpoint: Set brew mode
   webServer.on("/api/mode/brew", HTTP_POST, [](AsyncWebServerRequest *request){
-    systemState.steamMode = false;
-    systemState.targetTemp = coffeeConfig.brewTemp;
-    systemState.currentOperation = "Brew Mode";
-    request->send(200, "text/plain", "Switched to Brew Mode (" + String(coffeeConfig.brewTemp) + "&deg;C)");
+    PROFILE_SCOPE("POST /api/mode/brew");
+    if (!postCommand(CMD_SET_STEAM_MODE, 0)) {
+      request->send(503, "text/plain", "Busy, try again");
+      return;
+    }
+    request->send(200, "text/plain", "Switched to Brew Mode (" + String(getConfigSnapshot().brewTemp) + "&deg;C)");
   });
   
   // API endpoint: Set steam mode
   webServer.on("/api/mode/steam", HTTP_POST, [](AsyncWebServerRequest *request){
-    systemState.steamMode = true;
-    systemState.targetTemp = coffeeConfig.steamTemp;
-    systemState.currentOperation = "Steam Mode";
-    request->send(200, "text/plain", "Switched to Steam Mode (" + String(coffeeConfig.steamTemp) + "&deg;C)");
+    PROFILE_SCOPE("POST /api/mode/steam");
+    if (!postCommand(CMD_SET_STEAM_MODE, 1)) {
+      request->send(503, "text/plain", "Busy, try again");
+      return;
+    }
+    request->send(200, "text/plain", "Switched to Steam Mode (" + String(getConfigSnapshot().steamTemp) + "&deg;C)");
   });
   
-  // API endpoint: Start PID autotune
+  // API endpoint: Start PID autotune (method = relay (default) or step)
   webServer.on("/api/autotune/start", HTTP_POST, [](AsyncWebServerRequest *request){
-    if (isAutotuning()) {
+    PROFILE_SCOPE("POST /api/autotune/start");
+    String method = "relay";
+    if (request->hasParam("method", true)) {
+      method = request->getParam("method", true)->value();
+    } else if (request->hasParam("method")) {
+      method = request->getParam("method")->value();
+    }
+    if (method != "relay" && method != "step") {
+      request->send(400, "text/plain", "Unknown method (relay or step)");
+    } else if (!startAutotune(method == "step" ? AUTOTUNE_METHOD_STEP : AUTOTUNE_METHOD_RELAY)) {
       request->send(400, "text/plain", "AutoTune already running!");
     } else {
-      startAutotune();
       request->send(200, "text/plain", "AutoTune started - this will take several minutes");
     }
   });
   
   // API endpoint: Stop PID autotune
   webServer.on("/api/autotune/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/autotune/stop");
     if (isAutotuning()) {
-      stopAutotune(false);
+      stopAutotune();
       request->send(200, "text/plain", "AutoTune cancelled");
     } else {
       request->send(400, "text/plain", "AutoTune not running");
     }
   });
   
-  // API endpoint: Get autotune status
+  // API endpoint: Autotune progress and the result of the last run
   webServer.on("/api/autotune/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/autotune/status");
+    AutotuneStatus tune = getAutotuneStatus();
     JsonDocument doc;
     doc["running"] = isAutotuning();
-    doc["currentKp"] = coffeeConfig.pidKp;
-    doc["currentKi"] = coffeeConfig.pidKi;
-    doc["currentKd"] = coffeeConfig.pidKd;
+    doc["phase"] = autotunePhaseName(tune.phase);
+    doc["method"] = tune.method == AUTOTUNE_METHOD_STEP ? "step" : "relay";
+    doc["set"] = tune.steam ? "steam" : "brew";
+    doc["setpoint"] = tune.setpoint;
+    doc["cycles"] = tune.cycles;
+    doc["cyclesNeeded"] = tune.cyclesNeeded;
+    doc["elapsedMs"] = tune.elapsedMs;
+    doc["remainingMs"] = tune.remainingMs;
+    doc["ku"] = tune.ku;
+    doc["puS"] = tune.puS;
+    JsonObject previous = doc["previous"].to<JsonObject>();
+    previous["kp"] = tune.previous.kp;
+    previous["ki"] = tune.previous.ki;
+    previous["kd"] = tune.previous.kd;
+    previous["overshootC"] = tune.previousTest.overshootC;
+    previous["settleS"] = tune.previousTest.settleS;
+    JsonObject candidate = doc["candidate"].to<JsonObject>();
+    candidate["kp"] = tune.candidate.kp;
+    candidate["ki"] = tune.candidate.ki;
+    candidate["kd"] = tune.candidate.kd;
+    candidate["overshootC"] = tune.candidateTest.overshootC;
+    candidate["settleS"] = tune.candidateTest.settleS;
+    doc["result"] = autotuneResultName(tune.result);
+    doc["message"] = tune.message;
+    // Gains of the set being tuned (brew or steam)
+    CoffeeConfig config = getConfigSnapshot();
+    doc["currentKp"] = tune.steam ? config.steamKp : config.pidKp;
+    doc["currentKi"] = tune.steam ? config.steamKi : config.pidKi;
+    doc["currentKd"] = tune.steam ? config.steamKd : config.pidKd;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: Trace recorder state (registered before /api/trace,
+  // which would also match this path)
+  webServer.on("/api/trace/status", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/trace/status");
+    TraceStatus trace = getTraceStatus();
+    JsonDocument doc;
+    doc["state"] = traceStateName(trace.state);
+    doc["trigger"] = trace.trigger == TRACE_TRIGGER_SHOT ? "shot"
+                   : trace.trigger == TRACE_TRIGGER_MANUAL ? "manual" : "none";
+    doc["records"] = trace.records;
+    doc["capacity"] = trace.capacity;
+    doc["written"] = trace.written;
+    doc["recordBytes"] = sizeof(TraceRecord);
+    doc["sampleMs"] = TEMP_SAMPLE_PERIOD_MS;
+    doc["intervalMs"] = getConfigSnapshot().tempUpdateInterval;
+    doc["postMs"] = trace.postMs;
+    doc["triggerMs"] = trace.triggerMs;
+    doc["psram"] = trace.psram;
+    
+    String response;
+    serializeJson(doc, static_cast<String&>(response));
+    request->send(200, "application/json", response);
+  });
+  
+  // API endpoint: (Re)start recording; trigger=shot|manual freezes the
+  // ring postMs after the trigger
+  webServer.on("/api/trace/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/trace/start");
+    String trigger = "none";
+    long postMs = TRACE_POST_MS;
+    if (request->hasParam("trigger", true)) {
+      trigger = request->getParam("trigger", true)->value();
+    } else if (request->hasParam("trigger")) {
+      trigger = request->getParam("trigger")->value();
+    }
+    if (request->hasParam("postMs", true)) {
+      postMs = request->getParam("postMs", true)->value().toInt();
+    } else if (request->hasParam("postMs")) {
+      postMs = request->getParam("postMs")->value().toInt();
+    }
+    if (postMs < 0 || postMs > TRACE_POST_MAX_MS) {
+      request->send(400, "text/plain", "postMs out of range");
+      return;
+    }
+    TraceTrigger mode;
+    if (trigger == "none") mode = TRACE_TRIGGER_NONE;
+    else if (trigger == "shot") mode = TRACE_TRIGGER_SHOT;
+    else if (trigger == "manual") mode = TRACE_TRIGGER_MANUAL;
+    else {
+      request->send(400, "text/plain", "Unknown trigger (none, shot or manual)");
+      return;
+    }
+    if (getTraceStatus().capacity == 0) {
+      request->send(503, "text/plain", "Trace recorder has no memory");
+      return;
+    }
+    startTrace(mode, postMs);
+    request->send(200, "text/plain", mode == TRACE_TRIGGER_NONE ? "Trace recording" : "Trace armed");
+  });
+  
+  // API endpoint: Freeze the trace ring
+  webServer.on("/api/trace/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/trace/stop");
+    stopTrace();
+    request->send(200, "text/plain", "Trace stopped");
+  });
+  
+  // API endpoint: Manual trigger of an armed capture
+  webServer.on("/api/trace/trigger", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/trace/trigger");
+    if (getTraceStatus().state != TRACE_ARMED) {
+      request->send(400, "text/plain", "Trace not armed");
+      return;
+    }
+    triggerTrace();
+    request->send(200, "text/plain", "Trace triggered");
+  });
+  
+  // API endpoint: Dump the trace ring, binary (default) or format=csv.
+  // Chunked: each chunk is filled straight from the ring, so the dump needs
+  // no buffer of its own whatever the ring size.
+  webServer.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/trace");
+    bool csv = request->hasParam("format") && request->getParam("format")->value() == "csv";
+    TraceCursor cursor = openTrace(csv);
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        csv ? "text/csv" : "application/octet-stream",
+        [cursor](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+          return readTrace(cursor, buffer, maxLen);
+        });
+    response->addHeader("Content-Disposition", csv ? "attachment; filename=trace.csv"
+                                                   : "attachment; filename=trace.trc");
+    request->send(response);
+  });
+  
+  // API endpoint: Start a shot (size = index into shotSizes)
+  webServer.on("/api/shot/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/shot/start");
+    int size = getControlSnapshot().state.selectedShotSize;
+    if (request->hasParam("size", true)) {
+      size = request->getParam("size", true)->value().toInt();
+    } else if (request->hasParam("size")) {
+      size = request->getParam("size")->value().toInt();
+    }
+    if (size < 0 || size > 3) {
+      request->send(400, "text/plain", "size must be 0-3");
+    } else if (!startShot(size)) {
+      request->send(409, "text/plain", "Shot already running");
+    } else {
+      request->send(200, "text/plain", "Shot started: " + String(getConfigSnapshot().shotNames[size]));
+    }
+  });
+  
+  // API endpoint: Stop the running shot
+  webServer.on("/api/shot/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/shot/stop");
+    stopShot();
+    request->send(200, "text/plain", "Shot stopped");
+  });
+  
+  // API endpoint: Shot history, or one shot with its samples (?id=N)
+  webServer.on("/api/shots", HTTP_GET, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("GET /api/shots");
+    if (request->hasParam("id")) {
+      ShotRecord &record = shotBuffer;
+      uint32_t id = request->getParam("id")->value().toInt();
+      if (!getShotRecord(id, record)) {
+        request->send(404, "text/plain", "Unknown shot");
+        return;
+      }
+      AsyncResponseStream *response = request->beginResponseStream("application/json");
+      response->printf("{\"id\":%lu,\"size\":%u,\"startEpoch\":%lu,\"plannedMs\":%lu,"
+                       "\"actualMs\":%lu,\"aborted\":%s,\"sampleMs\":%d,\"samples\":[",
+                       (unsigned long)record.id, (unsigned)record.size,
+                       (unsigned long)record.startEpoch, (unsigned long)record.plannedMs,
+                       (unsigned long)record.actualMs, record.aborted ? "true" : "false",
+                       SHOT_SAMPLE_MS);
+      for (uint16_t i = 0; i < record.sampleCount; i++) {
+        const ShotSample &s = record.samples[i];
+        response->printf("%s[%.2f,%u,%u]", i ? "," : "", s.tempCenti / 100.0,
+                         (unsigned)s.duty, (unsigned)s.pump);
+      }
+      response->print("]}");
+      request->send(response);
+      return;
+    }
+    
+    uint32_t ids[SHOT_HISTORY_SIZE];
+    uint32_t count = getShotIds(ids, SHOT_HISTORY_SIZE);
+    JsonDocument doc;
+    JsonArray shots = doc["shots"].to<JsonArray>();
+    ShotRecord &summary = shotBuffer;
+    for (uint32_t i = 0; i < count; i++) {
+      if (!getShotRecord(ids[i], summary)) continue;
+      JsonObject shot = shots.add<JsonObject>();
+      shot["id"] = summary.id;
+      shot["startMs"] = summary.startMs;
+      shot["size"] = summary.size;
+      shot["startEpoch"] = summary.startEpoch;
+      shot["plannedMs"] = summary.plannedMs;
+      shot["actualMs"] = summary.actualMs;
+      shot["aborted"] = summary.aborted;
+      shot["startTemp"] = summary.startTemp;
+      shot["minTemp"] = summary.minTemp;
+      shot["maxTemp"] = summary.maxTemp;
+      shot["samples"] = summary.sampleCount;
+    }
+    
+    // Grind events are listed next to the shots they were ground for
+    uint32_t grindIds[GRIND_HISTORY_SIZE];
+    uint32_t grindCount = getGrindIds(grindIds, GRIND_HISTORY_SIZE);
+    JsonArray grinds = doc["grinds"].to<JsonArray>();
+    for (uint32_t i = 0; i < grindCount; i++) {
+      GrindRecord record;
+      if (!getGrindRecord(grindIds[i], record)) continue;
+      JsonObject grind = grinds.add<JsonObject>();
+      grind["id"] = record.id;
+      grind["preset"] = record.preset;
+      grind["mode"] = record.mode == GRIND_MODE_DOSE ? "dose" : "timed";
+      grind["startEpoch"] = record.startEpoch;
+      grind["startMs"] = record.startMs;
+      grind["plannedMs"] = record.plannedMs;
+      grind["actualMs"] = record.actualMs;
+      grind["aborted"] = record.aborted;
+      if (record.mode == GRIND_MODE_DOSE) {
+        grind["rate"] = record.rate;
+        grind["targetDose"] = record.targetDose;
+      }
+      if (record.weighedDose > 0.0) {
+        grind["weighedDose"] = record.weighedDose;
+      }
+    }
     
     String response;
     serializeJson(doc, static_cast<String&>(response));
     request->send(200, "application/json", response);
   });
   
+  // API endpoint: Start grinding (preset 0 = single, 1 = double)
+  webServer.on("/api/grind/start", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/grind/start");
+    int preset = getControlSnapshot().state.selectedGrindTime;
+    if (request->hasParam("preset", true)) {
+      preset = request->getParam("preset", true)->value().toInt();
+    } else if (request->hasParam("preset")) {
+      preset = request->getParam("preset")->value().toInt();
+    }
+    if (preset < 0 || preset > 1) {
+      request->send(400, "text/plain", "preset must be 0 or 1");
+    } else if (!startGrind(preset)) {
+      request->send(409, "text/plain", "Grinder already running");
+    } else {
+      request->send(200, "text/plain", "Grinding " + String(getConfigSnapshot().grindNames[preset]) +
+                    " for " + String(grindPlannedMs(preset) / 1000.0, 2) + " s");
+    }
+  });
+  
+  // API endpoint: Stop the grinder
+  webServer.on("/api/grind/stop", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/grind/stop");
+    stopGrind();
+    request->send(200, "text/plain", "Grinder stopped");
+  });
+  
+  // API endpoint: Weighed dose of a grind (id defaults to the latest)
+  webServer.on("/api/grind/dose", HTTP_POST, [](AsyncWebServerRequest *request){
+    PROFILE_SCOPE("POST /api/grind/dose");
+    if (!request->hasParam("grams", true)) {
+      request->send(400, "text/plain", "grams is required");
+      return;
+    }
+    float grams = request->getParam("grams", true)->value().toFloat();
+    uint32_t id = 0;
+    if (request->hasParam("id", true)) {
+      id = request->getParam("id", true)->value().toInt();
+    }
+    if (grams <= 0.0 || grams > 100.0) {
+      request->send(400, "text/plain", "grams must be between 0 and 100");
+    } else if (!recordGrindDose(id, grams)) {
+      request->send(404, "text/plain", "No completed grind to attach the dose to");
+    } else {
+      request->send(200, "text/plain", "Dose recorded");
+    }
+  });
+  
+  // Event stream: new clients get the full state straight away
+  events.onConnect([](AsyncEventSourceClient *client){
+    StreamedStatus current;
+    char buffer[EVENT_BUFFER_SIZE];
+    captureStatus(current);
+    if (formatStatusEvent(buffer, sizeof(buffer), current, NULL) > 0) {
+      client->send(buffer, "status", millis(), 2000);
+    }
+  });
+  webServer.addHandler(&events);
+  
   webServer.begin();
   Serial.println("Web server started on http://" + hostnameStr + ".local/");
 }
@@ -17,9 +17,16 @@ extern SystemState systemState;
 #include "storage.h"
 #include "temperature.h"
 #include "pid_control.h"
+#include "autotune.h"
+
+// Largest accepted POST /api/config body
+#define CONFIG_BODY_MAX          1024
 
 // Web server setup function
 void setupWebServer();
 
+// Push status changes to /api/events clients (call from loop)
+void updateEventStream();
+
 #endif // WEB_SERVER_H
 
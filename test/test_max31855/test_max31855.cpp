@@ -0,0 +1,112 @@
+// MAX31855 frame decoding against the example values of the datasheet
+// (Table 2 thermocouple, Table 3 cold junction).
+//
+//   pio test -e native -f test_max31855
+
+#include <unity.h>
+#include "max31855.h"
+
+// D31..D18 thermocouple, D16 fault, D15..D4 cold junction, D2..D0 SCV/SCG/OC
+static uint32_t frame(uint16_t thermocouple14, uint16_t coldJunction12, uint8_t faults) {
+  uint32_t raw = ((uint32_t)(thermocouple14 & 0x3FFF) << 18) |
+                 ((uint32_t)(coldJunction12 & 0x0FFF) << 4) | (faults & 0x07);
+  if (faults) raw |= 0x00010000;
+  return raw;
+}
+
+static void assertThermocouple(uint16_t bits, float expectedC) {
+  Max31855Frame decoded;
+  TEST_ASSERT_TRUE(decodeMax31855Frame(frame(bits, 0x190, 0), decoded));
+  TEST_ASSERT_EQUAL_FLOAT(expectedC, decoded.thermocoupleC);
+  TEST_ASSERT_EQUAL_UINT8(0, decoded.faults);
+}
+
+static void assertColdJunction(uint16_t bits, float expectedC) {
+  Max31855Frame decoded;
+  TEST_ASSERT_TRUE(decodeMax31855Frame(frame(0x064, bits, 0), decoded));
+  TEST_ASSERT_EQUAL_FLOAT(expectedC, decoded.coldJunctionC);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_positive_thermocouple() {
+  assertThermocouple(0x1900, 1600.0);   // 0110 0100 0000 00
+  assertThermocouple(0x0FA0, 1000.0);   // 0011 1110 1000 00
+  assertThermocouple(0x0193, 100.75);   // 0000 0110 0100 11
+  assertThermocouple(0x0064, 25.0);     // 0000 0001 1001 00
+  assertThermocouple(0x0000, 0.0);
+}
+
+static void test_negative_thermocouple() {
+  assertThermocouple(0x3FFF, -0.25);    // 1111 1111 1111 11
+  assertThermocouple(0x3FFC, -1.0);     // 1111 1111 1111 00
+  assertThermocouple(0x3C18, -250.0);   // 1111 0000 0110 00
+}
+
+static void test_cold_junction() {
+  assertColdJunction(0x7F0, 127.0);     // 0111 1111 0000
+  assertColdJunction(0x649, 100.5625);  // 0110 0100 1001
+  assertColdJunction(0x190, 25.0);      // 0001 1001 0000
+  assertColdJunction(0xFFF, -0.0625);   // 1111 1111 1111
+  assertColdJunction(0xFF0, -1.0);      // 1111 1111 0000
+  assertColdJunction(0xEC0, -20.0);     // 1110 1100 0000
+  assertColdJunction(0xC90, -55.0);     // 1100 1001 0000
+}
+
+// Whole captured words, as they come off the bus
+static void test_raw_words() {
+  Max31855Frame decoded;
+  TEST_ASSERT_TRUE(decodeMax31855Frame(0x06401900, decoded));   // 100 °C, 25 °C junction
+  TEST_ASSERT_EQUAL_FLOAT(100.0, decoded.thermocoupleC);
+  TEST_ASSERT_EQUAL_FLOAT(25.0, decoded.coldJunctionC);
+  TEST_ASSERT_EQUAL_UINT32(0x06401900, decoded.raw);
+
+  TEST_ASSERT_TRUE(decodeMax31855Frame(0x01900000, decoded));   // 25 °C, 0 °C junction
+  TEST_ASSERT_EQUAL_FLOAT(25.0, decoded.thermocoupleC);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, decoded.coldJunctionC);
+}
+
+static void test_fault_bits() {
+  const uint8_t faults[] = {MAX31855_FAULT_OPEN, MAX31855_FAULT_SHORT_GND, MAX31855_FAULT_SHORT_VCC,
+                            MAX31855_FAULT_OPEN | MAX31855_FAULT_SHORT_VCC};
+  for (size_t i = 0; i < sizeof(faults); i++) {
+    Max31855Frame decoded;
+    TEST_ASSERT_FALSE(decodeMax31855Frame(frame(0x0064, 0x190, faults[i]), decoded));
+    TEST_ASSERT_EQUAL_UINT8(faults[i], decoded.faults);
+    // The cold junction is still valid with an open thermocouple
+    TEST_ASSERT_EQUAL_FLOAT(25.0, decoded.coldJunctionC);
+  }
+
+  // Open thermocouple: D16 and OC set, thermocouple field at full scale
+  Max31855Frame decoded;
+  TEST_ASSERT_FALSE(decodeMax31855Frame(0x7FFD1901, decoded));
+  TEST_ASSERT_EQUAL_UINT8(MAX31855_FAULT_OPEN, decoded.faults);
+}
+
+static void test_fault_bits_without_d16_ignored() {
+  // D2..D0 only count when the summary fault bit D16 is set
+  Max31855Frame decoded;
+  TEST_ASSERT_TRUE(decodeMax31855Frame(frame(0x0064, 0x190, 0) | MAX31855_FAULT_OPEN, decoded));
+  TEST_ASSERT_EQUAL_UINT8(0, decoded.faults);
+}
+
+static void test_idle_bus() {
+  Max31855Frame decoded;
+  TEST_ASSERT_FALSE(decodeMax31855Frame(0x00000000, decoded));
+  TEST_ASSERT_EQUAL_UINT8(MAX31855_FAULT_NO_DEVICE, decoded.faults);
+  TEST_ASSERT_FALSE(decodeMax31855Frame(0xFFFFFFFF, decoded));
+  TEST_ASSERT_EQUAL_UINT8(MAX31855_FAULT_NO_DEVICE, decoded.faults);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_positive_thermocouple);
+  RUN_TEST(test_negative_thermocouple);
+  RUN_TEST(test_cold_junction);
+  RUN_TEST(test_raw_words);
+  RUN_TEST(test_fault_bits);
+  RUN_TEST(test_fault_bits_without_d16_ignored);
+  RUN_TEST(test_idle_bus);
+  return UNITY_END();
+}
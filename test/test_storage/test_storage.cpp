@@ -0,0 +1,85 @@
+// Configuration persistence against an in-memory Preferences store: bursts
+// of saves must coalesce into one blob write, unchanged saves must not
+// write at all.
+//
+//   pio test -e native -f test_storage
+
+#include <unity.h>
+#include <Preferences.h>
+#include "simulator.h"
+#include "storage.h"
+
+// Advance the simulated clock, letting the storage step run as the task would
+static void runFor(uint32_t durationMs) {
+  const uint32_t stepMs = 100;
+  for (uint32_t elapsed = 0; elapsed < durationMs; elapsed += stepMs) {
+    simRun(stepMs);
+    stepStorage();
+  }
+}
+
+void setUp() {
+  Preferences::reset();
+  coffeeConfig = CoffeeConfig();
+  simBegin(BoilerParams(), 20.0);
+  loadConfiguration();                // Empty store: defaults, nothing in flash yet
+  saveConfiguration();
+  flushConfiguration();               // Flash now holds the defaults
+  Preferences::writes() = 0;
+}
+
+void tearDown() {}
+
+void test_burst_of_saves_writes_once() {
+  for (int i = 0; i < 10; i++) {
+    coffeeConfig.brewTemp = 90.0 + i;
+    saveConfiguration();
+    runFor(100);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, Preferences::writes());
+  TEST_ASSERT_TRUE(getStorageStats().pending);
+
+  runFor(STORAGE_DEBOUNCE_MS);
+  TEST_ASSERT_EQUAL_UINT32(1, Preferences::writes());
+  TEST_ASSERT_FALSE(getStorageStats().pending);
+
+  coffeeConfig = CoffeeConfig();
+  loadConfiguration();
+  TEST_ASSERT_EQUAL_FLOAT(99.0, coffeeConfig.brewTemp);
+}
+
+void test_unchanged_config_does_not_write() {
+  uint32_t skips = getStorageStats().unchangedSkips;
+  saveConfiguration();
+  runFor(STORAGE_DEBOUNCE_MS + 100);
+  TEST_ASSERT_EQUAL_UINT32(0, Preferences::writes());
+  TEST_ASSERT_EQUAL_UINT32(skips + 1, getStorageStats().unchangedSkips);
+}
+
+void test_saves_apart_write_separately() {
+  coffeeConfig.steamTemp = 140.0;
+  saveConfiguration();
+  runFor(STORAGE_DEBOUNCE_MS + 100);
+  coffeeConfig.steamTemp = 145.0;
+  saveConfiguration();
+  runFor(STORAGE_DEBOUNCE_MS + 100);
+  TEST_ASSERT_EQUAL_UINT32(2, Preferences::writes());
+}
+
+void test_flush_writes_immediately() {
+  coffeeConfig.pidKp = 12.5;
+  saveConfiguration();
+  flushConfiguration();
+  TEST_ASSERT_EQUAL_UINT32(1, Preferences::writes());
+  runFor(STORAGE_DEBOUNCE_MS + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, Preferences::writes());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_of_saves_writes_once);
+  RUN_TEST(test_unchanged_config_does_not_write);
+  RUN_TEST(test_saves_apart_write_separately);
+  RUN_TEST(test_flush_writes_immediately);
+  return UNITY_END();
+}
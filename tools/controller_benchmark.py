@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Run the controller benchmark scenarios against the boiler simulation.
+
+Runs every scenario (cold start, brew-to-steam, back-to-back shots, sensor
+noise) for each controller mode with the native simulator and writes the
+KPIs as one JSON document:
+
+    pio run -e native
+    python3 tools/controller_benchmark.py --output bench.json
+
+Options after `--` are passed to the simulator, e.g. to try new gains:
+
+    python3 tools/controller_benchmark.py -- --kp 6 --ki 0.05 --kd 40
+
+With --baseline, KPIs are compared against an earlier run and the deltas
+are printed.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+SCENARIOS = ["cold_start", "brew_to_steam", "steam_to_brew", "shots", "noise"]
+MODES = ["onoff", "pid", "smith"]
+KPIS = ["riseTimeS", "overshootC", "settleTimeS", "rmsErrorC", "maxDropC",
+        "ssrSwitches", "energyWh", "meanDutyPct"]
+
+
+def run(binary, scenario, mode, extra):
+    cmd = [binary, "--scenario", scenario, "--mode", mode] + extra
+    out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+    return json.loads(out.strip().splitlines()[-1])
+
+
+def key(result):
+    return (result["scenario"], result["controller"])
+
+
+def print_table(results, baseline):
+    reference = {key(r): r for r in baseline} if baseline else {}
+    width = 22 if reference else 13
+    header = "%-14s %-6s" % ("scenario", "mode") + "".join("%*s" % (width, k) for k in KPIS)
+    print(header, file=sys.stderr)
+    for r in results:
+        cells = []
+        for k in KPIS:
+            cell = "%.2f" % r[k] if isinstance(r[k], float) else str(r[k])
+            ref = reference.get(key(r))
+            if ref is not None and ref[k] != r[k]:
+                cell += " (%+.2f)" % (r[k] - ref[k])
+            cells.append("%*s" % (width, cell))
+        print("%-14s %-6s" % key(r) + "".join(cells), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--binary", default=".pio/build/native/program",
+                        help="simulator executable (default: %(default)s)")
+    parser.add_argument("--scenario", action="append", choices=SCENARIOS,
+                        help="run only this scenario (repeatable)")
+    parser.add_argument("--mode", action="append", choices=MODES,
+                        help="run only this controller (repeatable)")
+    parser.add_argument("--output", help="write JSON here instead of stdout")
+    parser.add_argument("--baseline", help="earlier JSON output to compare against")
+    parser.add_argument("extra", nargs="*", help="arguments passed to the simulator")
+    args = parser.parse_args()
+
+    results = []
+    for scenario in args.scenario or SCENARIOS:
+        for mode in args.mode or MODES:
+            results.append(run(args.binary, scenario, mode, args.extra))
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)["results"]
+    print_table(results, baseline)
+
+    document = json.dumps({"results": results}, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(document + "\n")
+    else:
+        print(document)
+
+
+if __name__ == "__main__":
+    main()
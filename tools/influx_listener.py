@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Stand-in for InfluxDB when testing the telemetry path.
+
+Listens for line-protocol datagrams on UDP (default 8089) and accepts TCP
+connections on the probe port (default 8086) so the firmware sees the host
+as reachable. An outage can be scheduled to exercise the offline spool:
+
+    python3 tools/influx_listener.py --outage 60:120
+
+closes both sockets 60 s after start for 120 s. On exit (Ctrl-C) it prints
+how many points arrived, how many were replayed out of order, and the
+largest gap between consecutive timestamps.
+"""
+
+import argparse
+import select
+import socket
+import time
+
+
+def open_sockets(args):
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    udp.bind((args.bind, args.udp_port))
+    tcp = None
+    if args.probe_port:
+        tcp = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        tcp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        tcp.bind((args.bind, args.probe_port))
+        tcp.listen(4)
+    return udp, tcp
+
+
+def close_sockets(udp, tcp):
+    udp.close()
+    if tcp:
+        tcp.close()
+
+
+def parse_timestamp(line):
+    parts = line.rsplit(" ", 1)
+    if len(parts) == 2 and parts[1].isdigit() and len(parts[0].split(" ")) == 2:
+        return int(parts[1])
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--udp-port", type=int, default=8089)
+    parser.add_argument("--probe-port", type=int, default=8086, help="0 disables the TCP probe listener")
+    parser.add_argument("--outage", help="START:DURATION in seconds")
+    parser.add_argument("--quiet", action="store_true", help="do not print every line")
+    args = parser.parse_args()
+
+    outage = None
+    if args.outage:
+        start, duration = (float(x) for x in args.outage.split(":"))
+        outage = (start, start + duration)
+
+    started = time.monotonic()
+    udp, tcp = open_sockets(args)
+    online = True
+    points = 0
+    packets = 0
+    timestamps = []
+
+    try:
+        while True:
+            elapsed = time.monotonic() - started
+            want_online = not (outage and outage[0] <= elapsed < outage[1])
+            if want_online != online:
+                if want_online:
+                    udp, tcp = open_sockets(args)
+                    print(f"[{elapsed:7.1f}s] back online")
+                else:
+                    close_sockets(udp, tcp)
+                    print(f"[{elapsed:7.1f}s] outage started")
+                online = want_online
+
+            if not online:
+                time.sleep(0.2)
+                continue
+
+            readable, _, _ = select.select([s for s in (udp, tcp) if s], [], [], 0.2)
+            for sock in readable:
+                if sock is tcp:
+                    conn, _ = tcp.accept()
+                    conn.close()
+                    continue
+                data, addr = udp.recvfrom(65535)
+                packets += 1
+                for line in data.decode(errors="replace").splitlines():
+                    if not line:
+                        continue
+                    points += 1
+                    ts = parse_timestamp(line)
+                    if ts is not None:
+                        timestamps.append(ts)
+                    if not args.quiet:
+                        print(f"[{elapsed:7.1f}s] {addr[0]} {line}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if online:
+            close_sockets(udp, tcp)
+
+    print(f"\n{packets} packets, {points} points, {len(timestamps)} with timestamps")
+    if len(timestamps) > 1:
+        out_of_order = sum(1 for a, b in zip(timestamps, timestamps[1:]) if b < a)
+        ordered = sorted(timestamps)
+        max_gap = max(b - a for a, b in zip(ordered, ordered[1:])) / 1e9
+        print(f"replayed (out of order): {out_of_order}, largest timestamp gap: {max_gap:.1f} s")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Decode a binary control trace from /api/trace (or the simulator's --trace).
+
+    curl -o shot.trc http://coffee.local/api/trace
+    python3 tools/trace_decode.py shot.trc --csv shot.csv --plot shot.png
+
+The dump holds one sample record per thermocouple sample (100 ms) and a
+control record after each control cycle. Prints a summary (span, samples,
+cycles, gaps, trigger time). --csv writes one row per sample with the flags
+expanded and the terms of the latest control cycle attached; --plot draws
+temperature and setpoint, heater duty with the controller terms, and
+pump/SSR state (needs matplotlib). --window S keeps only S seconds either
+side of the trigger.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = 0x31435254  # "TRC1"
+HEADER = struct.Struct("<IHHHHI")
+RECORD_SIZE = 16
+SAMPLE = struct.Struct("<IhhhHhBB")
+CONTROL = struct.Struct("<IhhhhHBB")
+KIND_SAMPLE, KIND_CONTROL = 0, 1
+SAMPLE_FIELDS = ["time_ms", "raw_c", "temp_c", "slope_c_s", "duty_pct", "target_c", "flags"]
+CONTROL_FIELDS = ["p", "i", "d", "output", "exec_us", "mode"]
+FLAGS = ["ssr", "heating", "pump", "grinder", "steam", "fault", "autotune", "trigger"]
+MODES = ["onoff", "pid", "smith"]
+
+
+def decode(data):
+    """Sample rows, each with the terms of the latest control cycle before it."""
+    if len(data) < HEADER.size:
+        raise ValueError("file too short for a trace header")
+    magic, version, record_size, sample_ms, control_ms, expected = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("not a trace dump (magic %08x)" % magic)
+    if version != 2 or record_size != RECORD_SIZE:
+        raise ValueError("unsupported trace version %d / record size %d" % (version, record_size))
+
+    samples = []
+    cycles = []
+    control = {"p": 0.0, "i": 0.0, "d": 0.0, "output": 0.0, "exec_us": 0, "mode": "",
+               "period_ms": 0.0}
+    for offset in range(HEADER.size, len(data) - record_size + 1, record_size):
+        kind = data[offset + record_size - 1]
+        if kind == KIND_CONTROL:
+            v = CONTROL.unpack_from(data, offset)
+            time_ms = v[0]
+            c = dict(zip(CONTROL_FIELDS, v[1:7]))
+            for name in ("p", "i", "d", "output"):
+                c[name] /= 10.0
+            c["mode"] = MODES[c["mode"]] if c["mode"] < len(MODES) else str(c["mode"])
+            c["period_ms"] = float(time_ms - cycles[-1]) if cycles else 0.0
+            cycles.append(time_ms)
+            control = c
+            continue
+        v = SAMPLE.unpack_from(data, offset)
+        r = dict(zip(SAMPLE_FIELDS, v[:7]))
+        r["slope_c_s"] /= 1000.0
+        for name in ("raw_c", "temp_c", "target_c", "duty_pct"):
+            r[name] /= 100.0
+        for bit, name in enumerate(FLAGS):
+            r[name] = (r["flags"] >> bit) & 1
+        r.update(control)
+        samples.append(r)
+    return {"sample_ms": sample_ms, "control_ms": control_ms, "expected": expected,
+            "records": samples, "cycles": cycles}
+
+
+def trigger_ms(records):
+    for r in records:
+        if r["trigger"]:
+            return r["time_ms"]
+    return None
+
+
+def summarize(trace):
+    records = trace["records"]
+    print("Records:   %d of %d (%d samples at %d ms, %d control cycles at %d ms)"
+          % (len(records) + len(trace["cycles"]), trace["expected"], len(records),
+             trace["sample_ms"], len(trace["cycles"]), trace["control_ms"]))
+    if not records:
+        return
+    span = (records[-1]["time_ms"] - records[0]["time_ms"]) / 1000.0
+    print("Span:      %.1f s" % span)
+    gaps = [b["time_ms"] - a["time_ms"] for a, b in zip(records, records[1:])]
+    late = [g for g in gaps if g > 1.5 * trace["sample_ms"]]
+    if late:
+        print("Gaps:      %d longer than 1.5 sample periods (max %d ms)" % (len(late), max(late)))
+    t = trigger_ms(records)
+    if t is not None:
+        print("Trigger:   %.1f s into the trace" % ((t - records[0]["time_ms"]) / 1000.0))
+    print("Max exec:  %d us" % max(r["exec_us"] for r in records))
+
+
+def write_csv(records, path):
+    columns = ([f for f in SAMPLE_FIELDS if f != "flags"] + CONTROL_FIELDS + ["period_ms"]
+               + FLAGS)
+    with open(path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=columns, extrasaction="ignore")
+        writer.writeheader()
+        writer.writerows(records)
+
+
+def plot(records, path):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        sys.exit("--plot needs matplotlib (pip install matplotlib)")
+
+    origin = trigger_ms(records)
+    if origin is None:
+        origin = records[0]["time_ms"]
+    t = [(r["time_ms"] - origin) / 1000.0 for r in records]
+
+    fig, (temp, out, state) = plt.subplots(3, 1, sharex=True, figsize=(11, 8),
+                                           gridspec_kw={"height_ratios": [3, 2, 1]})
+    temp.plot(t, [r["temp_c"] for r in records], label="filtered")
+    temp.plot(t, [r["raw_c"] for r in records], label="raw", alpha=0.4)
+    temp.plot(t, [r["target_c"] for r in records], label="setpoint", linestyle="--")
+    temp.set_ylabel("°C")
+    temp.legend(loc="best")
+
+    out.plot(t, [r["duty_pct"] for r in records], label="duty %")
+    for name in ("p", "i", "d", "output"):
+        out.plot(t, [r[name] for r in records], label=name, alpha=0.7)
+    out.set_ylabel("controller")
+    out.legend(loc="best", ncol=5)
+
+    for offset, name in enumerate(("ssr", "pump", "grinder")):
+        state.step(t, [r[name] * 0.8 + offset for r in records], where="post", label=name)
+    state.set_yticks([0.4, 1.4, 2.4])
+    state.set_yticklabels(["ssr", "pump", "grinder"])
+    state.set_xlabel("s" + (" from trigger" if trigger_ms(records) is not None else ""))
+
+    fig.tight_layout()
+    fig.savefig(path, dpi=120)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", help="binary trace from /api/trace")
+    parser.add_argument("--csv", help="write the decoded records here")
+    parser.add_argument("--plot", help="write a PNG plot here")
+    parser.add_argument("--window", type=float,
+                        help="keep only this many seconds either side of the trigger")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        try:
+            trace = decode(f.read())
+        except ValueError as e:
+            sys.exit("%s: %s" % (args.dump, e))
+
+    if args.window is not None:
+        t = trigger_ms(trace["records"])
+        if t is None:
+            sys.exit("%s: no trigger in this trace" % args.dump)
+        limit = args.window * 1000.0
+        trace["records"] = [r for r in trace["records"] if abs(r["time_ms"] - t) <= limit]
+        trace["cycles"] = [c for c in trace["cycles"] if abs(c - t) <= limit]
+
+    summarize(trace)
+    if args.csv:
+        write_csv(trace["records"], args.csv)
+    if args.plot and trace["records"]:
+        plot(trace["records"], args.plot)
+
+
+if __name__ == "__main__":
+    main()